@@ -9,12 +9,14 @@
 #include "fileutils.h"
 #include "viewer.h"
 #include "keyboard.h"
-
-#include <stdio.h>
+#include "progressDialog.h"
+#include "mountList.h"
 
 #define SPLITTER_LINE_W 1
 #define X_LEFT 1
 #define X_RIGHT screen.w / 2 + SPLITTER_LINE_W + 1
+// Refresh period of the job status in the footer, in ms
+#define JOB_STATUS_MS 500
 
 namespace {
 
@@ -51,6 +53,33 @@ SDL_Surface *DrawBackground() {
     return bg;
 }
 
+// "Copy 42% (+1)", empty if no job is running
+std::string JobStatus(const std::vector<T_JOB_INFO> &p_infos)
+{
+    std::ostringstream l_s;
+    unsigned int l_nbQueued(0);
+    for (std::vector<T_JOB_INFO>::const_iterator l_it = p_infos.begin(); l_it != p_infos.end(); ++l_it)
+    {
+        if (l_it->m_status == T_JOB_QUEUED)
+        {
+            ++l_nbQueued;
+        }
+        else if (l_it->m_status == T_JOB_RUNNING)
+        {
+            l_s << (l_it->m_type == T_JOB_COPY ? "Copy" : (l_it->m_type == T_JOB_MOVE ? "Move" : "Delete"));
+            if (l_it->m_bytesTotal)
+                l_s << " " << l_it->m_bytesDone * 100 / l_it->m_bytesTotal << "%";
+            else if (l_it->m_filesTotal)
+                l_s << " " << l_it->m_filesDone * 100 / l_it->m_filesTotal << "%";
+        }
+    }
+    if (l_s.str().empty())
+        return l_s.str();
+    if (l_nbQueued)
+        l_s << " (+" << l_nbQueued << ")";
+    return l_s.str();
+}
+
 } // namespace
 
 CCommander::CCommander(const std::string &p_pathL, const std::string &p_pathR):
@@ -59,10 +88,13 @@ CCommander::CCommander(const std::string &p_pathL, const std::string &p_pathR):
     m_panelRight(p_pathR, X_RIGHT),
     m_panelSource(NULL),
     m_panelTarget(NULL),
-    m_background(DrawBackground())
+    m_background(DrawBackground()),
+    m_lastJobStatus(0)
 {
     m_panelSource = &m_panelLeft;
     m_panelTarget = &m_panelRight;
+    // Read the mounts now, so the disk info opens at once
+    CMountList::instance().refresh();
 }
 
 CCommander::~CCommander(void)
@@ -80,6 +112,13 @@ void CCommander::render(const bool p_focus) const
     m_panelRight.render(p_focus && (m_panelSource == &m_panelRight));
 }
 
+const bool CCommander::renderDamage(std::vector<SDL_Rect> &p_rects) const
+{
+    m_panelLeft.renderDamage(m_panelSource == &m_panelLeft, m_background, p_rects);
+    m_panelRight.renderDamage(m_panelSource == &m_panelRight, m_background, p_rects);
+    return true;
+}
+
 const bool CCommander::keyPress(const SDL_Event &p_event)
 {
     CWindow::keyPress(p_event);
@@ -104,7 +143,10 @@ const bool CCommander::keyPress(const SDL_Event &p_event)
             l_ret = m_panelSource->moveCursorDown(NB_VISIBLE_LINES - 1);
             break;
         case MYKEY_LEFT:
-            if (m_panelSource == &m_panelRight)
+            // Inside the thumbnail grid first
+            if (m_panelSource->moveCursorLeft())
+                l_ret = true;
+            else if (m_panelSource == &m_panelRight)
             {
                 m_panelSource = &m_panelLeft;
                 m_panelTarget = &m_panelRight;
@@ -112,7 +154,9 @@ const bool CCommander::keyPress(const SDL_Event &p_event)
             }
             break;
         case MYKEY_RIGHT:
-            if (m_panelSource == &m_panelLeft)
+            if (m_panelSource->moveCursorRight())
+                l_ret = true;
+            else if (m_panelSource == &m_panelLeft)
             {
                 m_panelSource = &m_panelRight;
                 m_panelTarget = &m_panelLeft;
@@ -201,13 +245,47 @@ const bool CCommander::keyHold(void)
     return l_ret;
 }
 
-const bool CCommander::openCopyMenu(void) const
+const bool CCommander::update(void)
+{
+    // Both panels may be listing a dir in the background
+    const bool l_left = m_panelLeft.update();
+    const bool l_right = m_panelRight.update();
+    // File operations may be running in the background
+    const bool l_jobs = updateJobStatus();
+    return l_left || l_right || l_jobs;
+}
+
+const bool CCommander::updateJobStatus(void)
+{
+    bool l_ret(false);
+    // Panels without inotify don't see the changes made by the jobs
+    if (m_jobs.takeNbFinished())
+    {
+        if (!m_panelLeft.isWatched())
+            m_panelLeft.refresh();
+        if (!m_panelRight.isWatched())
+            m_panelRight.refresh();
+        l_ret = true;
+    }
+    if (SDL_GetTicks() - m_lastJobStatus < JOB_STATUS_MS)
+        return l_ret;
+    m_lastJobStatus = SDL_GetTicks();
+    // The progress is shown under the target panel, the source one shows the size of the highlighted item
+    std::vector<T_JOB_INFO> l_infos;
+    m_jobs.getJobs(l_infos);
+    const bool l_source = m_panelSource->setStatus("");
+    const bool l_target = m_panelTarget->setStatus(JobStatus(l_infos));
+    return l_ret || l_source || l_target;
+}
+
+const bool CCommander::openCopyMenu(void)
 {
     bool l_ret(false);
     int l_dialogRetVal(0);
     bool l_rename(false);
-    // List of selected files
+    // List of selected files, and those confirmed if they exist in the target
     std::vector<std::string> l_list;
+    std::vector<std::string> l_confirmed;
     m_panelSource->getSelectList(l_list);
     // The rename option appears only if one item is selected
     l_rename = (l_list.size() == 1);
@@ -245,12 +323,22 @@ const bool CCommander::openCopyMenu(void) const
     {
         case 1:
             // Copy
-            File_utils::copyFile(l_list, m_panelTarget->getCurrentPath());
+            if (File_utils::confirmOverwrite(l_list, m_panelTarget->getCurrentPath(), l_confirmed) && !l_confirmed.empty())
+            {
+                m_jobs.add(T_JOB_COPY, l_confirmed, m_panelTarget->getCurrentPath());
+                CProgressDialog l_progress(m_jobs);
+                l_progress.execute();
+            }
             l_ret = true;
             break;
         case 2:
             // Move
-            File_utils::moveFile(l_list, m_panelTarget->getCurrentPath());
+            if (File_utils::confirmOverwrite(l_list, m_panelTarget->getCurrentPath(), l_confirmed) && !l_confirmed.empty())
+            {
+                m_jobs.add(T_JOB_MOVE, l_confirmed, m_panelTarget->getCurrentPath());
+                CProgressDialog l_progress(m_jobs);
+                l_progress.execute();
+            }
             l_ret = true;
             break;
         case 3:
@@ -267,10 +355,9 @@ const bool CCommander::openCopyMenu(void) const
             else
             {
                 // Delete
-printf("About to remove file");
-printf("%s", l_list.at(0).c_str());
-                File_utils::removeFile(l_list);
-printf("Done removing file.");
+                m_jobs.add(T_JOB_DELETE, l_list);
+                CProgressDialog l_progress(m_jobs);
+                l_progress.execute();
                 l_ret = true;
             }
             break;
@@ -278,7 +365,9 @@ printf("Done removing file.");
             if (l_rename)
             {
                 // Delete
-                File_utils::removeFile(l_list);
+                m_jobs.add(T_JOB_DELETE, l_list);
+                CProgressDialog l_progress(m_jobs);
+                l_progress.execute();
                 l_ret = true;
             }
             else
@@ -307,6 +396,9 @@ const bool CCommander::openSystemMenu(void)
         l_dialog.addOption("Select none");
         l_dialog.addOption("New directory");
         l_dialog.addOption("Disk info");
+        l_dialog.addOption("Sort order");
+        l_dialog.addOption("View");
+        l_dialog.addOption("Jobs");
         l_dialog.addOption("Quit");
         l_dialog.init();
         l_dialogRetVal = l_dialog.execute();
@@ -334,11 +426,66 @@ const bool CCommander::openSystemMenu(void)
             break;
         case 4:
             // Disk info
-            File_utils::diskInfo();
+            File_utils::diskInfo(m_panelSource->getCurrentPath());
             break;
         case 5:
+            // Sort order
+            {
+                CDialog l_dialog("Sort order:", 0, Y_LIST + m_panelSource->getHighlightedIndexRelative() * LINE_HEIGHT);
+                l_dialog.addOption("Case insensitive");
+                l_dialog.addOption("Natural");
+                l_dialog.addOption("Unicode");
+                l_dialog.init();
+                switch (l_dialog.execute())
+                {
+                    case 1:
+                        m_panelLeft.setSortMode(T_SORT_NOCASE);
+                        m_panelRight.setSortMode(T_SORT_NOCASE);
+                        break;
+                    case 2:
+                        m_panelLeft.setSortMode(T_SORT_NATURAL);
+                        m_panelRight.setSortMode(T_SORT_NATURAL);
+                        break;
+                    case 3:
+                        m_panelLeft.setSortMode(T_SORT_UTF8);
+                        m_panelRight.setSortMode(T_SORT_UTF8);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+        case 6:
+            // View of the source panel
+            {
+                CDialog l_dialog("View:", 0, Y_LIST + m_panelSource->getHighlightedIndexRelative() * LINE_HEIGHT);
+                l_dialog.addOption("List");
+                l_dialog.addOption("Thumbnails");
+                l_dialog.init();
+                switch (l_dialog.execute())
+                {
+                    case 1:
+                        m_panelSource->setViewMode(T_VIEW_LIST);
+                        break;
+                    case 2:
+                        m_panelSource->setViewMode(T_VIEW_THUMBNAILS);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+        case 7:
+            // Progress of the file operations
+            {
+                CProgressDialog l_progress(m_jobs);
+                l_progress.execute();
+            }
+            break;
+        case 8:
             // Quit
-            m_retVal = -1;
+            if (confirmQuit())
+                m_retVal = -1;
             break;
         default:
             break;
@@ -346,6 +493,39 @@ const bool CCommander::openSystemMenu(void)
     return l_ret;
 }
 
+const bool CCommander::confirmQuit(void)
+{
+    while (m_jobs.isBusy())
+    {
+        int l_dialogRetVal(0);
+        {
+            CDialog l_dialog("Jobs pending:", 0, Y_LIST + m_panelSource->getHighlightedIndexRelative() * LINE_HEIGHT);
+            l_dialog.addOption("Wait");
+            l_dialog.addOption("Cancel jobs");
+            l_dialog.init();
+            l_dialogRetVal = l_dialog.execute();
+        }
+        switch (l_dialogRetVal)
+        {
+            case 1:
+                // The progress closes by itself when the jobs are done
+                {
+                    CProgressDialog l_progress(m_jobs);
+                    if (l_progress.execute() == -1)
+                        return false;
+                }
+                break;
+            case 2:
+                // The job queue waits for the running job to stop
+                m_jobs.cancelAll();
+                return true;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
 void CCommander::openExecuteMenu(void) const
 {
     int l_dialogRetVal(0);
@@ -363,23 +543,12 @@ void CCommander::openExecuteMenu(void) const
         case 1:
             // View
             {
-                // Check size
-                const std::string l_file(m_panelSource->getHighlightedItemFull());
-                INHIBIT(std::cout << "File size: " << File_utils::getFileSize(l_file) << std::endl;)
-                if (File_utils::getFileSize(l_file) > VIEWER_SIZE_MAX)
-                {
-                    // File is too big to be viewed!
-                    CDialog l_dialog("Error:", 0, 0);
-                    l_dialog.addLabel("File is too big!");
-                    l_dialog.addOption("OK");
-                    l_dialog.init();
-                    l_dialog.execute();
-                }
-                else
-                {
-                    CViewer l_viewer(m_panelSource->getHighlightedItemFull());
-                    l_viewer.execute();
-                }
+                // Files of any size are read as they are viewed
+                // Images: left/right show the other ones of the dir
+                std::vector<std::string> l_images;
+                m_panelSource->getImageList(l_images);
+                CViewer l_viewer(m_panelSource->getHighlightedItemFull(), l_images);
+                l_viewer.execute();
             }
             break;
         case 2:
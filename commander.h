@@ -4,6 +4,7 @@
 #include <SDL.h>
 #include "panel.h"
 #include "window.h"
+#include "jobQueue.h"
 
 class CCommander : public CWindow
 {
@@ -28,19 +29,33 @@ class CCommander : public CWindow
     // Key hold management
     virtual const bool keyHold(void);
 
+    // Periodic update
+    virtual const bool update(void);
+
     // Draw
     virtual void render(const bool p_focus) const;
 
+    // Draw the damage of the panels
+    virtual const bool renderDamage(std::vector<SDL_Rect> &p_rects) const;
+
     // Is window full screen?
     virtual bool isFullScreen(void) const;
 
     // Open the file operation menus
-    const bool openCopyMenu(void) const;
+    const bool openCopyMenu(void);
     void openExecuteMenu(void) const;
 
     // Open the selection menu
     const bool openSystemMenu(void);
 
+    // Before quitting, wait for the pending jobs or cancel them
+    // Returns false if the user goes back
+    const bool confirmQuit(void);
+
+    // Show the progress of the running job in a footer
+    // Returns true if a new render is needed
+    const bool updateJobStatus(void);
+
     // The two panels
     CPanel m_panelLeft;
     CPanel m_panelRight;
@@ -48,6 +63,10 @@ class CCommander : public CWindow
     CPanel* m_panelTarget;
 
     SDL_Surface *m_background;
+
+    // File operations, running in the background
+    CJobQueue m_jobs;
+    Uint32 m_lastJobStatus;
 };
 
 #endif
@@ -0,0 +1,542 @@
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <SDL.h>
+#include "copyEngine.h"
+#include "deleteEngine.h"
+#include "sizeIndex.h"
+#include "def.h"
+
+// Bytes copied per kernel call
+#define COPY_CHUNK_SIZE 1048576
+// Buffer of the read/write fallback
+#define COPY_BUFFER_SIZE 131072
+
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+namespace {
+
+// True if the error means "not supported here, use another method"
+inline bool Unsupported(const int p_errno)
+{
+    return p_errno == ENOSYS || p_errno == EINVAL || p_errno == EXDEV || p_errno == EOPNOTSUPP || p_errno == ENOTSUP;
+}
+
+// Join a dir and a name
+std::string JoinPath(const std::string &p_dir, const char *p_name)
+{
+    return p_dir + (!p_dir.empty() && p_dir[p_dir.size() - 1] == '/' ? "" : "/") + p_name;
+}
+
+// Canonical path, or the given path if it can't be resolved
+std::string RealPath(const std::string &p_path)
+{
+    char l_buffer[PATH_MAX];
+    if (realpath(p_path.c_str(), l_buffer) == NULL)
+        return p_path;
+    return l_buffer;
+}
+
+// Dir containing a path
+std::string DirName(const std::string &p_path)
+{
+    return p_path.substr(0, std::max<std::size_t>(p_path.rfind('/'), 1));
+}
+
+// True if p_dest is the dir p_src, or a path in it
+bool IsInside(const std::string &p_src, const std::string &p_dest)
+{
+    const std::string l_src = RealPath(p_src);
+    const std::string l_destDir = RealPath(DirName(p_dest));
+    return l_destDir == l_src || l_destDir.compare(0, l_src.size() + 1, l_src + "/") == 0;
+}
+
+} // namespace
+
+CCopyEngine::CCopyEngine(void):
+    m_useCopyRange(true),
+    m_useSendfile(true),
+    m_useRenameat2(true),
+    m_nbBytes(0),
+    m_nbFiles(0),
+    m_progress(NULL)
+{
+}
+
+const bool CCopyEngine::copy(const std::string &p_src, const std::string &p_destDir)
+{
+    std::string l_src(p_src);
+    // "dir/" is copied as "dir"
+    while (l_src.size() > 1 && l_src[l_src.size() - 1] == '/')
+        l_src.erase(l_src.size() - 1);
+    return copyTo(l_src, JoinPath(p_destDir, l_src.substr(l_src.rfind('/') + 1).c_str()));
+}
+
+const bool CCopyEngine::copyTo(const std::string &p_src, const std::string &p_dest)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks(); const unsigned long long int l_nbBytes = m_nbBytes;)
+    struct stat l_stat;
+    if (lstat(p_src.c_str(), &l_stat) == -1)
+    {
+        std::cerr << "CCopyEngine::copy: Error lstat " << p_src << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    // Copying a dir into itself would never end
+    if (S_ISDIR(l_stat.st_mode) && IsInside(p_src, p_dest))
+    {
+        std::cerr << "CCopyEngine::copy: Error cannot copy " << p_src << " into itself" << std::endl;
+        return false;
+    }
+    const bool l_ret = copyEntry(p_src, l_stat, p_dest);
+    addWritten(DirName(p_dest));
+    INHIBIT(std::cout << "CCopyEngine::copy: " << p_src << " -> " << p_dest << ": " << m_nbBytes - l_nbBytes << " bytes in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    return l_ret;
+}
+
+const bool CCopyEngine::move(const std::string &p_src, const std::string &p_destDir)
+{
+    std::string l_src(p_src);
+    // "dir/" is moved as "dir"
+    while (l_src.size() > 1 && l_src[l_src.size() - 1] == '/')
+        l_src.erase(l_src.size() - 1);
+    return moveTo(l_src, JoinPath(p_destDir, l_src.substr(l_src.rfind('/') + 1).c_str()));
+}
+
+const bool CCopyEngine::moveTo(const std::string &p_src, const std::string &p_dest, const bool p_overwrite)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    if (cancelled())
+        return false;
+    struct stat l_stat;
+    if (lstat(p_src.c_str(), &l_stat) == -1)
+    {
+        std::cerr << "CCopyEngine::move: Error lstat " << p_src << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (S_ISDIR(l_stat.st_mode) && IsInside(p_src, p_dest))
+    {
+        std::cerr << "CCopyEngine::move: Error cannot move " << p_src << " into itself" << std::endl;
+        return false;
+    }
+    const std::string l_destDir = DirName(p_dest);
+    struct stat l_destStat;
+    if (stat(l_destDir.c_str(), &l_destStat) == 0 && l_destStat.st_dev == l_stat.st_dev)
+    {
+        // Same file system => rename, whatever the size
+        if (renameNoReplace(p_src, p_dest))
+        {
+            ++m_nbFiles;
+            if (m_progress != NULL)
+                ++m_progress->m_files;
+            addWritten(l_destDir);
+            INHIBIT(std::cout << "CCopyEngine::move: " << p_src << " -> " << p_dest << ": renamed in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+            return true;
+        }
+        if (errno == EEXIST)
+        {
+            if (lstat(p_dest.c_str(), &l_destStat) == -1)
+            {
+                std::cerr << "CCopyEngine::move: Error lstat " << p_dest << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+            // Same entry, e.g. a change of case on a case insensitive file system
+            const bool l_same = l_destStat.st_dev == l_stat.st_dev && l_destStat.st_ino == l_stat.st_ino;
+            if (!p_overwrite && !l_same)
+            {
+                errno = EEXIST;
+                return false;
+            }
+            if (!l_same && S_ISDIR(l_stat.st_mode) && S_ISDIR(l_destStat.st_mode))
+            {
+                // Existing dirs are merged, like copies
+                DIR *l_dir = opendir(p_src.c_str());
+                if (l_dir == NULL)
+                {
+                    std::cerr << "CCopyEngine::move: Error opendir " << p_src << ": " << strerror(errno) << std::endl;
+                    return false;
+                }
+                bool l_ret(true);
+                struct dirent *l_ent;
+                while (!cancelled() && (l_ent = readdir(l_dir)) != NULL)
+                {
+                    if (l_ent->d_name[0] == '.' && (l_ent->d_name[1] == '\0' || (l_ent->d_name[1] == '.' && l_ent->d_name[2] == '\0')))
+                        continue;
+                    l_ret = moveTo(JoinPath(p_src, l_ent->d_name), JoinPath(p_dest, l_ent->d_name)) && l_ret;
+                }
+                closedir(l_dir);
+                if (l_ret && !cancelled() && rmdir(p_src.c_str()) == -1)
+                {
+                    std::cerr << "CCopyEngine::move: Error rmdir " << p_src << ": " << strerror(errno) << std::endl;
+                    l_ret = false;
+                }
+                return l_ret;
+            }
+            if (rename(p_src.c_str(), p_dest.c_str()) == -1)
+            {
+                std::cerr << "CCopyEngine::move: Error rename " << p_src << " to " << p_dest << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+            ++m_nbFiles;
+            if (m_progress != NULL)
+                ++m_progress->m_files;
+            addWritten(l_destDir);
+            return true;
+        }
+        // A bind mount has the device of the mounted file system => copy
+        if (errno != EXDEV)
+        {
+            std::cerr << "CCopyEngine::move: Error rename " << p_src << " to " << p_dest << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    // Other file system => copy, and remove the source once it's completely copied
+    if (!p_overwrite && lstat(p_dest.c_str(), &l_destStat) == 0)
+    {
+        errno = EEXIST;
+        return false;
+    }
+    bool l_ret = copyEntry(p_src, l_stat, p_dest);
+    addWritten(l_destDir);
+    if (l_ret && !cancelled())
+    {
+        CDeleteEngine l_deleteEngine;
+        l_ret = l_deleteEngine.remove(p_src);
+        addWritten(DirName(p_src));
+    }
+    INHIBIT(std::cout << "CCopyEngine::move: " << p_src << " -> " << p_dest << ": copied in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    return l_ret && !cancelled();
+}
+
+const bool CCopyEngine::renameNoReplace(const std::string &p_src, const std::string &p_dest)
+{
+    // renameat2 checks and renames atomically
+    // Called through syscall(), the C library of the toolchain may be too old
+#ifdef __NR_renameat2
+    if (m_useRenameat2)
+    {
+        if (syscall(__NR_renameat2, AT_FDCWD, p_src.c_str(), AT_FDCWD, p_dest.c_str(), RENAME_NOREPLACE) == 0)
+            return true;
+        if (errno == EXDEV || !Unsupported(errno))
+            return false;
+        if (errno == ENOSYS)
+            m_useRenameat2 = false;
+    }
+#endif
+    // Old kernel, or file system without support => check, then rename
+    struct stat l_stat;
+    if (lstat(p_dest.c_str(), &l_stat) == 0)
+    {
+        errno = EEXIST;
+        return false;
+    }
+    return rename(p_src.c_str(), p_dest.c_str()) == 0;
+}
+
+void CCopyEngine::addWritten(const std::string &p_dir)
+{
+    struct stat l_stat;
+    if (stat(p_dir.c_str(), &l_stat) == 0)
+        m_written.insert(std::make_pair(l_stat.st_dev, p_dir));
+}
+
+const bool CCopyEngine::copyEntry(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest)
+{
+    bool l_ret(false);
+    if (cancelled())
+        return false;
+    if (S_ISDIR(p_stat.st_mode))
+    {
+        l_ret = copyDirectory(p_src, p_stat, p_dest);
+    }
+    else if (S_ISREG(p_stat.st_mode))
+    {
+        l_ret = copyRegular(p_src, p_stat, p_dest);
+    }
+    else if (S_ISLNK(p_stat.st_mode))
+    {
+        l_ret = copySymlink(p_src, p_stat, p_dest);
+    }
+    else
+    {
+        // Device, fifo or socket => new node
+        unlink(p_dest.c_str());
+        l_ret = mknod(p_dest.c_str(), p_stat.st_mode, p_stat.st_rdev) == 0;
+        if (l_ret)
+            copyMetadata(p_dest, p_stat);
+        else
+            std::cerr << "CCopyEngine::copy: Error mknod " << p_dest << ": " << strerror(errno) << std::endl;
+    }
+    if (l_ret)
+    {
+        ++m_nbFiles;
+        if (m_progress != NULL)
+            ++m_progress->m_files;
+    }
+    return l_ret;
+}
+
+const bool CCopyEngine::copyDirectory(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest)
+{
+    // Existing dirs are merged, new ones are writable until they are complete
+    bool l_created(true);
+    if (mkdir(p_dest.c_str(), S_IRWXU) == -1)
+    {
+        struct stat l_stat;
+        if (errno != EEXIST || stat(p_dest.c_str(), &l_stat) == -1 || !S_ISDIR(l_stat.st_mode))
+        {
+            std::cerr << "CCopyEngine::copy: Error mkdir " << p_dest << ": " << strerror(errno == EEXIST ? ENOTDIR : errno) << std::endl;
+            return false;
+        }
+        l_created = false;
+    }
+    DIR *l_dir = opendir(p_src.c_str());
+    if (l_dir == NULL)
+    {
+        std::cerr << "CCopyEngine::copy: Error opendir " << p_src << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    bool l_ret(true);
+    struct dirent *l_ent;
+    struct stat l_stat;
+    while (!cancelled() && (l_ent = readdir(l_dir)) != NULL)
+    {
+        if (l_ent->d_name[0] == '.' && (l_ent->d_name[1] == '\0' || (l_ent->d_name[1] == '.' && l_ent->d_name[2] == '\0')))
+            continue;
+        const std::string l_src = JoinPath(p_src, l_ent->d_name);
+        if (fstatat(dirfd(l_dir), l_ent->d_name, &l_stat, AT_SYMLINK_NOFOLLOW) == -1)
+        {
+            std::cerr << "CCopyEngine::copy: Error lstat " << l_src << ": " << strerror(errno) << std::endl;
+            l_ret = false;
+            continue;
+        }
+        l_ret = copyEntry(l_src, l_stat, JoinPath(p_dest, l_ent->d_name)) && l_ret;
+    }
+    closedir(l_dir);
+    // Metadata last, the mtime would change with the contents
+    if (l_created)
+        copyMetadata(p_dest, p_stat);
+    return l_ret;
+}
+
+const bool CCopyEngine::copyRegular(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest)
+{
+    // Copying a file onto itself would truncate it
+    struct stat l_stat;
+    const bool l_exists = stat(p_dest.c_str(), &l_stat) == 0;
+    if (l_exists && l_stat.st_dev == p_stat.st_dev && l_stat.st_ino == p_stat.st_ino)
+    {
+        std::cerr << "CCopyEngine::copy: Error " << p_src << " and " << p_dest << " are the same file" << std::endl;
+        return false;
+    }
+    // Overwriting doesn't change the mtime of the dir
+    if (l_exists)
+        CSizeIndex::instance().invalidate(DirName(p_dest));
+    const int l_in = open(p_src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (l_in == -1)
+    {
+        std::cerr << "CCopyEngine::copy: Error open " << p_src << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    const int l_out = open(p_dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, (p_stat.st_mode & 07777) | S_IWUSR);
+    if (l_out == -1)
+    {
+        std::cerr << "CCopyEngine::copy: Error open " << p_dest << ": " << strerror(errno) << std::endl;
+        close(l_in);
+        return false;
+    }
+    const bool l_ret = copyData(l_in, l_out, p_stat);
+    if (l_ret)
+    {
+        // Owner first, chown clears the setuid bits
+        if (fchown(l_out, p_stat.st_uid, p_stat.st_gid) == -1 && errno != EPERM)
+            std::cerr << "CCopyEngine::copy: Error chown " << p_dest << ": " << strerror(errno) << std::endl;
+        fchmod(l_out, p_stat.st_mode & 07777);
+        const struct timespec l_times[2] = {p_stat.st_atim, p_stat.st_mtim};
+        futimens(l_out, l_times);
+    }
+    else if (!cancelled())
+    {
+        std::cerr << "CCopyEngine::copy: Error copying " << p_src << ": " << strerror(errno) << std::endl;
+    }
+    close(l_in);
+    if (close(l_out) == -1)
+        return false;
+    // Don't leave a partial file behind
+    if (!l_ret && cancelled())
+        unlink(p_dest.c_str());
+    return l_ret;
+}
+
+const bool CCopyEngine::copySymlink(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest)
+{
+    std::vector<char> l_target(p_stat.st_size > 0 ? p_stat.st_size + 1 : PATH_MAX);
+    const ssize_t l_len = readlink(p_src.c_str(), l_target.data(), l_target.size());
+    if (l_len < 0 || static_cast<std::size_t>(l_len) >= l_target.size())
+    {
+        std::cerr << "CCopyEngine::copy: Error readlink " << p_src << std::endl;
+        return false;
+    }
+    l_target[l_len] = '\0';
+    // Links are replaced, not followed
+    struct stat l_stat;
+    if (lstat(p_dest.c_str(), &l_stat) == 0 && !S_ISDIR(l_stat.st_mode))
+        unlink(p_dest.c_str());
+    if (symlink(l_target.data(), p_dest.c_str()) == -1)
+    {
+        std::cerr << "CCopyEngine::copy: Error symlink " << p_dest << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    copyMetadata(p_dest, p_stat);
+    return true;
+}
+
+const bool CCopyEngine::copyData(const int p_in, const int p_out, const struct stat &p_stat)
+{
+    unsigned long long int l_done(0);
+    ssize_t l_nb(0);
+    // copy_file_range: no copy to user space, reflinks on some file systems
+    // Called through syscall(), the C library of the toolchain may be too old
+#ifdef __NR_copy_file_range
+    while (m_useCopyRange)
+    {
+        l_nb = syscall(__NR_copy_file_range, p_in, NULL, p_out, NULL, COPY_CHUNK_SIZE, 0);
+        if (l_nb > 0)
+        {
+            l_done += l_nb;
+            addBytes(l_nb);
+            if (cancelled())
+                return false;
+            continue;
+        }
+        // Some pseudo file systems report 0 for files with data => check with read()
+        if (l_nb == 0 && (l_done || !p_stat.st_size))
+            return true;
+        if (l_nb < 0 && !Unsupported(errno))
+            return false;
+        if (l_nb < 0 && errno == ENOSYS)
+            m_useCopyRange = false;
+        break;
+    }
+#endif
+    // sendfile: no copy to user space
+    while (m_useSendfile)
+    {
+        l_nb = sendfile(p_out, p_in, NULL, COPY_CHUNK_SIZE);
+        if (l_nb > 0)
+        {
+            l_done += l_nb;
+            addBytes(l_nb);
+            if (cancelled())
+                return false;
+            continue;
+        }
+        if (l_nb == 0 && (l_done || !p_stat.st_size))
+            return true;
+        if (l_nb < 0 && !Unsupported(errno))
+            return false;
+        if (l_nb < 0 && errno == ENOSYS)
+            m_useSendfile = false;
+        break;
+    }
+    // read/write
+    if (m_buffer.empty())
+        m_buffer.resize(COPY_BUFFER_SIZE);
+    while ((l_nb = read(p_in, m_buffer.data(), m_buffer.size())) != 0)
+    {
+        if (l_nb < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        for (ssize_t l_written = 0; l_written < l_nb; )
+        {
+            const ssize_t l_ret = write(p_out, m_buffer.data() + l_written, l_nb - l_written);
+            if (l_ret < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            l_written += l_ret;
+        }
+        addBytes(l_nb);
+        if (cancelled())
+            return false;
+    }
+    return true;
+}
+
+void CCopyEngine::copyMetadata(const std::string &p_dest, const struct stat &p_stat)
+{
+    // Owner first, chown clears the setuid bits
+    if (lchown(p_dest.c_str(), p_stat.st_uid, p_stat.st_gid) == -1 && errno != EPERM)
+        std::cerr << "CCopyEngine::copy: Error chown " << p_dest << ": " << strerror(errno) << std::endl;
+    // Links have no mode of their own
+    if (!S_ISLNK(p_stat.st_mode))
+        chmod(p_dest.c_str(), p_stat.st_mode & 07777);
+    const struct timespec l_times[2] = {p_stat.st_atim, p_stat.st_mtim};
+    utimensat(AT_FDCWD, p_dest.c_str(), l_times, AT_SYMLINK_NOFOLLOW);
+}
+
+void CCopyEngine::sync(void)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    // syncfs flushes only the file systems written to
+    for (std::map<dev_t, std::string>::const_iterator l_it = m_written.begin(); l_it != m_written.end(); ++l_it)
+    {
+#ifdef __NR_syncfs
+        const int l_fd = open(l_it->second.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECTORY);
+        if (l_fd != -1 && syscall(__NR_syncfs, l_fd) == 0)
+        {
+            close(l_fd);
+            continue;
+        }
+        if (l_fd != -1)
+            close(l_fd);
+#endif
+        ::sync();
+        break;
+    }
+    m_written.clear();
+    INHIBIT(std::cout << "CCopyEngine::sync: " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+}
+
+void CCopyEngine::setProgress(T_PROGRESS *p_progress)
+{
+    m_progress = p_progress;
+}
+
+void CCopyEngine::addBytes(const unsigned long long int p_nb)
+{
+    m_nbBytes += p_nb;
+    if (m_progress != NULL)
+        m_progress->m_bytes += p_nb;
+}
+
+const bool CCopyEngine::cancelled(void) const
+{
+    return m_progress != NULL && m_progress->m_cancel;
+}
+
+const unsigned long long int CCopyEngine::getNbBytes(void) const
+{
+    return m_nbBytes;
+}
+
+const unsigned int CCopyEngine::getNbFiles(void) const
+{
+    return m_nbFiles;
+}
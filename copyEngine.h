@@ -0,0 +1,95 @@
+#ifndef _COPY_ENGINE_H_
+#define _COPY_ENGINE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "fileutils.h"
+
+// Native recursive copy, like "cp -r" with mode, owner and times preserved
+// Symbolic links are copied as links, existing dirs are merged,
+// existing files are overwritten. Data is flushed once, by sync().
+// Moves are renames on the same file system, copies then removals across them.
+class CCopyEngine
+{
+    public:
+
+    // Constructor
+    CCopyEngine(void);
+
+    // Copy p_src into the directory p_destDir
+    // Returns false if something could not be copied
+    const bool copy(const std::string &p_src, const std::string &p_destDir);
+
+    // Copy p_src to p_dest
+    const bool copyTo(const std::string &p_src, const std::string &p_dest);
+
+    // Move p_src into the directory p_destDir
+    const bool move(const std::string &p_src, const std::string &p_destDir);
+
+    // Move p_src to p_dest
+    // If p_overwrite is false and p_dest exists, nothing is done and errno is EEXIST
+    // The check is atomic on the same file system, if the kernel supports it
+    const bool moveTo(const std::string &p_src, const std::string &p_dest, const bool p_overwrite = true);
+
+    // Flush the file systems written to
+    void sync(void);
+
+    // Report progress in p_progress, and stop when it's cancelled
+    void setProgress(T_PROGRESS *p_progress);
+
+    // Statistics
+    const unsigned long long int getNbBytes(void) const;
+    const unsigned int getNbFiles(void) const;
+
+    private:
+
+    // Forbidden
+    CCopyEngine(const CCopyEngine &p_source);
+    const CCopyEngine &operator =(const CCopyEngine &p_source);
+
+    // Copy an entry, stat'ed in p_stat, recursively
+    const bool copyEntry(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest);
+    const bool copyDirectory(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest);
+    const bool copyRegular(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest);
+    const bool copySymlink(const std::string &p_src, const struct stat &p_stat, const std::string &p_dest);
+
+    // rename() that fails with EEXIST instead of replacing p_dest
+    const bool renameNoReplace(const std::string &p_src, const std::string &p_dest);
+
+    // Remember the file system of a dir, for sync()
+    void addWritten(const std::string &p_dir);
+
+    // Copy the contents of a file, from the current offsets
+    const bool copyData(const int p_in, const int p_out, const struct stat &p_stat);
+
+    // Set mode, owner and times of a copied entry
+    void copyMetadata(const std::string &p_dest, const struct stat &p_stat);
+
+    // Count copied data
+    void addBytes(const unsigned long long int p_nb);
+
+    // True if the operation is cancelled
+    const bool cancelled(void) const;
+
+    // Buffer for the read/write fallback
+    std::vector<char> m_buffer;
+
+    // Kernel copy methods, disabled when unsupported
+    bool m_useCopyRange;
+    bool m_useSendfile;
+    bool m_useRenameat2;
+
+    // One written path per file system, for sync()
+    std::map<dev_t, std::string> m_written;
+
+    // Statistics
+    unsigned long long int m_nbBytes;
+    unsigned int m_nbFiles;
+
+    // Progress of the whole operation, if any
+    T_PROGRESS *m_progress;
+};
+
+#endif
@@ -41,8 +41,54 @@
 #define PATH_DEFAULT_RIGHT getenv("HOME")
 #endif
 
-#ifndef FILE_SYSTEM
-#define FILE_SYSTEM "/dev/sda4"
+#ifndef LISTING_CACHE_SIZE_MAX
+#define LISTING_CACHE_SIZE_MAX 8388608  // = 8 MB
+#endif
+
+// Index of the dir sizes, relative to $HOME, and its maximum number of dirs
+#ifndef SIZE_INDEX_FILE
+#define SIZE_INDEX_FILE ".config/commander/dirsizes.idx"
+#endif
+
+#ifndef SIZE_INDEX_NB_MAX
+#define SIZE_INDEX_NB_MAX 65536
+#endif
+
+// Mapping of the viewed files that don't fit in the address space
+#ifndef MAPPED_FILE_WINDOW
+#define MAPPED_FILE_WINDOW 16777216  // = 16 MB
+#endif
+
+// Cache of the decoded images, relative to $HOME, and its maximum size
+#ifndef IMAGE_CACHE_DIR
+#define IMAGE_CACHE_DIR ".cache/commander/images"
+#endif
+
+#ifndef IMAGE_CACHE_SIZE_MAX
+#define IMAGE_CACHE_SIZE_MAX 67108864  // = 64 MB
+#endif
+
+// Same for the thumbnails, and their size in the thumbnail view of the panels
+#ifndef THUMBNAIL_CACHE_DIR
+#define THUMBNAIL_CACHE_DIR ".cache/commander/thumbnails"
+#endif
+
+#ifndef THUMBNAIL_CACHE_SIZE_MAX
+#define THUMBNAIL_CACHE_SIZE_MAX 33554432  // = 32 MB
+#endif
+
+#ifndef THUMBNAIL_SIZE
+#define THUMBNAIL_SIZE 64
+#endif
+
+// Memory for the rendered rows of each panel
+#ifndef PANEL_ROW_CACHE_SIZE_MAX
+#define PANEL_ROW_CACHE_SIZE_MAX 524288  // = 512 KB
+#endif
+
+// Memory for the rendered glyphs of drawText
+#ifndef GLYPH_CACHE_SIZE_MAX
+#define GLYPH_CACHE_SIZE_MAX 1048576  // = 1 MB
 #endif
 
 // Panel
@@ -0,0 +1,231 @@
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <SDL.h>
+#include "deleteEngine.h"
+#include "sizeIndex.h"
+#include "def.h"
+
+// Maximum number of threads removing a tree
+// Deletes are bound by the file system journal, more threads don't help
+#ifndef DELETE_NB_THREADS_MAX
+#define DELETE_NB_THREADS_MAX 4
+#endif
+
+CDeleteEngine::CDeleteEngine(void):
+    m_done(false),
+    m_ok(true),
+    m_nbFiles(0),
+    m_progress(NULL)
+{
+}
+
+const bool CDeleteEngine::remove(const std::string &p_path)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks(); const unsigned int l_nbFiles = m_nbFiles;)
+    struct stat l_stat;
+    if (lstat(p_path.c_str(), &l_stat) == -1)
+    {
+        std::cerr << "CDeleteEngine::remove: Error lstat " << p_path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (!S_ISDIR(l_stat.st_mode))
+    {
+        if (unlink(p_path.c_str()) == -1)
+        {
+            std::cerr << "CDeleteEngine::remove: Error unlink " << p_path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        addFile();
+        return true;
+    }
+    // The dir is emptied by the pool, then removed by the thread releasing it last
+    T_NODE *l_root = new T_NODE;
+    l_root->m_parent = NULL;
+    l_root->m_name = p_path;
+    l_root->m_dir = NULL;
+    l_root->m_pending = 1;
+    l_root->m_failed = false;
+    m_stack.push_back(l_root);
+    m_done = false;
+    m_ok = true;
+    const unsigned int l_nbThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(DELETE_NB_THREADS_MAX)));
+    std::vector<std::thread> l_threads;
+    for (unsigned int l_i = 1; l_i < l_nbThreads; ++l_i)
+        l_threads.push_back(std::thread(&CDeleteEngine::run, this));
+    run();
+    for (std::vector<std::thread>::iterator l_it = l_threads.begin(); l_it != l_threads.end(); ++l_it)
+        l_it->join();
+    INHIBIT(std::cout << "CDeleteEngine::remove: " << p_path << ": " << m_nbFiles - l_nbFiles << " entries in " << SDL_GetTicks() - l_time << "ms with " << l_nbThreads << " threads" << std::endl;)
+    return m_ok;
+}
+
+void CDeleteEngine::run(void)
+{
+    std::unique_lock<std::mutex> l_lock(m_mutex);
+    for (;;)
+    {
+        while (m_stack.empty() && !m_done)
+            m_condition.wait(l_lock);
+        if (m_stack.empty())
+            return;
+        T_NODE *l_node = m_stack.back();
+        m_stack.pop_back();
+        l_lock.unlock();
+        process(l_node);
+        l_lock.lock();
+    }
+}
+
+void CDeleteEngine::process(T_NODE *p_node)
+{
+    if (cancelled())
+    {
+        p_node->m_failed = true;
+        release(p_node);
+        return;
+    }
+    const int l_parentFd = p_node->m_parent == NULL ? AT_FDCWD : dirfd(p_node->m_parent->m_dir);
+    const int l_fd = openat(l_parentFd, p_node->m_name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (l_fd != -1)
+    {
+        // Its inode may be reused by a new dir
+        struct stat l_stat;
+        if (fstat(l_fd, &l_stat) == 0)
+            CSizeIndex::instance().invalidate(l_stat);
+        p_node->m_dir = fdopendir(l_fd);
+        if (p_node->m_dir == NULL)
+            close(l_fd);
+    }
+    if (p_node->m_dir == NULL)
+    {
+        std::cerr << "CDeleteEngine::remove: Error open " << getPath(p_node->m_parent, p_node->m_name.c_str()) << ": " << strerror(errno) << std::endl;
+        p_node->m_failed = true;
+        release(p_node);
+        return;
+    }
+    // List first, removing entries while reading may skip others
+    std::vector<std::string> l_files;
+    std::vector<std::string> l_dirs;
+    struct dirent *l_ent;
+    struct stat l_stat;
+    while ((l_ent = readdir(p_node->m_dir)) != NULL)
+    {
+        if (l_ent->d_name[0] == '.' && (l_ent->d_name[1] == '\0' || (l_ent->d_name[1] == '.' && l_ent->d_name[2] == '\0')))
+            continue;
+        bool l_isDir = l_ent->d_type == DT_DIR;
+        if (l_ent->d_type == DT_UNKNOWN)
+            l_isDir = fstatat(dirfd(p_node->m_dir), l_ent->d_name, &l_stat, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(l_stat.st_mode);
+        if (l_isDir)
+            l_dirs.push_back(l_ent->d_name);
+        else
+            l_files.push_back(l_ent->d_name);
+    }
+    // Files
+    for (std::vector<std::string>::const_iterator l_it = l_files.begin(); l_it != l_files.end() && !cancelled(); ++l_it)
+    {
+        if (unlinkat(dirfd(p_node->m_dir), l_it->c_str(), 0) == 0)
+        {
+            addFile();
+        }
+        else
+        {
+            std::cerr << "CDeleteEngine::remove: Error unlink " << getPath(p_node, l_it->c_str()) << ": " << strerror(errno) << std::endl;
+            p_node->m_failed = true;
+        }
+    }
+    // Subdirs, for any thread of the pool
+    if (!l_dirs.empty() && !cancelled())
+    {
+        std::vector<T_NODE *> l_nodes;
+        for (std::vector<std::string>::const_iterator l_it = l_dirs.begin(); l_it != l_dirs.end(); ++l_it)
+        {
+            T_NODE *l_node = new T_NODE;
+            l_node->m_parent = p_node;
+            l_node->m_name = *l_it;
+            l_node->m_dir = NULL;
+            l_node->m_pending = 1;
+            l_node->m_failed = false;
+            l_nodes.push_back(l_node);
+        }
+        p_node->m_pending += l_nodes.size();
+        {
+            std::lock_guard<std::mutex> l_lock(m_mutex);
+            m_stack.insert(m_stack.end(), l_nodes.begin(), l_nodes.end());
+        }
+        m_condition.notify_all();
+    }
+    release(p_node);
+}
+
+void CDeleteEngine::release(T_NODE *p_node)
+{
+    if (--p_node->m_pending)
+        return;
+    // Last reference => the dir is empty, unless something failed
+    T_NODE *l_parent = p_node->m_parent;
+    if (p_node->m_dir != NULL)
+        closedir(p_node->m_dir);
+    if (!p_node->m_failed && !cancelled())
+    {
+        if (unlinkat(l_parent == NULL ? AT_FDCWD : dirfd(l_parent->m_dir), p_node->m_name.c_str(), AT_REMOVEDIR) == 0)
+        {
+            addFile();
+        }
+        else
+        {
+            std::cerr << "CDeleteEngine::remove: Error rmdir " << getPath(l_parent, p_node->m_name.c_str()) << ": " << strerror(errno) << std::endl;
+            p_node->m_failed = true;
+        }
+    }
+    const bool l_ok = !p_node->m_failed && !cancelled();
+    delete p_node;
+    if (l_parent != NULL)
+    {
+        if (!l_ok)
+            l_parent->m_failed = true;
+        release(l_parent);
+        return;
+    }
+    // Root => the tree is done
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_done = true;
+        m_ok = l_ok;
+    }
+    m_condition.notify_all();
+}
+
+const std::string CDeleteEngine::getPath(const T_NODE *p_node, const char *p_name) const
+{
+    if (p_node == NULL)
+        return p_name;
+    return getPath(p_node->m_parent, p_node->m_name.c_str()) + "/" + p_name;
+}
+
+void CDeleteEngine::setProgress(T_PROGRESS *p_progress)
+{
+    m_progress = p_progress;
+}
+
+void CDeleteEngine::addFile(void)
+{
+    ++m_nbFiles;
+    if (m_progress != NULL)
+        ++m_progress->m_files;
+}
+
+const bool CDeleteEngine::cancelled(void) const
+{
+    return m_progress != NULL && m_progress->m_cancel;
+}
+
+const unsigned int CDeleteEngine::getNbFiles(void) const
+{
+    return m_nbFiles;
+}
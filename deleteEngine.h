@@ -0,0 +1,86 @@
+#ifndef _DELETE_ENGINE_H_
+#define _DELETE_ENGINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include "fileutils.h"
+
+// Native recursive delete, like "rm -rf"
+// Entries are removed relative to their dir fd, sibling subtrees by a small pool of threads
+class CDeleteEngine
+{
+    public:
+
+    // Constructor
+    CDeleteEngine(void);
+
+    // Remove p_path, recursively
+    // Returns false if something could not be removed
+    const bool remove(const std::string &p_path);
+
+    // Report progress in p_progress, and stop when it's cancelled
+    void setProgress(T_PROGRESS *p_progress);
+
+    // Statistics
+    const unsigned int getNbFiles(void) const;
+
+    private:
+
+    // Forbidden
+    CDeleteEngine(const CDeleteEngine &p_source);
+    const CDeleteEngine &operator =(const CDeleteEngine &p_source);
+
+    // A dir being emptied
+    struct T_NODE
+    {
+        // Parent dir, NULL for the dir given to remove()
+        T_NODE *m_parent;
+        // Name in the parent, or path for the root
+        std::string m_name;
+        // Open once it's read, for its entries
+        DIR *m_dir;
+        // Own listing + subdirs not removed yet
+        std::atomic<unsigned int> m_pending;
+        // Something inside could not be removed
+        std::atomic<bool> m_failed;
+    };
+
+    // Worker thread: empty the dirs of the stack until all are removed
+    void run(void);
+
+    // Read a dir, remove its entries and push its subdirs
+    void process(T_NODE *p_node);
+
+    // Drop a reference to a dir, and remove it when it was the last one
+    void release(T_NODE *p_node);
+
+    // Full path of an entry of a dir, for messages
+    const std::string getPath(const T_NODE *p_node, const char *p_name) const;
+
+    // True if the operation is cancelled
+    const bool cancelled(void) const;
+
+    // Count a removed entry
+    void addFile(void);
+
+    // Dirs to read, the last one first to stay close to depth first
+    // and keep few dirs open
+    std::vector<T_NODE *> m_stack;
+    // True when the root dir is released, m_ok if everything was removed
+    bool m_done;
+    bool m_ok;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    // Statistics
+    std::atomic<unsigned int> m_nbFiles;
+
+    // Progress of the whole operation, if any
+    T_PROGRESS *m_progress;
+};
+
+#endif
@@ -0,0 +1,249 @@
+#include <iostream>
+#include <sstream>
+#include "diskInfoDialog.h"
+#include "resourceManager.h"
+#include "fileutils.h"
+#include "screen.h"
+#include "sdlutils.h"
+#include "def.h"
+
+// Width of the dialog
+#define DISK_INFO_W (screen.w * 5 / 6)
+// Lines: title, size, used, available, mounts
+#define DISK_INFO_NB_DETAILS 3
+#define DISK_INFO_NB_MOUNTS 6
+#define DISK_INFO_NB_LINES (1 + DISK_INFO_NB_DETAILS + DISK_INFO_NB_MOUNTS)
+
+namespace {
+
+// Used part, like df
+unsigned int UsedPercent(const T_MOUNT &p_mount)
+{
+    const unsigned long long int l_total = p_mount.m_used + p_mount.m_available;
+    return l_total ? (p_mount.m_used * 100 + l_total - 1) / l_total : 0;
+}
+
+} // namespace
+
+CDiskInfoDialog::CDiskInfoDialog(const std::string &p_path):
+    CWindow(),
+    m_path(p_path),
+    m_generation(0),
+    m_current(-1),
+    m_highlightedLine(0),
+    m_camera(0),
+    m_image(NULL),
+    m_cursor1(NULL),
+    m_cursor2(NULL),
+    m_x(0),
+    m_y(0)
+{
+    // Last known usage at once, the new one when it's read
+    CMountList::instance().refresh();
+    updateMounts();
+    // Dialog image: title bar and background
+    const int l_height = DISK_INFO_NB_LINES * LINE_HEIGHT + 2 * DIALOG_BORDER;
+    m_image = SDL_utils::createImage(DISK_INFO_W * screen.ppu_x, l_height * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_BORDER));
+    {
+        SDL_Rect l_rect = SDL_utils::Rect(DIALOG_BORDER * screen.ppu_x, (DIALOG_BORDER + LINE_HEIGHT) * screen.ppu_y, (DISK_INFO_W - 2 * DIALOG_BORDER) * screen.ppu_x, (l_height - 2 * DIALOG_BORDER - LINE_HEIGHT) * screen.ppu_y);
+        SDL_FillRect(m_image, &l_rect, SDL_MapRGB(m_image->format, COLOR_BG_1));
+        // Separation between the details and the list
+        l_rect.y = (DIALOG_BORDER + (1 + DISK_INFO_NB_DETAILS) * LINE_HEIGHT - 1) * screen.ppu_y;
+        l_rect.h = screen.ppu_y;
+        SDL_FillRect(m_image, &l_rect, SDL_MapRGB(m_image->format, COLOR_BG_2));
+    }
+    // Cursor images
+    m_cursor1 = SDL_utils::createImage((DISK_INFO_W - 2 * DIALOG_BORDER) * screen.ppu_x, LINE_HEIGHT * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_1));
+    m_cursor2 = SDL_utils::createImage((DISK_INFO_W - 2 * DIALOG_BORDER) * screen.ppu_x, LINE_HEIGHT * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_2));
+    // Centered
+    m_x = (screen.w - DISK_INFO_W) / 2;
+    m_y = (screen.h - l_height) / 2;
+}
+
+CDiskInfoDialog::~CDiskInfoDialog(void)
+{
+    if (m_image != NULL)
+    {
+        SDL_FreeSurface(m_image);
+        m_image = NULL;
+    }
+    if (m_cursor1 != NULL)
+    {
+        SDL_FreeSurface(m_cursor1);
+        m_cursor1 = NULL;
+    }
+    if (m_cursor2 != NULL)
+    {
+        SDL_FreeSurface(m_cursor2);
+        m_cursor2 = NULL;
+    }
+}
+
+const bool CDiskInfoDialog::updateMounts(void)
+{
+    std::vector<T_MOUNT> l_mounts;
+    const unsigned int l_generation = CMountList::instance().getMounts(l_mounts);
+    if (l_generation == m_generation)
+        return false;
+    // Keep the highlighted mount, or go to the one of the path
+    const std::string l_highlighted(m_highlightedLine < m_mounts.size() && static_cast<int>(m_highlightedLine) != m_current ? m_mounts[m_highlightedLine].m_mountPoint : "");
+    m_mounts.swap(l_mounts);
+    m_generation = l_generation;
+    m_current = CMountList::find(m_mounts, m_path);
+    m_highlightedLine = m_current == -1 ? 0 : m_current;
+    for (unsigned int l_i = 0; !l_highlighted.empty() && l_i < m_mounts.size(); ++l_i)
+    {
+        if (m_mounts[l_i].m_mountPoint == l_highlighted)
+            m_highlightedLine = l_i;
+    }
+    // Adjust camera
+    if (m_highlightedLine < m_camera)
+        m_camera = m_highlightedLine;
+    else if (m_highlightedLine >= m_camera + DISK_INFO_NB_MOUNTS)
+        m_camera = m_highlightedLine - DISK_INFO_NB_MOUNTS + 1;
+    if (m_camera + DISK_INFO_NB_MOUNTS > m_mounts.size())
+        m_camera = m_mounts.size() > DISK_INFO_NB_MOUNTS ? m_mounts.size() - DISK_INFO_NB_MOUNTS : 0;
+    return true;
+}
+
+void CDiskInfoDialog::render(const bool p_focus) const
+{
+    INHIBIT(std::cout << "CDiskInfoDialog::render  fullscreen: " << isFullScreen() << "  focus: " << p_focus << std::endl;)
+    CResourceManager &l_resources = CResourceManager::instance();
+    const SDL_Color l_bg = {COLOR_BG_1};
+    const Sint16 l_x = m_x + DIALOG_BORDER + DIALOG_MARGIN;
+    const Sint16 l_right = m_x + DISK_INFO_W - DIALOG_BORDER - DIALOG_MARGIN;
+    const int l_width = (l_right - l_x) * screen.ppu_x;
+    Sint16 l_y = m_y + 4;
+    // Background
+    SDL_utils::applySurface(m_x, m_y, m_image, Globals::g_screen);
+    l_resources.drawText(l_x, l_y - 1, Globals::g_screen, "Disk information:", Globals::g_colorTextTitle, {COLOR_BORDER}, 0, l_width);
+    l_y += LINE_HEIGHT;
+    if (m_mounts.empty())
+    {
+        l_resources.drawText(l_x, l_y, Globals::g_screen, m_generation ? "No file system found" : "Reading file systems...", Globals::g_colorTextNormal, l_bg, 0, l_width);
+        return;
+    }
+    // Details of the highlighted mount
+    const T_MOUNT &l_mount = m_mounts[m_highlightedLine];
+    std::ostringstream l_s;
+    l_resources.drawText(l_x, l_y, Globals::g_screen, "Size: " + File_utils::formatBytes(l_mount.m_size), Globals::g_colorTextNormal, l_bg);
+    l_s << l_mount.m_type << " " << l_mount.m_device;
+    const int l_typeWidth = l_resources.getTextWidth(l_s.str());
+    l_resources.drawText(l_right - std::min(l_typeWidth, l_width / 2) / screen.ppu_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg, 0, l_width / 2);
+    l_y += LINE_HEIGHT;
+    l_s.str("");
+    l_s << "Used: " << File_utils::formatBytes(l_mount.m_used) << " (" << UsedPercent(l_mount) << "%)";
+    l_resources.drawText(l_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    l_resources.drawText(l_x, l_y, Globals::g_screen, "Available: " + File_utils::formatBytes(l_mount.m_available), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    // Mounts, the one of the path in the directory color
+    for (unsigned int l_i = m_camera; l_i < m_camera + DISK_INFO_NB_MOUNTS && l_i < m_mounts.size(); ++l_i, l_y += LINE_HEIGHT)
+    {
+        SDL_Color l_lineBg = l_bg;
+        if (l_i == m_highlightedLine)
+        {
+            SDL_utils::applySurface(m_x + DIALOG_BORDER, l_y - 4 + DIALOG_BORDER, p_focus ? m_cursor1 : m_cursor2, Globals::g_screen);
+            l_lineBg = p_focus ? SDL_Color{COLOR_CURSOR_1} : SDL_Color{COLOR_CURSOR_2};
+        }
+        const SDL_Color &l_fg = static_cast<int>(l_i) == m_current ? Globals::g_colorTextDir : Globals::g_colorTextNormal;
+        l_s.str("");
+        l_s << UsedPercent(m_mounts[l_i]) << "%";
+        const int l_percentWidth = l_resources.getTextWidth(l_s.str());
+        l_resources.drawText(l_right - l_percentWidth / screen.ppu_x, l_y, Globals::g_screen, l_s.str(), l_fg, l_lineBg);
+        // The end of long mount points is shown
+        const int l_nameMax = l_width - l_percentWidth - 4 * screen.ppu_x;
+        const int l_nameWidth = l_resources.getTextWidth(m_mounts[l_i].m_mountPoint);
+        l_resources.drawText(l_x, l_y, Globals::g_screen, m_mounts[l_i].m_mountPoint, l_fg, l_lineBg, l_nameWidth > l_nameMax ? l_nameWidth - l_nameMax : 0, l_nameMax);
+    }
+}
+
+const bool CDiskInfoDialog::keyPress(const SDL_Event &p_event)
+{
+    CWindow::keyPress(p_event);
+    bool l_ret(false);
+    switch (p_event.key.keysym.sym)
+    {
+        case MYKEY_PARENT:
+            m_retVal = -1;
+            l_ret = true;
+            break;
+        case MYKEY_OPEN:
+            m_retVal = 1;
+            l_ret = true;
+            break;
+        case MYKEY_UP:
+            l_ret = moveCursorUp(true);
+            break;
+        case MYKEY_DOWN:
+            l_ret = moveCursorDown(true);
+            break;
+        default:
+            break;
+    }
+    return l_ret;
+}
+
+const bool CDiskInfoDialog::keyHold(void)
+{
+    bool l_ret(false);
+    switch(m_lastPressed)
+    {
+        case MYKEY_UP:
+            if (tick(SDL_GetKeyboardState(NULL)[SDL_GetScancodeFromKey(MYKEY_UP)]))
+                l_ret = moveCursorUp(false);
+            break;
+        case MYKEY_DOWN:
+            if (tick(SDL_GetKeyboardState(NULL)[SDL_GetScancodeFromKey(MYKEY_DOWN)]))
+                l_ret = moveCursorDown(false);
+            break;
+        default:
+            break;
+    }
+    return l_ret;
+}
+
+const bool CDiskInfoDialog::moveCursorUp(const bool p_loop)
+{
+    bool l_ret(false);
+    if (m_highlightedLine)
+    {
+        --m_highlightedLine;
+        if (m_highlightedLine < m_camera)
+            m_camera = m_highlightedLine;
+        l_ret = true;
+    }
+    else if (p_loop && m_highlightedLine + 1 < m_mounts.size())
+    {
+        m_highlightedLine = m_mounts.size() - 1;
+        m_camera = m_mounts.size() > DISK_INFO_NB_MOUNTS ? m_mounts.size() - DISK_INFO_NB_MOUNTS : 0;
+        l_ret = true;
+    }
+    return l_ret;
+}
+
+const bool CDiskInfoDialog::moveCursorDown(const bool p_loop)
+{
+    bool l_ret(false);
+    if (m_highlightedLine + 1 < m_mounts.size())
+    {
+        ++m_highlightedLine;
+        if (m_highlightedLine >= m_camera + DISK_INFO_NB_MOUNTS)
+            m_camera = m_highlightedLine - DISK_INFO_NB_MOUNTS + 1;
+        l_ret = true;
+    }
+    else if (p_loop && m_highlightedLine)
+    {
+        m_highlightedLine = 0;
+        m_camera = 0;
+        l_ret = true;
+    }
+    return l_ret;
+}
+
+const bool CDiskInfoDialog::update(void)
+{
+    // The background read completed
+    return updateMounts();
+}
@@ -0,0 +1,69 @@
+#ifndef _DISK_INFO_DIALOG_H_
+#define _DISK_INFO_DIALOG_H_
+
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "window.h"
+#include "mountList.h"
+
+// Usage of every mounted file system, the one of the given path highlighted
+class CDiskInfoDialog : public CWindow
+{
+    public:
+
+    // Constructor
+    CDiskInfoDialog(const std::string &p_path);
+
+    // Destructor
+    virtual ~CDiskInfoDialog(void);
+
+    private:
+
+    // Forbidden
+    CDiskInfoDialog(void);
+    CDiskInfoDialog(const CDiskInfoDialog &p_source);
+    const CDiskInfoDialog &operator =(const CDiskInfoDialog &p_source);
+
+    // Key press management
+    virtual const bool keyPress(const SDL_Event &p_event);
+
+    // Key hold management
+    virtual const bool keyHold(void);
+
+    // Periodic update
+    virtual const bool update(void);
+
+    // Draw
+    virtual void render(const bool p_focus) const;
+
+    // Get the last mounts, keeping the highlighted one
+    const bool updateMounts(void);
+
+    // Move cursor
+    const bool moveCursorUp(const bool p_loop);
+    const bool moveCursorDown(const bool p_loop);
+
+    // Path whose file system is highlighted
+    const std::string m_path;
+
+    // Mounts, and the generation they come from
+    std::vector<T_MOUNT> m_mounts;
+    unsigned int m_generation;
+    int m_current;
+
+    // Highlighted mount, and the first one displayed
+    unsigned int m_highlightedLine;
+    unsigned int m_camera;
+
+    // Images
+    SDL_Surface *m_image;
+    SDL_Surface *m_cursor1;
+    SDL_Surface *m_cursor2;
+
+    // Coordinates
+    Sint16 m_x;
+    Sint16 m_y;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <sstream>
+#include "diskUsedDialog.h"
+#include "resourceManager.h"
+#include "fileutils.h"
+#include "screen.h"
+#include "sdlutils.h"
+#include "def.h"
+
+// Refresh period of the totals, in ms
+#define DISK_USED_UPDATE_MS 200
+// Width of the dialog
+#define DISK_USED_W (screen.w * 2 / 3)
+// Lines: title, items, used, apparent size, files, status, OK
+#define DISK_USED_NB_LINES 7
+
+CDiskUsedDialog::CDiskUsedDialog(const std::vector<std::string> &p_files):
+    CWindow(),
+    m_nbItems(p_files.size()),
+    m_lastUpdate(0),
+    m_done(false),
+    m_image(NULL),
+    m_cursor1(NULL),
+    m_cursor2(NULL),
+    m_x(0),
+    m_y(0)
+{
+    m_scanner.start(p_files);
+    m_lastUpdate = SDL_GetTicks();
+    // Dialog image: title bar and background
+    const int l_height = DISK_USED_NB_LINES * LINE_HEIGHT + 2 * DIALOG_BORDER;
+    m_image = SDL_utils::createImage(DISK_USED_W * screen.ppu_x, l_height * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_BORDER));
+    {
+        SDL_Rect l_rect = SDL_utils::Rect(DIALOG_BORDER * screen.ppu_x, (DIALOG_BORDER + LINE_HEIGHT) * screen.ppu_y, (DISK_USED_W - 2 * DIALOG_BORDER) * screen.ppu_x, (l_height - 2 * DIALOG_BORDER - LINE_HEIGHT) * screen.ppu_y);
+        SDL_FillRect(m_image, &l_rect, SDL_MapRGB(m_image->format, COLOR_BG_1));
+    }
+    // Cursor images
+    m_cursor1 = SDL_utils::createImage((DISK_USED_W - 2 * DIALOG_BORDER) * screen.ppu_x, LINE_HEIGHT * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_1));
+    m_cursor2 = SDL_utils::createImage((DISK_USED_W - 2 * DIALOG_BORDER) * screen.ppu_x, LINE_HEIGHT * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_2));
+    // Centered
+    m_x = (screen.w - DISK_USED_W) / 2;
+    m_y = (screen.h - l_height) / 2;
+}
+
+CDiskUsedDialog::~CDiskUsedDialog(void)
+{
+    if (m_image != NULL)
+    {
+        SDL_FreeSurface(m_image);
+        m_image = NULL;
+    }
+    if (m_cursor1 != NULL)
+    {
+        SDL_FreeSurface(m_cursor1);
+        m_cursor1 = NULL;
+    }
+    if (m_cursor2 != NULL)
+    {
+        SDL_FreeSurface(m_cursor2);
+        m_cursor2 = NULL;
+    }
+}
+
+void CDiskUsedDialog::render(const bool p_focus) const
+{
+    INHIBIT(std::cout << "CDiskUsedDialog::render  fullscreen: " << isFullScreen() << "  focus: " << p_focus << std::endl;)
+    CResourceManager &l_resources = CResourceManager::instance();
+    const SDL_Color l_bg = {COLOR_BG_1};
+    const Sint16 l_x = m_x + DIALOG_BORDER + DIALOG_MARGIN;
+    const int l_width = (DISK_USED_W - 2 * DIALOG_BORDER - 2 * DIALOG_MARGIN) * screen.ppu_x;
+    Sint16 l_y = m_y + 4;
+    // Background
+    SDL_utils::applySurface(m_x, m_y, m_image, Globals::g_screen);
+    l_resources.drawText(l_x, l_y - 1, Globals::g_screen, "Disk used:", Globals::g_colorTextTitle, {COLOR_BORDER}, 0, l_width);
+    l_y += LINE_HEIGHT;
+    // Totals
+    std::ostringstream l_s;
+    l_s << m_nbItems << " items selected";
+    l_resources.drawText(l_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    l_resources.drawText(l_x, l_y, Globals::g_screen, "Disk used: " + File_utils::formatBytes(m_scanner.getAllocatedSize()), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    l_resources.drawText(l_x, l_y, Globals::g_screen, "Apparent size: " + File_utils::formatBytes(m_scanner.getApparentSize()), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    l_s.str("");
+    l_s << m_scanner.getNbFiles() << " files, " << m_scanner.getNbDirs() << " dirs";
+    l_resources.drawText(l_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    // Status
+    l_s.str("");
+    if (!m_done)
+        l_s << "Scanning...";
+    else if (m_scanner.getNbErrors())
+        l_s << m_scanner.getNbErrors() << " entries could not be read";
+    else if (m_scanner.getNbIndexed())
+        l_s << m_scanner.getNbIndexed() << " dirs unchanged since the last scan";
+    l_resources.drawText(l_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg, 0, l_width);
+    l_y += LINE_HEIGHT;
+    // OK
+    SDL_utils::applySurface(m_x + DIALOG_BORDER, l_y - 4 + DIALOG_BORDER, p_focus ? m_cursor1 : m_cursor2, Globals::g_screen);
+    l_resources.drawText(l_x, l_y, Globals::g_screen, "OK", Globals::g_colorTextNormal, p_focus ? SDL_Color{COLOR_CURSOR_1} : SDL_Color{COLOR_CURSOR_2});
+}
+
+const bool CDiskUsedDialog::keyPress(const SDL_Event &p_event)
+{
+    CWindow::keyPress(p_event);
+    bool l_ret(false);
+    switch (p_event.key.keysym.sym)
+    {
+        case MYKEY_PARENT:
+            m_retVal = -1;
+            l_ret = true;
+            break;
+        case MYKEY_OPEN:
+            m_retVal = 1;
+            l_ret = true;
+            break;
+        default:
+            break;
+    }
+    return l_ret;
+}
+
+const bool CDiskUsedDialog::update(void)
+{
+    // Nothing changes once the scan is done
+    if (m_done || SDL_GetTicks() - m_lastUpdate < DISK_USED_UPDATE_MS)
+        return false;
+    m_lastUpdate = SDL_GetTicks();
+    m_done = m_scanner.isDone();
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef _DISK_USED_DIALOG_H_
+#define _DISK_USED_DIALOG_H_
+
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "window.h"
+#include "sizeScanner.h"
+
+// Disk used by a selection, updated while the scan goes on
+class CDiskUsedDialog : public CWindow
+{
+    public:
+
+    // Constructor, starts the scan
+    CDiskUsedDialog(const std::vector<std::string> &p_files);
+
+    // Destructor, stops the scan
+    virtual ~CDiskUsedDialog(void);
+
+    private:
+
+    // Forbidden
+    CDiskUsedDialog(void);
+    CDiskUsedDialog(const CDiskUsedDialog &p_source);
+    const CDiskUsedDialog &operator =(const CDiskUsedDialog &p_source);
+
+    // Key press management
+    virtual const bool keyPress(const SDL_Event &p_event);
+
+    // Periodic update
+    virtual const bool update(void);
+
+    // Draw
+    virtual void render(const bool p_focus) const;
+
+    // The scan
+    CSizeScanner m_scanner;
+    const unsigned int m_nbItems;
+    Uint32 m_lastUpdate;
+    bool m_done;
+
+    // Images
+    SDL_Surface *m_image;
+    SDL_Surface *m_cursor1;
+    SDL_Surface *m_cursor2;
+
+    // Coordinates
+    Sint16 m_x;
+    Sint16 m_y;
+};
+
+#endif
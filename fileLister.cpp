@@ -1,78 +1,594 @@
 #include <iostream>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include <algorithm>
+#include <numeric>
 #include <string.h>
+#include <chrono>
 #include "fileLister.h"
+#include "fileutils.h"
 #include "sdlutils.h"
+#include "def.h"
+#include "listingCache.h"
 
-bool compareNoCase(const T_FILE& p_s1, const T_FILE& p_s2)
+// Number of entries read before a batch is published to the UI thread
+#define LISTER_BATCH_SIZE 256
+// Time list() waits for the worker before returning a partial list
+#define LISTER_SYNC_WAIT_MS 10
+// Bytes of erased names in a list above which its arena may be compacted
+#define FILE_LIST_DEAD_BYTES_MIN 4096
+
+namespace {
+
+// Classify a file name by its extension
+T_EXT_CLASS ExtClass(const char *p_name, const unsigned int p_length)
+{
+    const char *l_dot = static_cast<const char *>(memrchr(p_name, '.', p_length));
+    if (l_dot == NULL || p_name + p_length - l_dot > 8)
+        return T_EXT_OTHER;
+    std::string l_ext(l_dot + 1, p_name + p_length);
+    File_utils::asciiToLower(l_ext);
+    if (SDL_utils::isSupportedImageExt(l_ext))
+        return T_EXT_IMAGE;
+    if (l_ext == "ipk")
+        return T_EXT_IPK;
+    if (l_ext == "opk")
+        return T_EXT_OPK;
+    return T_EXT_OTHER;
+}
+
+// Fold a code point to lower case
+// Covers Latin-1, Latin Extended-A, Greek and Cyrillic
+std::uint32_t FoldCodePoint(const std::uint32_t p_c)
+{
+    if (p_c < 0x80)
+        return (p_c >= 'A' && p_c <= 'Z') ? p_c + ('a' - 'A') : p_c;
+    if (p_c >= 0xC0 && p_c <= 0xDE && p_c != 0xD7)
+        return p_c + 0x20;
+    if (p_c == 0x130)
+        return 'i';
+    if ((p_c >= 0x100 && p_c <= 0x137) || (p_c >= 0x14A && p_c <= 0x177))
+        return p_c | 1;
+    if ((p_c >= 0x139 && p_c <= 0x148) || (p_c >= 0x179 && p_c <= 0x17E))
+        return (p_c & 1) ? p_c + 1 : p_c;
+    if (p_c == 0x178)
+        return 0xFF;
+    if (p_c >= 0x391 && p_c <= 0x3AB && p_c != 0x3A2)
+        return p_c + 0x20;
+    if (p_c >= 0x400 && p_c <= 0x40F)
+        return p_c + 0x50;
+    if (p_c >= 0x410 && p_c <= 0x42F)
+        return p_c + 0x20;
+    return p_c;
+}
+
+// Append the sort key of a name to p_key
+// Keys are compared byte-wise, so that UTF-8 keys end up in code point order
+void FoldKey(const char *p_name, const unsigned int p_length, const T_SORT_MODE p_mode, std::string &p_key)
+{
+    const unsigned char *l_src = reinterpret_cast<const unsigned char *>(p_name);
+    const unsigned char *l_end = l_src + p_length;
+    if (p_mode != T_SORT_UTF8)
+    {
+        for ( ; l_src < l_end; ++l_src)
+            p_key.push_back((*l_src >= 'A' && *l_src <= 'Z') ? *l_src + ('a' - 'A') : *l_src);
+        return;
+    }
+    while (l_src < l_end)
+    {
+        // Decode, invalid sequences are kept as single bytes
+        std::uint32_t l_c = *l_src;
+        unsigned int l_len = 1;
+        if (l_c >= 0xC2 && l_c < 0xE0 && l_end - l_src >= 2 && (l_src[1] & 0xC0) == 0x80)
+        {
+            l_c = ((l_c & 0x1F) << 6) | (l_src[1] & 0x3F);
+            l_len = 2;
+        }
+        else if (l_c >= 0x80)
+        {
+            // Nothing to fold above U+07FF, or invalid byte
+            p_key.append(reinterpret_cast<const char *>(l_src), l_len);
+            l_src += l_len;
+            continue;
+        }
+        l_c = FoldCodePoint(l_c);
+        if (l_c < 0x80)
+        {
+            p_key.push_back(l_c);
+        }
+        else
+        {
+            p_key.push_back(0xC0 | (l_c >> 6));
+            p_key.push_back(0x80 | (l_c & 0x3F));
+        }
+        l_src += l_len;
+    }
+}
+
+// Compare two keys byte-wise
+int CompareBytes(const char *p_a, const std::size_t p_lenA, const char *p_b, const std::size_t p_lenB)
+{
+    const int l_cmp = memcmp(p_a, p_b, std::min(p_lenA, p_lenB));
+    if (l_cmp)
+        return l_cmp;
+    return p_lenA < p_lenB ? -1 : (p_lenA > p_lenB ? 1 : 0);
+}
+
+inline bool IsDigit(const char p_c)
+{
+    return p_c >= '0' && p_c <= '9';
+}
+
+// Compare two keys, numbers by value
+int CompareNatural(const char *p_a, const std::size_t p_lenA, const char *p_b, const std::size_t p_lenB)
+{
+    std::size_t l_i(0);
+    std::size_t l_j(0);
+    while (l_i < p_lenA && l_j < p_lenB)
+    {
+        if (IsDigit(p_a[l_i]) && IsDigit(p_b[l_j]))
+        {
+            // Skip leading zeros, then the longest number is the largest
+            while (l_i < p_lenA && p_a[l_i] == '0')
+                ++l_i;
+            while (l_j < p_lenB && p_b[l_j] == '0')
+                ++l_j;
+            std::size_t l_endA(l_i);
+            std::size_t l_endB(l_j);
+            while (l_endA < p_lenA && IsDigit(p_a[l_endA]))
+                ++l_endA;
+            while (l_endB < p_lenB && IsDigit(p_b[l_endB]))
+                ++l_endB;
+            if (l_endA - l_i != l_endB - l_j)
+                return l_endA - l_i < l_endB - l_j ? -1 : 1;
+            const int l_cmp = memcmp(p_a + l_i, p_b + l_j, l_endA - l_i);
+            if (l_cmp)
+                return l_cmp;
+            l_i = l_endA;
+            l_j = l_endB;
+        }
+        else if (p_a[l_i] != p_b[l_j])
+        {
+            return static_cast<unsigned char>(p_a[l_i]) < static_cast<unsigned char>(p_b[l_j]) ? -1 : 1;
+        }
+        else
+        {
+            ++l_i;
+            ++l_j;
+        }
+    }
+    if (l_i < p_lenA || l_j < p_lenB)
+        return l_i < p_lenA ? 1 : -1;
+    // Same value, e.g. "01" and "1" => keep a strict order
+    return CompareBytes(p_a, p_lenA, p_b, p_lenB);
+}
+
+int CompareKeys(const char *p_a, const std::size_t p_lenA, const char *p_b, const std::size_t p_lenB, const T_SORT_MODE p_mode)
+{
+    if (p_mode == T_SORT_NATURAL)
+        return CompareNatural(p_a, p_lenA, p_b, p_lenB);
+    return CompareBytes(p_a, p_lenA, p_b, p_lenB);
+}
+
+// MSD radix sort of entry indices on their keys, from byte p_depth
+// p_tmp must have room for p_last - p_first indices
+void RadixSort(std::uint32_t *p_first, std::uint32_t *p_last, std::uint32_t *p_tmp, const char *p_keys, const std::uint32_t *p_offsets, const std::uint32_t *p_lengths, const std::size_t p_depth)
+{
+    const std::size_t l_nb = p_last - p_first;
+    if (l_nb < 32)
+    {
+        // Small bucket => comparison sort on the remaining bytes
+        std::sort(p_first, p_last, [=](const std::uint32_t p_a, const std::uint32_t p_b)
+        {
+            return CompareBytes(p_keys + p_offsets[p_a] + p_depth, p_lengths[p_a] - p_depth, p_keys + p_offsets[p_b] + p_depth, p_lengths[p_b] - p_depth) < 0;
+        });
+        return;
+    }
+    // Bucket 0 is for the keys ending here
+    std::size_t l_count[258] = {0};
+    for (std::uint32_t *l_it = p_first; l_it != p_last; ++l_it)
+        ++l_count[(p_depth < p_lengths[*l_it] ? static_cast<unsigned char>(p_keys[p_offsets[*l_it] + p_depth]) + 1 : 0) + 1];
+    for (int l_b = 1; l_b < 258; ++l_b)
+        l_count[l_b] += l_count[l_b - 1];
+    for (std::uint32_t *l_it = p_first; l_it != p_last; ++l_it)
+        p_tmp[l_count[p_depth < p_lengths[*l_it] ? static_cast<unsigned char>(p_keys[p_offsets[*l_it] + p_depth]) + 1 : 0]++] = *l_it;
+    std::copy(p_tmp, p_tmp + l_nb, p_first);
+    // l_count[b] is now the end of bucket b
+    for (int l_b = 1; l_b < 257; ++l_b)
+    {
+        if (l_count[l_b] - l_count[l_b - 1] > 1)
+            RadixSort(p_first + l_count[l_b - 1], p_first + l_count[l_b], p_tmp, p_keys, p_offsets, p_lengths, p_depth + 1);
+    }
+}
+
+// Compare an entry name to a key folded with FoldKey
+int CompareToKey(const char *p_name, const std::string &p_key, const T_SORT_MODE p_mode)
 {
-    return strcasecmp(p_s1.m_name.c_str(), p_s2.m_name.c_str()) <= 0;
+    if (p_mode == T_SORT_NOCASE)
+        return strcasecmp(p_name, p_key.c_str());
+    std::string l_key;
+    FoldKey(p_name, strlen(p_name), p_mode, l_key);
+    return CompareKeys(l_key.data(), l_key.size(), p_key.data(), p_key.size(), p_mode);
 }
 
-CFileLister::CFileLister(void)
+// Find the first entry of a sorted list not before p_name, starting at p_first
+// If p_upper, find the first entry after p_name
+std::size_t boundSorted(const T_FILE_LIST &p_list, const std::size_t p_first, const std::string &p_name, const bool p_upper, const T_SORT_MODE p_mode)
+{
+    std::string l_key;
+    FoldKey(p_name.c_str(), p_name.size(), p_mode, l_key);
+    std::size_t l_low = p_first;
+    std::size_t l_high = p_list.size();
+    while (l_low < l_high)
+    {
+        const std::size_t l_mid = l_low + (l_high - l_low) / 2;
+        const int l_cmp = CompareToKey(p_list.name(l_mid), l_key, p_mode);
+        if (l_cmp < 0 || (p_upper && l_cmp == 0))
+            l_low = l_mid + 1;
+        else
+            l_high = l_mid;
+    }
+    return l_low;
+}
+
+// Find a name in a sorted list, starting at p_first
+// Returns the size of the list if not found
+std::size_t findSorted(const T_FILE_LIST &p_list, const std::size_t p_first, const std::string &p_name, const T_SORT_MODE p_mode)
+{
+    const std::size_t l_end = boundSorted(p_list, p_first, p_name, true, p_mode);
+    for (std::size_t l_i = boundSorted(p_list, p_first, p_name, false, p_mode); l_i < l_end; ++l_i)
+    {
+        if (p_name == p_list.name(l_i))
+            return l_i;
+    }
+    return p_list.size();
+}
+
+} // namespace
+
+void T_FILE_LIST::push_back(const char *p_name, const unsigned long int p_size)
+{
+    insert(size(), p_name, p_size);
+}
+
+void T_FILE_LIST::insert(const std::size_t p_i, const char *p_name, const unsigned long int p_size)
+{
+    const std::size_t l_length = strlen(p_name);
+    m_offsets.insert(m_offsets.begin() + p_i, m_arena.size());
+    m_lengths.insert(m_lengths.begin() + p_i, l_length);
+    m_extClasses.insert(m_extClasses.begin() + p_i, ExtClass(p_name, l_length));
+    m_sizes.insert(m_sizes.begin() + p_i, p_size);
+    m_arena.insert(m_arena.end(), p_name, p_name + l_length + 1);
+}
+
+void T_FILE_LIST::erase(const std::size_t p_i)
+{
+    m_deadBytes += m_lengths[p_i] + 1;
+    m_offsets.erase(m_offsets.begin() + p_i);
+    m_lengths.erase(m_lengths.begin() + p_i);
+    m_extClasses.erase(m_extClasses.begin() + p_i);
+    m_sizes.erase(m_sizes.begin() + p_i);
+    // Compact the arena when erased names take too much of it
+    if (m_deadBytes > FILE_LIST_DEAD_BYTES_MIN && m_deadBytes > m_arena.size() / 2)
+    {
+        INHIBIT(std::cout << "T_FILE_LIST::erase: compact " << m_arena.size() << " bytes, " << m_deadBytes << " unused" << std::endl;)
+        std::vector<std::uint32_t> l_order(size());
+        std::iota(l_order.begin(), l_order.end(), 0);
+        gather(l_order);
+    }
+}
+
+void T_FILE_LIST::append(const T_FILE_LIST &p_source, const std::size_t p_first)
+{
+    const std::size_t l_nb = p_source.size() - p_first;
+    m_offsets.reserve(m_offsets.size() + l_nb);
+    for (std::size_t l_i = p_first; l_i < p_source.size(); ++l_i)
+    {
+        m_offsets.push_back(m_arena.size());
+        m_arena.insert(m_arena.end(), p_source.name(l_i), p_source.name(l_i) + p_source.m_lengths[l_i] + 1);
+    }
+    m_lengths.insert(m_lengths.end(), p_source.m_lengths.begin() + p_first, p_source.m_lengths.end());
+    m_extClasses.insert(m_extClasses.end(), p_source.m_extClasses.begin() + p_first, p_source.m_extClasses.end());
+    m_sizes.insert(m_sizes.end(), p_source.m_sizes.begin() + p_first, p_source.m_sizes.end());
+}
+
+void T_FILE_LIST::sort(const std::size_t p_first, const T_SORT_MODE p_mode)
+{
+    if (size() <= p_first + 1)
+        return;
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    // Fold the sort keys once
+    std::string l_keys;
+    std::vector<std::uint32_t> l_keyOffsets(size());
+    std::vector<std::uint32_t> l_keyLengths(size());
+    l_keys.reserve(m_arena.size());
+    for (std::size_t l_i = 0; l_i < size(); ++l_i)
+    {
+        l_keyOffsets[l_i] = l_keys.size();
+        FoldKey(name(l_i), m_lengths[l_i], p_mode, l_keys);
+        l_keyLengths[l_i] = l_keys.size() - l_keyOffsets[l_i];
+    }
+    // Sort a permutation of the entries
+    std::vector<std::uint32_t> l_order(size());
+    std::iota(l_order.begin(), l_order.end(), 0);
+    if (p_mode == T_SORT_NATURAL)
+    {
+        const char *l_keyData = l_keys.data();
+        std::sort(l_order.begin() + p_first, l_order.end(), [&](const std::uint32_t p_a, const std::uint32_t p_b)
+        {
+            return CompareNatural(l_keyData + l_keyOffsets[p_a], l_keyLengths[p_a], l_keyData + l_keyOffsets[p_b], l_keyLengths[p_b]) < 0;
+        });
+    }
+    else
+    {
+        std::vector<std::uint32_t> l_tmp(size() - p_first);
+        RadixSort(l_order.data() + p_first, l_order.data() + size(), l_tmp.data(), l_keys.data(), l_keyOffsets.data(), l_keyLengths.data(), 0);
+    }
+    gather(l_order);
+    INHIBIT(std::cout << "T_FILE_LIST::sort: " << size() << " entries in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+}
+
+void T_FILE_LIST::gather(const std::vector<std::uint32_t> &p_order)
+{
+    // Gather the arrays, names in order
+    T_FILE_LIST l_sorted;
+    l_sorted.m_arena.reserve(m_arena.size() - m_deadBytes);
+    l_sorted.m_offsets.reserve(size());
+    l_sorted.m_lengths.reserve(size());
+    l_sorted.m_extClasses.reserve(size());
+    l_sorted.m_sizes.reserve(size());
+    for (std::vector<std::uint32_t>::const_iterator l_it = p_order.begin(); l_it != p_order.end(); ++l_it)
+    {
+        l_sorted.m_offsets.push_back(l_sorted.m_arena.size());
+        l_sorted.m_arena.insert(l_sorted.m_arena.end(), name(*l_it), name(*l_it) + m_lengths[*l_it] + 1);
+        l_sorted.m_lengths.push_back(m_lengths[*l_it]);
+        l_sorted.m_extClasses.push_back(m_extClasses[*l_it]);
+        l_sorted.m_sizes.push_back(m_sizes[*l_it]);
+    }
+    swap(l_sorted);
+}
+
+void T_FILE_LIST::resetSizes(void)
+{
+    std::fill(m_sizes.begin(), m_sizes.end(), SIZE_UNKNOWN);
+}
+
+void T_FILE_LIST::clear(void)
+{
+    m_arena.clear();
+    m_deadBytes = 0;
+    m_offsets.clear();
+    m_lengths.clear();
+    m_extClasses.clear();
+    m_sizes.clear();
+}
+
+void T_FILE_LIST::swap(T_FILE_LIST &p_other)
+{
+    m_arena.swap(p_other.m_arena);
+    std::swap(m_deadBytes, p_other.m_deadBytes);
+    m_offsets.swap(p_other.m_offsets);
+    m_lengths.swap(p_other.m_lengths);
+    m_extClasses.swap(p_other.m_extClasses);
+    m_sizes.swap(p_other.m_sizes);
+}
+
+const std::size_t T_FILE_LIST::bytes(void) const
+{
+    return m_arena.capacity() + m_offsets.capacity() * sizeof(std::uint32_t) + m_lengths.capacity() * sizeof(std::uint16_t) + m_extClasses.capacity() + m_sizes.capacity() * sizeof(unsigned long int);
+}
+
+CFileLister::CFileLister(void) :
+    m_done(false),
+    m_loading(false),
+    m_cancel(false),
+    m_dirFd(-1),
+    m_sortMode(T_SORT_NOCASE)
 {
 }
 
 CFileLister::~CFileLister(void)
 {
+    stopWorker();
+    if (m_dirFd != -1)
+        close(m_dirFd);
 }
 
 const bool CFileLister::list(const std::string &p_path)
 {
     // Open dir
-    DIR *l_dir = opendir(p_path.c_str());
-    if (l_dir == NULL)
+    const int l_dirFd = open(p_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat l_stat;
+    if (l_dirFd == -1 || fstat(l_dirFd, &l_stat) == -1)
     {
         std::cerr << "CFileLister::list: Error opening dir " << p_path << std::endl;
+        if (l_dirFd != -1)
+            close(l_dirFd);
         return false;
     }
+    // Stop reading the previous dir
+    stopWorker();
     // Clean up
     m_listFiles.clear();
     m_listDirs.clear();
+    m_pendingDirs.clear();
+    m_pendingFiles.clear();
+    m_sortedDirs.clear();
+    m_sortedFiles.clear();
+    // Keep a descriptor on the dir to resolve sizes later
+    if (m_dirFd != -1)
+        close(m_dirFd);
+    m_dirFd = l_dirFd;
+    // Unchanged dir => no need to read it again
+    if (CListingCache::instance().get(p_path, l_stat, m_sortMode, m_listDirs, m_listFiles))
+        return true;
+    // The worker reads its own descriptor, closedir() closes it
+    const int l_readFd = fcntl(l_dirFd, F_DUPFD_CLOEXEC, 0);
+    DIR *l_dir = l_readFd == -1 ? NULL : fdopendir(l_readFd);
+    if (l_dir == NULL)
+    {
+        std::cerr << "CFileLister::list: Error opening dir " << p_path << std::endl;
+        if (l_readFd != -1)
+            close(l_readFd);
+        close(m_dirFd);
+        m_dirFd = -1;
+        return false;
+    }
+    // Add "..", always at the first place
+    m_listDirs.push_back("..", 0);
+    // Read dir in the background
+    m_done = false;
+    m_loading = true;
+    m_cancel = false;
+    m_worker = std::thread(&CFileLister::readDir, this, l_dir, p_path, l_stat, m_sortMode);
+    // Give the worker a moment, so that small dirs are displayed at once
+    {
+        std::unique_lock<std::mutex> l_lock(m_mutex);
+        m_doneCondition.wait_for(l_lock, std::chrono::milliseconds(LISTER_SYNC_WAIT_MS), [this] { return m_done; });
+    }
+    update();
+    return true;
+}
+
+void CFileLister::readDir(DIR *p_dir, const std::string p_path, const struct stat p_stat, const T_SORT_MODE p_mode)
+{
+    T_FILE_LIST l_dirs;
+    T_FILE_LIST l_files;
+    std::size_t l_publishedDirs(0);
+    std::size_t l_publishedFiles(0);
+    // "..", always at the first place
+    l_dirs.push_back("..", 0);
+    ++l_publishedDirs;
     // Read dir
-    std::string l_file("");
-    std::string l_fileFull("");
+    // Entries are classified with d_type when the file system provides it.
+    // fstatat() relative to the open dir is only used for unknown types and
+    // symbolic links (which may point to a dir). Sizes are resolved on demand.
+    const int l_dirFd = dirfd(p_dir);
     struct stat l_stat;
-    struct dirent *l_dirent = readdir(l_dir);
-    while (l_dirent != NULL)
+    struct dirent *l_dirent = readdir(p_dir);
+    while (l_dirent != NULL && !m_cancel)
     {
-        l_file = l_dirent->d_name;
+        const char *l_file = l_dirent->d_name;
         // Filter the '.' and '..' dirs
-        if (l_file != "." && l_file != "..")
+        if (strcmp(l_file, ".") != 0 && strcmp(l_file, "..") != 0)
         {
-            // Stat the file
-            l_fileFull = p_path + "/" + l_file;
-            if (stat(l_fileFull.c_str(), &l_stat) == -1)
+            if (l_dirent->d_type == DT_DIR)
             {
-                std::cerr << "CFileLister::list: Error stat " << l_fileFull << std::endl;
+                // It's a directory, its size is never displayed
+                l_dirs.push_back(l_file, 0);
+            }
+            else if (l_dirent->d_type != DT_UNKNOWN && l_dirent->d_type != DT_LNK)
+            {
+                // It's a file, size will be resolved when needed
+                l_files.push_back(l_file);
+            }
+            else if (fstatat(l_dirFd, l_file, &l_stat, 0) == -1)
+            {
+                std::cerr << "CFileLister::list: Error stat " << p_path << "/" << l_file << std::endl;
             }
             else
             {
                 // Check type
                 if (S_ISDIR(l_stat.st_mode))
                     // It's a directory
-                    m_listDirs.push_back(T_FILE(l_file, l_stat.st_size));
+                    l_dirs.push_back(l_file, l_stat.st_size);
                 else
                     // It's a file
-                    m_listFiles.push_back(T_FILE(l_file, l_stat.st_size));
+                    l_files.push_back(l_file, l_stat.st_size);
+            }
+            // Publish a batch of entries for progressive display
+            if (l_dirs.size() + l_files.size() - l_publishedDirs - l_publishedFiles >= LISTER_BATCH_SIZE)
+            {
+                std::lock_guard<std::mutex> l_lock(m_mutex);
+                m_pendingDirs.append(l_dirs, l_publishedDirs);
+                m_pendingFiles.append(l_files, l_publishedFiles);
+                l_publishedDirs = l_dirs.size();
+                l_publishedFiles = l_files.size();
             }
         }
         // Next
-        l_dirent = readdir(l_dir);
+        l_dirent = readdir(p_dir);
     }
     // Close dir
-    closedir(l_dir);
+    closedir(p_dir);
+    INHIBIT(std::cout << "CFileLister::list: " << p_path << ": " << l_dirs.size() - 1 << " dirs, " << l_files.size() << " files" << std::endl;)
     // Sort lists
-    sort(m_listFiles.begin(), m_listFiles.end(), compareNoCase);
-    sort(m_listDirs.begin(), m_listDirs.end(), compareNoCase);
-    // Add "..", always at the first place
-    m_listDirs.insert(m_listDirs.begin(), T_FILE("..", 0));
-    return true;
+    if (!m_cancel)
+    {
+        l_files.sort(0, p_mode);
+        l_dirs.sort(1, p_mode);
+        CListingCache::instance().put(p_path, p_stat, p_mode, l_dirs, l_files);
+    }
+    // Hand over the final lists
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_sortedDirs.swap(l_dirs);
+        m_sortedFiles.swap(l_files);
+        m_done = true;
+    }
+    m_doneCondition.notify_all();
 }
 
-const T_FILE &CFileLister::operator[](const unsigned int p_i) const
+const bool CFileLister::update(void)
+{
+    if (!m_loading)
+        return false;
+    bool l_ret(false);
+    T_FILE_LIST l_dirs;
+    T_FILE_LIST l_files;
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        if (m_done)
+        {
+            // Enumeration complete => replace by the sorted lists
+            // The unsorted ones are freed, not only cleared
+            m_listDirs.swap(m_sortedDirs);
+            m_listFiles.swap(m_sortedFiles);
+            T_FILE_LIST().swap(m_sortedDirs);
+            T_FILE_LIST().swap(m_sortedFiles);
+            T_FILE_LIST().swap(m_pendingDirs);
+            T_FILE_LIST().swap(m_pendingFiles);
+            m_loading = false;
+            l_ret = true;
+        }
+        else
+        {
+            l_dirs.swap(m_pendingDirs);
+            l_files.swap(m_pendingFiles);
+        }
+    }
+    if (!m_loading)
+    {
+        m_worker.join();
+    }
+    else if (!l_dirs.empty() || !l_files.empty())
+    {
+        // Append the batch, unsorted until enumeration completes
+        m_listDirs.append(l_dirs, 0);
+        m_listFiles.append(l_files, 0);
+        l_ret = true;
+    }
+    return l_ret;
+}
+
+const bool CFileLister::isLoading(void) const
+{
+    return m_loading;
+}
+
+void CFileLister::stopWorker(void)
+{
+    if (m_worker.joinable())
+    {
+        m_cancel = true;
+        m_worker.join();
+    }
+    m_loading = false;
+}
+
+const T_FILE CFileLister::operator[](const unsigned int p_i) const
 {
     if (p_i < m_listDirs.size())
         return m_listDirs[p_i];
@@ -80,6 +596,27 @@ const T_FILE &CFileLister::operator[](const unsigned int p_i) const
         return m_listFiles[p_i - m_listDirs.size()];
 }
 
+const unsigned long int CFileLister::getSize(const unsigned int p_i) const
+{
+    const T_FILE_LIST &l_list = p_i < m_listDirs.size() ? m_listDirs : m_listFiles;
+    const std::size_t l_i = p_i < m_listDirs.size() ? p_i : p_i - m_listDirs.size();
+    unsigned long int &l_size = l_list.fileSize(l_i);
+    if (l_size == T_FILE_LIST::SIZE_UNKNOWN)
+    {
+        struct stat l_stat;
+        if (m_dirFd != -1 && fstatat(m_dirFd, l_list.name(l_i), &l_stat, 0) == 0)
+        {
+            l_size = l_stat.st_size;
+        }
+        else
+        {
+            std::cerr << "CFileLister::getSize: Error stat " << l_list.name(l_i) << std::endl;
+            l_size = 0;
+        }
+    }
+    return l_size;
+}
+
 const unsigned int CFileLister::getNbDirs(void) const
 {
     return m_listDirs.size();
@@ -105,12 +642,91 @@ const unsigned int CFileLister::searchDir(const std::string &p_name) const
     unsigned int l_ret = 0;
     bool l_found = false;
     // Search name in dirs
-    for (std::vector<T_FILE>::const_iterator l_it = m_listDirs.begin(); (!l_found) && (l_it != m_listDirs.end()); ++l_it)
+    for (std::size_t l_i = 0; (!l_found) && (l_i < m_listDirs.size()); ++l_i)
     {
-        if ((*l_it).m_name == p_name)
+        if (p_name == m_listDirs.name(l_i))
             l_found = true;
         else
             ++l_ret;
     }
     return l_found ? l_ret : 0;
 }
+
+const unsigned int CFileLister::search(const std::string &p_name) const
+{
+    if (!m_loading)
+    {
+        // Lists are sorted => binary search
+        std::size_t l_i = findSorted(m_listDirs, 1, p_name, m_sortMode);
+        if (l_i < m_listDirs.size())
+            return l_i;
+        l_i = findSorted(m_listFiles, 0, p_name, m_sortMode);
+        if (l_i < m_listFiles.size())
+            return m_listDirs.size() + l_i;
+        return 0;
+    }
+    const unsigned int l_nb = getNbTotal();
+    for (unsigned int l_i = 0; l_i < l_nb; ++l_i)
+    {
+        if (p_name == (*this)[l_i].m_name)
+            return l_i;
+    }
+    return 0;
+}
+
+const T_ENTRY_CHANGE CFileLister::addEntry(const std::string &p_name)
+{
+    if (m_loading || m_dirFd == -1)
+        return T_ENTRY_UNCHANGED;
+    struct stat l_stat;
+    if (fstatat(m_dirFd, p_name.c_str(), &l_stat, 0) == -1)
+        // Already gone
+        return removeEntry(p_name) ? T_ENTRY_LISTED : T_ENTRY_UNCHANGED;
+    const bool l_isDir = S_ISDIR(l_stat.st_mode);
+    T_FILE_LIST &l_list = l_isDir ? m_listDirs : m_listFiles;
+    const std::size_t l_first = l_isDir ? 1 : 0;
+    std::size_t l_i = findSorted(l_list, l_first, p_name, m_sortMode);
+    if (l_i < l_list.size())
+    {
+        // Already listed => just update the size
+        l_list.fileSize(l_i) = l_isDir ? 0 : l_stat.st_size;
+        return T_ENTRY_MODIFIED;
+    }
+    // The type may have changed
+    T_FILE_LIST &l_other = l_isDir ? m_listFiles : m_listDirs;
+    l_i = findSorted(l_other, l_isDir ? 0 : 1, p_name, m_sortMode);
+    if (l_i < l_other.size())
+        l_other.erase(l_i);
+    // Insert at the sorted position
+    l_list.insert(boundSorted(l_list, l_first, p_name, true, m_sortMode), p_name.c_str(), l_isDir ? 0 : l_stat.st_size);
+    return T_ENTRY_LISTED;
+}
+
+const bool CFileLister::removeEntry(const std::string &p_name)
+{
+    if (m_loading)
+        return false;
+    std::size_t l_i = findSorted(m_listDirs, 1, p_name, m_sortMode);
+    if (l_i < m_listDirs.size())
+    {
+        m_listDirs.erase(l_i);
+        return true;
+    }
+    l_i = findSorted(m_listFiles, 0, p_name, m_sortMode);
+    if (l_i < m_listFiles.size())
+    {
+        m_listFiles.erase(l_i);
+        return true;
+    }
+    return false;
+}
+
+const T_SORT_MODE CFileLister::getSortMode(void) const
+{
+    return m_sortMode;
+}
+
+void CFileLister::setSortMode(const T_SORT_MODE p_mode)
+{
+    m_sortMode = p_mode;
+}
@@ -3,21 +3,119 @@
 
 #include <vector>
 #include <string>
-#include "fileutils.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <dirent.h>
+#include <sys/stat.h>
 
-// Class used to store file info
+// Extension classes, computed once per entry
+typedef enum
+{
+    T_EXT_OTHER = 0,
+    T_EXT_IMAGE,
+    T_EXT_IPK,
+    T_EXT_OPK
+}
+T_EXT_CLASS;
+
+// Sort orders
+typedef enum
+{
+    // Case insensitive, ASCII only (strcasecmp order)
+    T_SORT_NOCASE = 0,
+    // Case insensitive, numbers compared by value ("file2" < "file10")
+    T_SORT_NATURAL,
+    // Case insensitive for Latin, Greek and Cyrillic letters, code point order
+    T_SORT_UTF8
+}
+T_SORT_MODE;
+
+// Effect of a change made in a listed dir
+typedef enum
+{
+    T_ENTRY_UNCHANGED = 0,
+    // Same entries, one was written to or its attributes changed
+    T_ENTRY_MODIFIED,
+    // An entry was added, removed, or changed type
+    T_ENTRY_LISTED
+}
+T_ENTRY_CHANGE;
+
+// View on an entry of a T_FILE_LIST
+// The name is valid until the list is modified
 struct T_FILE
 {
-    T_FILE(void) : m_size(0) {}
-    T_FILE(const std::string &p_name, const unsigned long int &p_size)
+    T_FILE(const char *p_name, const unsigned int p_length, const T_EXT_CLASS p_extClass)
         : m_name(p_name),
-          m_ext(File_utils::getLowercaseFileExtension(p_name)),
-          m_size(p_size) {}
-    T_FILE(const T_FILE &p_source) = default;
-    T_FILE &operator=(const T_FILE &p_source) = default;
-    std::string m_name;
-    std::string m_ext;
-    unsigned long int m_size;
+          m_length(p_length),
+          m_extClass(p_extClass) {}
+    const char *m_name;
+    unsigned int m_length;
+    T_EXT_CLASS m_extClass;
+};
+
+// List of entries, stored as a struct of arrays
+// All names are in one contiguous arena, NUL-terminated
+class T_FILE_LIST
+{
+    public:
+
+    // Size not resolved yet, see CFileLister::getSize
+    static const unsigned long int SIZE_UNKNOWN = static_cast<unsigned long int>(-1);
+
+    T_FILE_LIST(void) : m_deadBytes(0) {}
+
+    // Number of entries
+    const std::size_t size(void) const { return m_offsets.size(); }
+    const bool empty(void) const { return m_offsets.empty(); }
+
+    // Accessors
+    const char *name(const std::size_t p_i) const { return m_arena.data() + m_offsets[p_i]; }
+    const unsigned int length(const std::size_t p_i) const { return m_lengths[p_i]; }
+    const T_EXT_CLASS extClass(const std::size_t p_i) const { return static_cast<T_EXT_CLASS>(m_extClasses[p_i]); }
+    const T_FILE operator[](const std::size_t p_i) const { return T_FILE(name(p_i), m_lengths[p_i], extClass(p_i)); }
+    unsigned long int &fileSize(const std::size_t p_i) const { return m_sizes[p_i]; }
+
+    // Add an entry at the end, or at the given position
+    void push_back(const char *p_name, const unsigned long int p_size = SIZE_UNKNOWN);
+    void insert(const std::size_t p_i, const char *p_name, const unsigned long int p_size = SIZE_UNKNOWN);
+
+    // Remove an entry
+    // Its name stays in the arena, which is compacted once too much of it is unused
+    void erase(const std::size_t p_i);
+
+    // Add the entries from p_first to the end of another list
+    void append(const T_FILE_LIST &p_source, const std::size_t p_first);
+
+    // Sort the entries from p_first to the end
+    // The arena is rebuilt in the sorted order
+    void sort(const std::size_t p_first, const T_SORT_MODE p_mode);
+
+    // Forget all sizes
+    void resetSizes(void);
+
+    void clear(void);
+    void swap(T_FILE_LIST &p_other);
+
+    // Approximate memory used by the list
+    const std::size_t bytes(void) const;
+
+    private:
+
+    // Rebuild the arrays and the arena in the given order of the entries
+    void gather(const std::vector<std::uint32_t> &p_order);
+
+    std::vector<char> m_arena;
+    // Bytes of the arena used by erased names
+    std::size_t m_deadBytes;
+    std::vector<std::uint32_t> m_offsets;
+    std::vector<std::uint16_t> m_lengths;
+    std::vector<std::uint8_t> m_extClasses;
+    // Sizes are memoized by CFileLister::getSize
+    mutable std::vector<unsigned long int> m_sizes;
 };
 
 class CFileLister
@@ -32,10 +130,22 @@ class CFileLister
 
     // Read the contents of the given path
     // Returns false if the path does not exist
+    // Entries are read by a worker thread. Small dirs are complete on return,
+    // otherwise the list is populated progressively by update().
     const bool list(const std::string &p_path);
 
+    // Merge the entries read by the worker thread
+    // Returns true if the list changed
+    const bool update(void);
+
+    // True while the worker thread is reading the dir
+    const bool isLoading(void) const;
+
     // Get an element in the list (dirs and files combined)
-    const T_FILE &operator[](const unsigned int p_i) const;
+    const T_FILE operator[](const unsigned int p_i) const;
+
+    // Get the size of an element, stat'ed on first access only
+    const unsigned long int getSize(const unsigned int p_i) const;
 
     // Get the number of dirs/files
     const unsigned int getNbDirs(void) const;
@@ -48,15 +158,51 @@ class CFileLister
     // Get index of the given dir name, 0 if not found
     const unsigned int searchDir(const std::string &p_name) const;
 
+    // Get index of the given dir or file name, 0 if not found
+    const unsigned int search(const std::string &p_name) const;
+
+    // Apply a change made in the listed dir, keeping the lists sorted
+    const T_ENTRY_CHANGE addEntry(const std::string &p_name);
+    // Returns true if the list changed
+    const bool removeEntry(const std::string &p_name);
+
+    // Sort order, list() must be called after a change
+    const T_SORT_MODE getSortMode(void) const;
+    void setSortMode(const T_SORT_MODE p_mode);
+
     private:
 
     // Forbidden
     CFileLister(const CFileLister &p_source);
     const CFileLister &operator =(const CFileLister &p_source);
 
+    // Worker thread
+    void readDir(DIR *p_dir, const std::string p_path, const struct stat p_stat, const T_SORT_MODE p_mode);
+
+    // Stop the worker thread, if any
+    void stopWorker(void);
+
     // The list of files/dir
-    std::vector<T_FILE> m_listDirs;
-    std::vector<T_FILE> m_listFiles;
+    T_FILE_LIST m_listDirs;
+    T_FILE_LIST m_listFiles;
+
+    // Worker thread and its results, protected by m_mutex
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_doneCondition;
+    T_FILE_LIST m_pendingDirs;
+    T_FILE_LIST m_pendingFiles;
+    T_FILE_LIST m_sortedDirs;
+    T_FILE_LIST m_sortedFiles;
+    bool m_done;
+    bool m_loading;
+    std::atomic<bool> m_cancel;
+
+    // Descriptor of the listed dir, for lazy fstatat() calls
+    int m_dirFd;
+
+    // Sort order of the lists
+    T_SORT_MODE m_sortMode;
 };
 
 #endif
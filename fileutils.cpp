@@ -9,14 +9,20 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <cerrno>
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <sstream>
 #include <unistd.h>
 #include "fileutils.h"
+#include "copyEngine.h"
+#include "deleteEngine.h"
 #include "def.h"
 #include "dialog.h"
+#include "diskInfoDialog.h"
+#include "diskUsedDialog.h"
 #include "sdlutils.h"
 
 namespace {
@@ -97,143 +103,144 @@ bool Run(Args... args)
 
 } // namespace
 
-void File_utils::copyFile(const std::vector<std::string> &p_src, const std::string &p_dest)
+namespace {
+
+// Set the item being processed
+void SetCurrent(T_PROGRESS *p_progress, const std::string &p_item)
+{
+    if (p_progress == NULL)
+        return;
+    std::lock_guard<std::mutex> l_lock(p_progress->m_mutex);
+    p_progress->m_current = File_utils::getFileName(p_item);
+}
+
+} // namespace
+
+const bool File_utils::confirmOverwrite(const std::vector<std::string> &p_src, const std::string &p_dest, std::vector<std::string> &p_confirmed)
 {
     std::string l_destFile;
     std::string l_fileName;
-    bool l_loop(true);
     bool l_confirm(true);
-    bool l_execute(true);
-    for (std::vector<std::string>::const_iterator l_it = p_src.begin(); l_loop && (l_it != p_src.end()); ++l_it)
+    p_confirmed.clear();
+    for (std::vector<std::string>::const_iterator l_it = p_src.begin(); l_it != p_src.end(); ++l_it)
     {
-        l_execute = true;
         l_fileName = getFileName(*l_it);
         l_destFile = p_dest + (p_dest.at(p_dest.size() - 1) == '/' ? "" : "/") + l_fileName;
-
         // Check if destination files already exists
-        if (l_confirm)
+        if (l_confirm && fileExists(l_destFile))
         {
-            if (fileExists(l_destFile))
+            INHIBIT(std::cout << "File " << l_destFile << " already exists => ask for confirmation" << std::endl;)
+            CDialog l_dialog("Question:", 0, 0);
+            l_dialog.addLabel("Overwrite " + l_fileName + "?");
+            l_dialog.addOption("Yes");
+            l_dialog.addOption("Yes to all");
+            l_dialog.addOption("No");
+            l_dialog.addOption("Cancel");
+            l_dialog.init();
+            switch (l_dialog.execute())
             {
-                INHIBIT(std::cout << "File " << l_destFile << " already exists => ask for confirmation" << std::endl;)
-                CDialog l_dialog("Question:", 0, 0);
-                l_dialog.addLabel("Overwrite " + l_fileName + "?");
-                l_dialog.addOption("Yes");
-                l_dialog.addOption("Yes to all");
-                l_dialog.addOption("No");
-                l_dialog.addOption("Cancel");
-                l_dialog.init();
-                switch (l_dialog.execute())
-                {
-                    case 1:
-                        // Yes
-                        break;
-                    case 2:
-                        // Yes to all
-                        l_confirm = false;
-                        break;
-                    case 3:
-                        // No
-                        l_execute = false;
-                        break;
-                    default:
-                        // Cancel
-                        l_execute = false;
-                        l_loop = false;
-                        break;
-                }
+                case 1:
+                    // Yes
+                    break;
+                case 2:
+                    // Yes to all
+                    l_confirm = false;
+                    break;
+                case 3:
+                    // No
+                    continue;
+                default:
+                    // Cancel
+                    p_confirmed.clear();
+                    return false;
             }
         }
-        if (l_execute)
-        {
-            Run("cp", "-r", *l_it, p_dest);
-            Run("sync", l_destFile);
-        }
+        p_confirmed.push_back(*l_it);
     }
+    return true;
 }
 
-void File_utils::moveFile(const std::vector<std::string> &p_src, const std::string &p_dest)
+const bool File_utils::copyFile(const std::vector<std::string> &p_src, const std::string &p_dest, T_PROGRESS *p_progress)
 {
-    std::string l_destFile;
-    std::string l_fileName;
-    bool l_loop(true);
-    bool l_confirm(true);
-    bool l_execute(true);
-    for (std::vector<std::string>::const_iterator l_it = p_src.begin(); l_loop && (l_it != p_src.end()); ++l_it)
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    CCopyEngine l_engine;
+    l_engine.setProgress(p_progress);
+    bool l_ret(true);
+    for (std::vector<std::string>::const_iterator l_it = p_src.begin(); l_it != p_src.end(); ++l_it)
     {
-        l_execute = true;
-        // Check if destination files already exists
-        if (l_confirm)
-        {
-            l_fileName = getFileName(*l_it);
-            l_destFile = p_dest + (p_dest.at(p_dest.size() - 1) == '/' ? "" : "/") + l_fileName;
-            if (fileExists(l_destFile))
-            {
-                INHIBIT(std::cout << "File " << l_destFile << " already exists => ask for confirmation" << std::endl;)
-                CDialog l_dialog("Question:", 0, 0);
-                l_dialog.addLabel("Overwrite " + l_fileName + "?");
-                l_dialog.addOption("Yes");
-                l_dialog.addOption("Yes to all");
-                l_dialog.addOption("No");
-                l_dialog.addOption("Cancel");
-                l_dialog.init();
-                switch (l_dialog.execute())
-                {
-                    case 1:
-                        // Yes
-                        break;
-                    case 2:
-                        // Yes to all
-                        l_confirm = false;
-                        break;
-                    case 3:
-                        // No
-                        l_execute = false;
-                        break;
-                    default:
-                        // Cancel
-                        l_execute = false;
-                        l_loop = false;
-                        break;
-                }
-            }
-        }
-        if (l_execute)
-        {
-            Run("mv", *l_it, p_dest);
-            Run("sync", p_dest);
-        }
+        if (p_progress != NULL && p_progress->m_cancel)
+            break;
+        SetCurrent(p_progress, *l_it);
+        l_ret = l_engine.copy(*l_it, p_dest) && l_ret;
+    }
+    // Flush once for all files
+    l_engine.sync();
+    INHIBIT(std::cout << "File_utils::copyFile: " << l_engine.getNbFiles() << " files, " << l_engine.getNbBytes() << " bytes in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    return l_ret;
+}
+
+const bool File_utils::moveFile(const std::vector<std::string> &p_src, const std::string &p_dest, T_PROGRESS *p_progress)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    CCopyEngine l_engine;
+    l_engine.setProgress(p_progress);
+    bool l_ret(true);
+    for (std::vector<std::string>::const_iterator l_it = p_src.begin(); l_it != p_src.end(); ++l_it)
+    {
+        if (p_progress != NULL && p_progress->m_cancel)
+            break;
+        SetCurrent(p_progress, *l_it);
+        l_ret = l_engine.move(*l_it, p_dest) && l_ret;
     }
+    // Flush once for all files
+    l_engine.sync();
+    INHIBIT(std::cout << "File_utils::moveFile: " << l_engine.getNbFiles() << " files, " << l_engine.getNbBytes() << " bytes copied in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    return l_ret;
 }
 
 void File_utils::renameFile(const std::string &p_file1, const std::string &p_file2)
 {
-    bool l_execute(true);
-    // Check if destination files already exists
-    if (fileExists(p_file2))
+    CCopyEngine l_engine;
+    // An existing dir is where the file goes, like "mv"
+    // unless it's the same entry, e.g. a change of case
+    std::string l_dest(p_file2);
+    struct stat l_stat1;
+    struct stat l_stat2;
+    if (stat(p_file2.c_str(), &l_stat2) == 0 && S_ISDIR(l_stat2.st_mode)
+        && !(lstat(p_file1.c_str(), &l_stat1) == 0 && l_stat1.st_dev == l_stat2.st_dev && l_stat1.st_ino == l_stat2.st_ino))
+        l_dest = p_file2 + "/" + getFileName(p_file1);
+    // The destination is not replaced without confirmation, even if it appears meanwhile
+    if (!l_engine.moveTo(p_file1, l_dest, false) && errno == EEXIST)
     {
-        INHIBIT(std::cout << "File " << p_file2 << " already exists => ask for confirmation" << std::endl;)
+        INHIBIT(std::cout << "File " << l_dest << " already exists => ask for confirmation" << std::endl;)
+        // Two dirs are merged
+        const bool l_merge = lstat(p_file1.c_str(), &l_stat1) == 0 && S_ISDIR(l_stat1.st_mode) && lstat(l_dest.c_str(), &l_stat2) == 0 && S_ISDIR(l_stat2.st_mode);
         CDialog l_dialog("Question:", 0, 0);
-        l_dialog.addLabel("Overwrite " + getFileName(p_file2) + "?");
+        l_dialog.addLabel((l_merge ? "Merge into " : "Overwrite ") + getFileName(l_dest) + "?");
         l_dialog.addOption("Yes");
         l_dialog.addOption("No");
         l_dialog.init();
-        if (l_dialog.execute() != 1)
-            l_execute = false;
-    }
-    if (l_execute)
-    {
-        Run("mv", p_file1, p_file2);
-        Run("sync", p_file2);
+        if (l_dialog.execute() == 1)
+            l_engine.moveTo(p_file1, l_dest);
     }
+    l_engine.sync();
 }
 
-void File_utils::removeFile(const std::vector<std::string> &p_files)
+const bool File_utils::removeFile(const std::vector<std::string> &p_files, T_PROGRESS *p_progress)
 {
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    CDeleteEngine l_engine;
+    l_engine.setProgress(p_progress);
+    bool l_ret(true);
     for (std::vector<std::string>::const_iterator l_it = p_files.begin(); l_it != p_files.end(); ++l_it)
     {
-        Run("rm", "-rf", *l_it);
+        if (p_progress != NULL && p_progress->m_cancel)
+            break;
+        SetCurrent(p_progress, *l_it);
+        l_ret = l_engine.remove(*l_it) && l_ret;
     }
+    INHIBIT(std::cout << "File_utils::removeFile: " << l_engine.getNbFiles() << " entries in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    return l_ret;
 }
 
 void File_utils::makeDirectory(const std::string &p_file)
@@ -248,9 +255,9 @@ const bool File_utils::fileExists(const std::string &p_path)
     return stat(p_path.c_str(), &l_stat) == 0;
 }
 
-static void AsciiToLower(std::string *s)
+void File_utils::asciiToLower(std::string &p_s)
 {
-    for (char &c : *s)
+    for (char &c : p_s)
         if (c >= 'A' && c <= 'Z')
             c -= ('Z' - 'z');
 }
@@ -260,16 +267,47 @@ std::string File_utils::getLowercaseFileExtension(const std::string &name) {
     if (dot_pos == std::string::npos)
         return "";
     std::string ext = name.substr(dot_pos + 1);
-    AsciiToLower(&ext);
+    asciiToLower(ext);
     return ext;
 }
 
+const std::string File_utils::formatBytes(const unsigned long long int p_bytes)
+{
+    static const char * const l_units[] = {"B", "KB", "MB", "GB", "TB"};
+    double l_value = p_bytes;
+    unsigned int l_unit(0);
+    while (l_value >= 1024.0 && l_unit < 4)
+    {
+        l_value /= 1024.0;
+        ++l_unit;
+    }
+    std::ostringstream l_s;
+    if (l_unit)
+        l_s << std::fixed << std::setprecision(l_value < 10.0 ? 1 : 0);
+    l_s << l_value << " " << l_units[l_unit];
+    return l_s.str();
+}
+
 const std::string File_utils::getFileName(const std::string &p_path)
 {
     size_t l_pos = p_path.rfind('/');
     return p_path.substr(l_pos + 1);
 }
 
+const bool File_utils::makeDirs(const std::string &p_path)
+{
+    for (std::size_t l_pos = p_path.find('/', 1); ; l_pos = p_path.find('/', l_pos + 1))
+    {
+        if (mkdir(p_path.substr(0, l_pos).c_str(), 0755) == -1 && errno != EEXIST)
+        {
+            std::cerr << "File_utils::makeDirs: Error mkdir " << p_path.substr(0, l_pos) << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (l_pos == std::string::npos)
+            return true;
+    }
+}
+
 const std::string File_utils::getPath(const std::string &p_path)
 {
     size_t l_pos = p_path.rfind('/');
@@ -348,79 +386,16 @@ const unsigned long int File_utils::getFileSize(const std::string &p_file)
     return l_ret;
 }
 
-void File_utils::diskInfo(void)
+void File_utils::diskInfo(const std::string &p_path)
 {
-    std::string l_line("");
-    SDL_utils::pleaseWait();
-    // Execute command df -h
-    {
-        char l_buffer[256];
-        FILE *l_pipe = popen("df -h " FILE_SYSTEM, "r");
-        if (l_pipe == NULL)
-        {
-            std::cerr << "File_utils::diskInfo: Error popen" << std::endl;
-            return;
-        }
-        while (l_line.empty() && fgets(l_buffer, sizeof(l_buffer), l_pipe) != NULL)
-            if (strstr(l_buffer, FILE_SYSTEM) != NULL)
-                l_line = l_buffer;
-        pclose(l_pipe);
-    }
-    if (!l_line.empty())
-    {
-        // Separate line by spaces
-        std::istringstream l_iss(l_line);
-        std::vector<std::string> l_tokens;
-        copy(std::istream_iterator<std::string>(l_iss), std::istream_iterator<std::string>(), std::back_inserter<std::vector<std::string> >(l_tokens));
-        // Display dialog
-        CDialog l_dialog("Disk information:", 0, 0);
-        l_dialog.addLabel("Size: " + l_tokens[1]);
-        l_dialog.addLabel("Used: " + l_tokens[2] + " (" + l_tokens[4] + ")");
-        l_dialog.addLabel("Available: " + l_tokens[3]);
-        l_dialog.addOption("OK");
-        l_dialog.init();
-        l_dialog.execute();
-    }
-    else
-        std::cerr << "File_utils::diskInfo: Unable to find " << FILE_SYSTEM << std::endl;
+    CDiskInfoDialog l_dialog(p_path);
+    l_dialog.execute();
 }
 
 void File_utils::diskUsed(const std::vector<std::string> &p_files)
 {
-    std::string l_line("");
-    // Waiting message
-    SDL_utils::pleaseWait();
-    // Build and execute command
-    {
-        std::string l_command("du -csh");
-        for (std::vector<std::string>::const_iterator l_it = p_files.begin(); l_it != p_files.end(); ++l_it)
-            l_command = l_command + " \"" + *l_it + "\"";
-        char l_buffer[256];
-        FILE *l_pipe = popen(l_command.c_str(), "r");
-        if (l_pipe == NULL)
-        {
-            std::cerr << "File_utils::diskUsed: Error popen" << std::endl;
-            return;
-        }
-        while (fgets(l_buffer, sizeof(l_buffer), l_pipe) != NULL);
-        l_line = l_buffer;
-        pclose(l_pipe);
-    }
-    // Separate line by spaces
-    {
-        std::istringstream l_iss(l_line);
-        std::vector<std::string> l_tokens;
-        copy(std::istream_iterator<std::string>(l_iss), std::istream_iterator<std::string>(), std::back_inserter<std::vector<std::string> >(l_tokens));
-        l_line = l_tokens[0];
-    }
-    // Dialog
-    std::ostringstream l_stream;
-    CDialog l_dialog("Disk used:", 0, 0);
-    l_stream << p_files.size() << " items selected";
-    l_dialog.addLabel(l_stream.str());
-    l_dialog.addLabel("Disk used: " + l_line);
-    l_dialog.addOption("OK");
-    l_dialog.init();
+    // Totals are shown while the scan goes on
+    CDiskUsedDialog l_dialog(p_files);
     l_dialog.execute();
 }
 
@@ -3,16 +3,41 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+
+// Progress of a file operation
+// Updated by the thread doing the operation, read by the UI thread
+struct T_PROGRESS
+{
+    T_PROGRESS(void) : m_bytes(0), m_files(0), m_cancel(false) {}
+    std::atomic<unsigned long long int> m_bytes;
+    std::atomic<unsigned int> m_files;
+    // Set to stop the operation as soon as possible
+    std::atomic<bool> m_cancel;
+    // Item being processed, protected by m_mutex
+    mutable std::mutex m_mutex;
+    std::string m_current;
+};
 
 namespace File_utils
 {
     // File operations
+    // They don't ask anything, and can run in a worker thread
+    // p_progress is optional
+    // Return false if an item could not be processed
+
+    const bool copyFile(const std::vector<std::string> &p_src, const std::string &p_dest, T_PROGRESS *p_progress = NULL);
 
-    void copyFile(const std::vector<std::string> &p_src, const std::string &p_dest);
+    const bool moveFile(const std::vector<std::string> &p_src, const std::string &p_dest, T_PROGRESS *p_progress = NULL);
 
-    void moveFile(const std::vector<std::string> &p_src, const std::string &p_dest);
+    const bool removeFile(const std::vector<std::string> &p_files, T_PROGRESS *p_progress = NULL);
 
-    void removeFile(const std::vector<std::string> &p_files);
+    // Ask for confirmation for the items that exist in p_dest
+    // The items to process are put in p_confirmed
+    // Returns false if the operation is cancelled
+    const bool confirmOverwrite(const std::vector<std::string> &p_src, const std::string &p_dest, std::vector<std::string> &p_confirmed);
 
     void executeFile(const std::string &p_file);
 
@@ -26,10 +51,16 @@ namespace File_utils
 
     std::string getLowercaseFileExtension(const std::string &name);
 
+    // Lower case ASCII letters, other bytes are kept
+    void asciiToLower(std::string &p_s);
+
     const unsigned long int getFileSize(const std::string &p_file);
 
     void formatSize(std::string &p_size);
 
+    // Format 1234567 to "1.2 MB"
+    const std::string formatBytes(const unsigned long long int p_bytes);
+
     const std::string getFileName(const std::string &p_path);
 
     const std::string getPath(const std::string &p_path);
@@ -40,9 +71,33 @@ namespace File_utils
 
     void stringReplace(std::string &p_string, const std::string &p_search, const std::string &p_replace);
 
+    // Create a dir and its parents, like mkdir -p
+    const bool makeDirs(const std::string &p_path);
+
+    // Binary files: fixed size values, in the native byte order
+
+    template <typename T>
+    void writeValue(std::string &p_buffer, const T p_value)
+    {
+        p_buffer.append(reinterpret_cast<const char *>(&p_value), sizeof(T));
+    }
+
+    // Read the value at p_pos and move after it
+    // Returns false if the buffer is too short
+    template <typename T>
+    const bool readValue(const std::string &p_buffer, std::size_t &p_pos, T &p_value)
+    {
+        if (p_pos + sizeof(T) > p_buffer.size())
+            return false;
+        memcpy(&p_value, p_buffer.data() + p_pos, sizeof(T));
+        p_pos += sizeof(T);
+        return true;
+    }
+
     // Dialogs
 
-    void diskInfo(void);
+    // Usage of the mounted file systems, the one of p_path highlighted
+    void diskInfo(const std::string &p_path);
 
     void diskUsed(const std::vector<std::string> &p_files);
 }
@@ -0,0 +1,15 @@
+#include <SDL.h>
+#include "def.h"
+#include "sdlutils.h"
+
+// Globals
+// Defined apart from main(), so that the tools can link the other sources
+SDL_Surface *ScreenSurface;
+
+SDL_Window *Globals::g_sdlwindow=NULL;
+SDL_Surface *Globals::g_screen = NULL;
+const SDL_Color Globals::g_colorTextNormal = {COLOR_TEXT_NORMAL};
+const SDL_Color Globals::g_colorTextTitle = {COLOR_TEXT_TITLE};
+const SDL_Color Globals::g_colorTextDir = {COLOR_TEXT_DIR};
+const SDL_Color Globals::g_colorTextSelected = {COLOR_TEXT_SELECTED};
+std::vector<CWindow *> Globals::g_windows;
@@ -0,0 +1,211 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "imageCache.h"
+#include "fileutils.h"
+#include "def.h"
+
+// File header, and version of the entries
+#define IMAGE_CACHE_MAGIC "CIMG"
+#define IMAGE_CACHE_VERSION 1
+// Larger images are not read from an entry
+#define IMAGE_CACHE_SIDE_MAX 16384
+
+namespace {
+
+// Everything an entry depends on, at the start of its file
+std::string Key(const std::string &p_path, const struct stat &p_stat, const int p_width, const int p_height)
+{
+    std::string l_key(IMAGE_CACHE_MAGIC);
+    File_utils::writeValue<std::uint32_t>(l_key, IMAGE_CACHE_VERSION);
+    File_utils::writeValue<std::uint32_t>(l_key, p_path.size());
+    l_key.append(p_path);
+    File_utils::writeValue<std::int64_t>(l_key, p_stat.st_mtim.tv_sec);
+    File_utils::writeValue<std::uint32_t>(l_key, p_stat.st_mtim.tv_nsec);
+    File_utils::writeValue<std::uint64_t>(l_key, p_stat.st_size);
+    File_utils::writeValue<std::int32_t>(l_key, p_width);
+    File_utils::writeValue<std::int32_t>(l_key, p_height);
+    return l_key;
+}
+
+// A file of the cache dir
+struct T_CACHE_FILE
+{
+    std::string m_name;
+    time_t m_mtime;
+    unsigned long long int m_size;
+};
+
+bool CompareAges(const T_CACHE_FILE &p_a, const T_CACHE_FILE &p_b)
+{
+    return p_a.m_mtime < p_b.m_mtime;
+}
+
+} // namespace
+
+CImageCache& CImageCache::images(void)
+{
+    static CImageCache l_singleton(IMAGE_CACHE_DIR, IMAGE_CACHE_SIZE_MAX);
+    return l_singleton;
+}
+
+CImageCache& CImageCache::thumbnails(void)
+{
+    static CImageCache l_singleton(THUMBNAIL_CACHE_DIR, THUMBNAIL_CACHE_SIZE_MAX);
+    return l_singleton;
+}
+
+CImageCache::CImageCache(const char *p_dir, const unsigned long long int p_sizeMax) :
+    m_size(0),
+    m_sizeMax(p_sizeMax),
+    m_sizeKnown(false)
+{
+    // Without home, nothing is cached
+    const char *l_home = getenv("HOME");
+    if (p_dir[0] == '/')
+        m_dir = p_dir;
+    else if (l_home != NULL && *l_home != '\0')
+        m_dir = std::string(l_home) + "/" + p_dir;
+}
+
+CImageCache::~CImageCache(void)
+{
+}
+
+const std::string CImageCache::getEntryPath(const std::string &p_path, const int p_width, const int p_height) const
+{
+    // FNV-1a of the path and the size, collisions are caught by the key of the entry
+    std::uint64_t l_hash(14695981039346656037ULL);
+    std::string l_name(p_path);
+    File_utils::writeValue<std::int32_t>(l_name, p_width);
+    File_utils::writeValue<std::int32_t>(l_name, p_height);
+    for (std::string::const_iterator l_it = l_name.begin(); l_it != l_name.end(); ++l_it)
+        l_hash = (l_hash ^ static_cast<unsigned char>(*l_it)) * 1099511628211ULL;
+    char l_buffer[24];
+    snprintf(l_buffer, sizeof(l_buffer), "%016llx.img", static_cast<unsigned long long int>(l_hash));
+    return m_dir + "/" + l_buffer;
+}
+
+SDL_Surface *CImageCache::get(const std::string &p_path, const struct stat &p_stat, const int p_width, const int p_height)
+{
+    if (m_dir.empty())
+        return NULL;
+    const std::string l_entryPath = getEntryPath(p_path, p_width, p_height);
+    std::ifstream l_file(l_entryPath.c_str(), std::ios::in | std::ios::binary);
+    if (!l_file.is_open())
+        return NULL;
+    // Another file, or the file has changed => the entry is replaced by the next put
+    const std::string l_key = Key(p_path, p_stat, p_width, p_height);
+    std::string l_buffer(l_key.size() + 3 * sizeof(std::uint32_t), '\0');
+    if (!l_file.read(&l_buffer[0], l_buffer.size()) || l_buffer.compare(0, l_key.size(), l_key) != 0)
+        return NULL;
+    std::size_t l_pos = l_key.size();
+    std::uint32_t l_width(0), l_height(0), l_format(0);
+    File_utils::readValue(l_buffer, l_pos, l_width);
+    File_utils::readValue(l_buffer, l_pos, l_height);
+    File_utils::readValue(l_buffer, l_pos, l_format);
+    if (l_width == 0 || l_height == 0 || l_width > IMAGE_CACHE_SIDE_MAX || l_height > IMAGE_CACHE_SIDE_MAX)
+        return NULL;
+    SDL_Surface *l_image = SDL_CreateRGBSurfaceWithFormat(0, l_width, l_height, 32, l_format);
+    if (l_image == NULL)
+        return NULL;
+    // Rows, without the padding
+    bool l_ok = l_image->format->BytesPerPixel == 4;
+    for (int l_y = 0; l_ok && l_y < l_image->h; ++l_y)
+        l_ok = l_file.read(static_cast<char *>(l_image->pixels) + l_y * l_image->pitch, l_width * 4).good();
+    if (!l_ok)
+    {
+        std::cerr << "CImageCache::get: Error reading " << l_entryPath << std::endl;
+        SDL_FreeSurface(l_image);
+        return NULL;
+    }
+    // Used now, removed last
+    utimensat(AT_FDCWD, l_entryPath.c_str(), NULL, 0);
+    return l_image;
+}
+
+void CImageCache::put(const std::string &p_path, const struct stat &p_stat, const int p_width, const int p_height, SDL_Surface *p_image)
+{
+    if (m_dir.empty() || p_image->format->BytesPerPixel != 4)
+        return;
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    std::string l_buffer = Key(p_path, p_stat, p_width, p_height);
+    File_utils::writeValue<std::uint32_t>(l_buffer, p_image->w);
+    File_utils::writeValue<std::uint32_t>(l_buffer, p_image->h);
+    File_utils::writeValue<std::uint32_t>(l_buffer, p_image->format->format);
+    l_buffer.reserve(l_buffer.size() + p_image->w * 4 * p_image->h);
+    for (int l_y = 0; l_y < p_image->h; ++l_y)
+        l_buffer.append(static_cast<const char *>(p_image->pixels) + l_y * p_image->pitch, p_image->w * 4);
+    const std::string l_entryPath = getEntryPath(p_path, p_width, p_height);
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    // Written aside then renamed, a reader never sees a partial entry
+    File_utils::makeDirs(m_dir);
+    const std::string l_tmp(l_entryPath + ".tmp");
+    {
+        std::ofstream l_file(l_tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        l_file.write(l_buffer.data(), l_buffer.size());
+        if (!l_file.good())
+        {
+            std::cerr << "CImageCache::put: Error writing " << l_tmp << std::endl;
+            l_file.close();
+            unlink(l_tmp.c_str());
+            return;
+        }
+    }
+    if (rename(l_tmp.c_str(), l_entryPath.c_str()) == -1)
+    {
+        std::cerr << "CImageCache::put: Error rename " << l_tmp << ": " << strerror(errno) << std::endl;
+        unlink(l_tmp.c_str());
+        return;
+    }
+    INHIBIT(std::cout << "CImageCache::put: " << p_path << ", " << l_buffer.size() << " bytes in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    // A replaced entry is counted twice until the next trim
+    m_size += l_buffer.size();
+    if (!m_sizeKnown || m_size > m_sizeMax)
+        trim();
+}
+
+void CImageCache::trim(void)
+{
+    DIR *l_dir = opendir(m_dir.c_str());
+    if (l_dir == NULL)
+        return;
+    std::vector<T_CACHE_FILE> l_files;
+    m_size = 0;
+    struct dirent *l_ent;
+    struct stat l_stat;
+    while ((l_ent = readdir(l_dir)) != NULL)
+    {
+        if (fstatat(dirfd(l_dir), l_ent->d_name, &l_stat, AT_SYMLINK_NOFOLLOW) == -1 || !S_ISREG(l_stat.st_mode))
+            continue;
+        T_CACHE_FILE l_file;
+        l_file.m_name = l_ent->d_name;
+        l_file.m_mtime = l_stat.st_mtime;
+        l_file.m_size = l_stat.st_size;
+        l_files.push_back(l_file);
+        m_size += l_file.m_size;
+    }
+    m_sizeKnown = true;
+    // Down to 3/4 of the maximum, so that the next entries don't trim again
+    if (m_size > m_sizeMax)
+    {
+        std::sort(l_files.begin(), l_files.end(), CompareAges);
+        for (std::vector<T_CACHE_FILE>::const_iterator l_it = l_files.begin(); l_it != l_files.end() && m_size > m_sizeMax / 4 * 3; ++l_it)
+        {
+            if (unlinkat(dirfd(l_dir), l_it->m_name.c_str(), 0) == -1)
+                continue;
+            m_size -= l_it->m_size;
+        }
+        INHIBIT(std::cout << "CImageCache::trim: " << m_size << " bytes left" << std::endl;)
+    }
+    closedir(l_dir);
+}
@@ -0,0 +1,61 @@
+#ifndef _IMAGE_CACHE_H_
+#define _IMAGE_CACHE_H_
+
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <SDL.h>
+
+// Images scaled by the image loader, stored on disk in the viewer format
+// An entry is keyed by the path of the file and the size it was fitted in,
+// and is valid while the mtime and size of the file are unchanged.
+// The least recently used entries are removed over the maximum size.
+// Thumbnails have their own cache, so that browsing many of them doesn't
+// evict the images of the viewer.
+class CImageCache
+{
+    public:
+
+    // Methods to get the instances: viewer images, thumbnails
+    static CImageCache& images(void);
+    static CImageCache& thumbnails(void);
+
+    // Get the image of a file, stat'ed in p_stat, fitted in p_width x p_height
+    // Returns NULL if it's not cached, else the caller owns the surface
+    SDL_Surface *get(const std::string &p_path, const struct stat &p_stat, const int p_width, const int p_height);
+
+    // Store the image of a file
+    void put(const std::string &p_path, const struct stat &p_stat, const int p_width, const int p_height, SDL_Surface *p_image);
+
+    private:
+
+    // Constructor, p_dir is relative to $HOME
+    CImageCache(const char *p_dir, const unsigned long long int p_sizeMax);
+
+    // Forbidden
+    CImageCache(void);
+    CImageCache(const CImageCache &p_source);
+    const CImageCache &operator =(const CImageCache &p_source);
+
+    // Destructor
+    virtual ~CImageCache(void);
+
+    // Path of the entry of an image
+    const std::string getEntryPath(const std::string &p_path, const int p_width, const int p_height) const;
+
+    // Count the size of the entries, and remove the oldest ones if it's too big
+    void trim(void);
+
+    // Dir of the entries, empty without home
+    std::string m_dir;
+
+    // Total size of the entries, known after the first trim, and its maximum
+    unsigned long long int m_size;
+    const unsigned long long int m_sizeMax;
+    bool m_sizeKnown;
+
+    std::mutex m_mutex;
+};
+
+#endif
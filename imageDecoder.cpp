@@ -0,0 +1,338 @@
+#include <iostream>
+#include <vector>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <jpeglib.h>
+#include <png.h>
+#include "imageDecoder.h"
+#include "sdlutils.h"
+#include "def.h"
+
+// Rows decoded between two checks of the cancel flag
+#define IMAGE_DECODER_CANCEL_ROWS 16
+// Maximum number of source pixels in a destination pixel, so that their sums fit in 32 bits
+#define IMAGE_DECODER_BOX_MAX 16843009  // = 2^32 / 255
+
+namespace {
+
+// Reduce an image given row by row into a surface of the viewer format
+// A destination pixel is the average of the source pixels it covers
+class CBoxFilter
+{
+    public:
+
+    CBoxFilter(void):
+        m_srcH(0),
+        m_srcY(0),
+        m_destY(0),
+        m_nbRows(0),
+        m_dest(NULL)
+    {
+    }
+
+    void init(const int p_srcW, const int p_srcH, SDL_Surface *p_dest)
+    {
+        m_srcH = p_srcH;
+        m_dest = p_dest;
+        m_columns.resize(p_srcW);
+        m_nbColumns.assign(p_dest->w, 0);
+        m_sums.assign(p_dest->w * 4, 0);
+        for (int l_x = 0; l_x < p_srcW; ++l_x)
+        {
+            // Last destination column starting at or before l_x
+            m_columns[l_x] = (static_cast<std::uint64_t>(l_x + 1) * p_dest->w - 1) / p_srcW;
+            ++m_nbColumns[m_columns[l_x]];
+        }
+    }
+
+    // Add the next row, 8 bits RGB or RGBA
+    void addRow(const unsigned char *p_row, const int p_channels)
+    {
+        const int l_destY = (static_cast<std::uint64_t>(m_srcY + 1) * m_dest->h - 1) / m_srcH;
+        if (l_destY != m_destY)
+        {
+            flush();
+            m_destY = l_destY;
+        }
+        std::uint32_t *l_sums = m_sums.data();
+        const std::vector<int>::const_iterator l_end = m_columns.end();
+        if (p_channels == 4)
+        {
+            for (std::vector<int>::const_iterator l_it = m_columns.begin(); l_it != l_end; ++l_it, p_row += 4)
+            {
+                std::uint32_t *l_sum = l_sums + *l_it * 4;
+                l_sum[0] += p_row[0];
+                l_sum[1] += p_row[1];
+                l_sum[2] += p_row[2];
+                l_sum[3] += p_row[3];
+            }
+        }
+        else
+        {
+            for (std::vector<int>::const_iterator l_it = m_columns.begin(); l_it != l_end; ++l_it, p_row += 3)
+            {
+                std::uint32_t *l_sum = l_sums + *l_it * 4;
+                l_sum[0] += p_row[0];
+                l_sum[1] += p_row[1];
+                l_sum[2] += p_row[2];
+                l_sum[3] += 255;
+            }
+        }
+        ++m_nbRows;
+        ++m_srcY;
+    }
+
+    // Write the last row
+    void finish(void)
+    {
+        flush();
+    }
+
+    private:
+
+    // Write the current destination row, and start the next one
+    void flush(void)
+    {
+        if (m_nbRows == 0)
+            return;
+        Uint32 *l_pixel = reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(m_dest->pixels) + m_destY * m_dest->pitch);
+        std::uint32_t *l_sum = m_sums.data();
+        for (int l_x = 0; l_x < m_dest->w; ++l_x, l_sum += 4)
+        {
+            const std::uint32_t l_nb = m_nbColumns[l_x] * m_nbRows;
+            l_pixel[l_x] = (l_sum[0] + l_nb / 2) / l_nb << 24 | (l_sum[1] + l_nb / 2) / l_nb << 16 | (l_sum[2] + l_nb / 2) / l_nb << 8 | (l_sum[3] + l_nb / 2) / l_nb;
+            l_sum[0] = l_sum[1] = l_sum[2] = l_sum[3] = 0;
+        }
+        m_nbRows = 0;
+    }
+
+    int m_srcH;
+    int m_srcY;
+    int m_destY;
+    std::uint32_t m_nbRows;
+    SDL_Surface *m_dest;
+    // Destination column of each source column, and number of source columns of each destination column
+    std::vector<int> m_columns;
+    std::vector<std::uint32_t> m_nbColumns;
+    // RGBA sums of the current destination row
+    std::vector<std::uint32_t> m_sums;
+};
+
+// State of a decode, kept out of the functions calling setjmp
+struct T_DECODE
+{
+    const char *m_path;
+    SDL_Surface *m_image;
+    CBoxFilter m_filter;
+    std::vector<unsigned char> m_row;
+};
+
+// True if an image of p_srcW x p_srcH is reduced to p_destW x p_destH by the box filter
+bool IsReduced(const unsigned int p_srcW, const unsigned int p_srcH, const int p_destW, const int p_destH)
+{
+    if (p_destW < 1 || p_destH < 1 || static_cast<unsigned int>(p_destW) > p_srcW || static_cast<unsigned int>(p_destH) > p_srcH)
+        return false;
+    if (static_cast<unsigned int>(p_destW) == p_srcW && static_cast<unsigned int>(p_destH) == p_srcH)
+        return false;
+    return static_cast<std::uint64_t>(p_srcW / p_destW + 1) * (p_srcH / p_destH + 1) <= IMAGE_DECODER_BOX_MAX;
+}
+
+SDL_Surface *CreateImage(const int p_width, const int p_height)
+{
+    SDL_Surface *l_image = SDL_CreateRGBSurfaceWithFormat(0, p_width, p_height, 32, SDL_PIXELFORMAT_RGBA8888);
+    if (l_image == NULL)
+    {
+        std::cerr << "Image_decoder::loadImageToFit: " << SDL_GetError() << std::endl;
+        SDL_ClearError();
+    }
+    return l_image;
+}
+
+// libjpeg errors end the decode
+struct T_JPEG_ERROR
+{
+    struct jpeg_error_mgr m_manager;
+    jmp_buf m_jump;
+};
+
+void JpegErrorExit(j_common_ptr p_info)
+{
+    longjmp(reinterpret_cast<T_JPEG_ERROR *>(p_info->err)->m_jump, 1);
+}
+
+// Warnings about corrupt data are not shown, the image is decoded anyway
+void JpegOutputMessage(j_common_ptr p_info)
+{
+}
+
+bool DecodeJpeg(FILE *p_file, T_DECODE &p_decode, const int p_fitW, const int p_fitH, const std::atomic<bool> &p_cancel)
+{
+    struct jpeg_decompress_struct l_info;
+    T_JPEG_ERROR l_error;
+    l_info.err = jpeg_std_error(&l_error.m_manager);
+    l_error.m_manager.error_exit = JpegErrorExit;
+    l_error.m_manager.output_message = JpegOutputMessage;
+    if (setjmp(l_error.m_jump))
+    {
+        char l_message[JMSG_LENGTH_MAX];
+        (*l_info.err->format_message)(reinterpret_cast<j_common_ptr>(&l_info), l_message);
+        std::cerr << "Image_decoder::loadImageToFit: " << p_decode.m_path << ": " << l_message << std::endl;
+        jpeg_destroy_decompress(&l_info);
+        return false;
+    }
+    jpeg_create_decompress(&l_info);
+    jpeg_stdio_src(&l_info, p_file);
+    jpeg_read_header(&l_info, TRUE);
+    int l_width(0), l_height(0);
+    SDL_utils::getFitSize(l_info.image_width, l_info.image_height, p_fitW, p_fitH, l_width, l_height);
+    // CMYK is not converted to RGB by libjpeg
+    if (l_info.jpeg_color_space == JCS_CMYK || l_info.jpeg_color_space == JCS_YCCK || !IsReduced(l_info.image_width, l_info.image_height, l_width, l_height))
+    {
+        jpeg_destroy_decompress(&l_info);
+        return false;
+    }
+    // Smallest DCT scaling not smaller than the target
+    l_info.out_color_space = JCS_RGB;
+    l_info.scale_num = 1;
+    for (l_info.scale_denom = 8; l_info.scale_denom > 1; l_info.scale_denom /= 2)
+    {
+        jpeg_calc_output_dimensions(&l_info);
+        if (l_info.output_width >= static_cast<unsigned int>(l_width) && l_info.output_height >= static_cast<unsigned int>(l_height))
+            break;
+    }
+    // Chroma is averaged by the box filter anyway
+    l_info.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&l_info);
+    p_decode.m_image = CreateImage(l_width, l_height);
+    if (p_decode.m_image == NULL)
+    {
+        jpeg_destroy_decompress(&l_info);
+        return false;
+    }
+    p_decode.m_filter.init(l_info.output_width, l_info.output_height, p_decode.m_image);
+    p_decode.m_row.resize(l_info.output_width * l_info.output_components);
+    JSAMPROW l_row = p_decode.m_row.data();
+    while (l_info.output_scanline < l_info.output_height)
+    {
+        if (l_info.output_scanline % IMAGE_DECODER_CANCEL_ROWS == 0 && p_cancel)
+        {
+            jpeg_destroy_decompress(&l_info);
+            return false;
+        }
+        jpeg_read_scanlines(&l_info, &l_row, 1);
+        p_decode.m_filter.addRow(l_row, 3);
+    }
+    p_decode.m_filter.finish();
+    INHIBIT(std::cout << "Image_decoder::loadImageToFit: " << p_decode.m_path << " " << l_info.image_width << "x" << l_info.image_height << " decoded at 1/" << l_info.scale_denom << std::endl;)
+    jpeg_finish_decompress(&l_info);
+    jpeg_destroy_decompress(&l_info);
+    return true;
+}
+
+// libpng errors end the decode
+void PngError(png_structp p_png, png_const_charp p_message)
+{
+    std::cerr << "Image_decoder::loadImageToFit: " << static_cast<T_DECODE *>(png_get_error_ptr(p_png))->m_path << ": " << p_message << std::endl;
+    png_longjmp(p_png, 1);
+}
+
+void PngWarning(png_structp p_png, png_const_charp p_message)
+{
+}
+
+bool DecodePng(FILE *p_file, T_DECODE &p_decode, const int p_fitW, const int p_fitH, const std::atomic<bool> &p_cancel)
+{
+    png_structp l_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &p_decode, PngError, PngWarning);
+    if (l_png == NULL)
+        return false;
+    png_infop l_info = png_create_info_struct(l_png);
+    if (l_info == NULL || setjmp(png_jmpbuf(l_png)))
+    {
+        png_destroy_read_struct(&l_png, &l_info, NULL);
+        return false;
+    }
+    png_init_io(l_png, p_file);
+    png_read_info(l_png, l_info);
+    png_uint_32 l_srcW(0), l_srcH(0);
+    int l_depth(0), l_colorType(0), l_interlace(0);
+    png_get_IHDR(l_png, l_info, &l_srcW, &l_srcH, &l_depth, &l_colorType, &l_interlace, NULL, NULL);
+    int l_width(0), l_height(0);
+    SDL_utils::getFitSize(l_srcW, l_srcH, p_fitW, p_fitH, l_width, l_height);
+    // The rows of an interlaced image come in several passes
+    if (l_interlace != PNG_INTERLACE_NONE || !IsReduced(l_srcW, l_srcH, l_width, l_height))
+    {
+        png_destroy_read_struct(&l_png, &l_info, NULL);
+        return false;
+    }
+    // Any format => 8 bits RGBA
+    const bool l_transparent = png_get_valid(l_png, l_info, PNG_INFO_tRNS);
+    if (l_colorType == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(l_png);
+    if (l_colorType == PNG_COLOR_TYPE_GRAY && l_depth < 8)
+        png_set_expand_gray_1_2_4_to_8(l_png);
+    if (l_transparent)
+        png_set_tRNS_to_alpha(l_png);
+    if (l_depth == 16)
+        png_set_strip_16(l_png);
+    if (l_colorType == PNG_COLOR_TYPE_GRAY || l_colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(l_png);
+    if (!(l_colorType & PNG_COLOR_MASK_ALPHA) && !l_transparent)
+        png_set_filler(l_png, 0xFF, PNG_FILLER_AFTER);
+    png_read_update_info(l_png, l_info);
+    if (png_get_rowbytes(l_png, l_info) != l_srcW * 4)
+    {
+        png_destroy_read_struct(&l_png, &l_info, NULL);
+        return false;
+    }
+    p_decode.m_image = CreateImage(l_width, l_height);
+    if (p_decode.m_image == NULL)
+    {
+        png_destroy_read_struct(&l_png, &l_info, NULL);
+        return false;
+    }
+    p_decode.m_filter.init(l_srcW, l_srcH, p_decode.m_image);
+    p_decode.m_row.resize(l_srcW * 4);
+    for (png_uint_32 l_y = 0; l_y < l_srcH; ++l_y)
+    {
+        if (l_y % IMAGE_DECODER_CANCEL_ROWS == 0 && p_cancel)
+        {
+            png_destroy_read_struct(&l_png, &l_info, NULL);
+            return false;
+        }
+        png_read_row(l_png, p_decode.m_row.data(), NULL);
+        p_decode.m_filter.addRow(p_decode.m_row.data(), 4);
+    }
+    p_decode.m_filter.finish();
+    // The chunks after the image are not read
+    png_destroy_read_struct(&l_png, &l_info, NULL);
+    return true;
+}
+
+} // namespace
+
+SDL_Surface *Image_decoder::loadImageToFit(const std::string &p_path, const int p_fitW, const int p_fitH, const std::atomic<bool> &p_cancel)
+{
+    FILE *l_file = fopen(p_path.c_str(), "rb");
+    if (l_file == NULL)
+        return NULL;
+    // Signature
+    unsigned char l_signature[8];
+    const std::size_t l_size = fread(l_signature, 1, sizeof(l_signature), l_file);
+    rewind(l_file);
+    T_DECODE l_decode;
+    l_decode.m_path = p_path.c_str();
+    l_decode.m_image = NULL;
+    bool l_ok(false);
+    if (l_size >= 3 && l_signature[0] == 0xFF && l_signature[1] == 0xD8 && l_signature[2] == 0xFF)
+        l_ok = DecodeJpeg(l_file, l_decode, p_fitW, p_fitH, p_cancel);
+    else if (l_size == sizeof(l_signature) && png_sig_cmp(l_signature, 0, sizeof(l_signature)) == 0)
+        l_ok = DecodePng(l_file, l_decode, p_fitW, p_fitH, p_cancel);
+    fclose(l_file);
+    if (!l_ok && l_decode.m_image != NULL)
+    {
+        SDL_FreeSurface(l_decode.m_image);
+        l_decode.m_image = NULL;
+    }
+    return l_decode.m_image;
+}
@@ -0,0 +1,20 @@
+#ifndef _IMAGE_DECODER_H_
+#define _IMAGE_DECODER_H_
+
+#include <atomic>
+#include <string>
+#include <SDL.h>
+
+// Decoders of JPEG and PNG files scaling the image down while it's decoded,
+// so that the full size image is never in memory.
+// JPEG files are decoded at 1/2, 1/4 or 1/8 of their size by libjpeg, then
+// both are reduced row by row by a box filter.
+namespace Image_decoder
+{
+    // Decode a file, scaled like SDL_utils::scaleImageToFit in the viewer format
+    // Returns NULL if it's not a JPEG or PNG file, it's not reduced, it can't be
+    // decoded, or p_cancel was set. SDL_image is the fallback.
+    SDL_Surface *loadImageToFit(const std::string &p_path, const int p_fitW, const int p_fitH, const std::atomic<bool> &p_cancel);
+}
+
+#endif
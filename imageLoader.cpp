@@ -0,0 +1,360 @@
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <SDL_image.h>
+#include "imageLoader.h"
+#include "imageCache.h"
+#include "imageDecoder.h"
+#include "fileutils.h"
+#include "sdlutils.h"
+#include "screen.h"
+#include "def.h"
+
+// Files are read by chunks, a cancel is seen between them
+#define IMAGE_READ_CHUNK 1048576  // = 1 MB
+// Maximum number of worker threads
+#define IMAGE_LOADER_NB_THREADS_MAX 4
+// Images fitted in this size may come from the thumbnail of the Exif data of
+// a JPEG file, found in its first bytes
+#define IMAGE_EXIF_FIT_MAX 160
+#define IMAGE_EXIF_HEAD_SIZE 131072  // = 128 KB
+
+namespace {
+
+// Formats recognized from their first bytes
+int (* const g_imageTests[])(SDL_RWops *) = {
+    IMG_isJPG, IMG_isPNG, IMG_isBMP, IMG_isGIF, IMG_isICO, IMG_isCUR, IMG_isTIF, IMG_isWEBP,
+    IMG_isXCF, IMG_isPCX, IMG_isPNM, IMG_isLBM, IMG_isXPM, IMG_isXV, IMG_isSVG, NULL
+};
+
+// Read a whole file, unless cancelled
+bool ReadFile(const std::string &p_path, const std::size_t p_size, const std::atomic<bool> &p_cancel, std::vector<char> &p_data)
+{
+    const int l_fd = open(p_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (l_fd == -1)
+    {
+        std::cerr << "CImageLoader::decode: Error opening " << p_path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    p_data.resize(p_size);
+    std::size_t l_done(0);
+    while (l_done < p_size && !p_cancel)
+    {
+        const ssize_t l_read = read(l_fd, &p_data[l_done], std::min(p_size - l_done, static_cast<std::size_t>(IMAGE_READ_CHUNK)));
+        if (l_read == -1 && errno == EINTR)
+            continue;
+        if (l_read <= 0)
+        {
+            if (l_read == -1)
+                std::cerr << "CImageLoader::decode: Error reading " << p_path << ": " << strerror(errno) << std::endl;
+            break;
+        }
+        l_done += l_read;
+    }
+    close(l_fd);
+    // A file truncated meanwhile is decoded as it is
+    p_data.resize(l_done);
+    return !p_cancel && l_done > 0;
+}
+
+// 16 and 32 bits values of the Exif data, in its byte order
+unsigned int Get16(const unsigned char *p_data, const bool p_bigEndian)
+{
+    return p_bigEndian ? p_data[0] << 8 | p_data[1] : p_data[1] << 8 | p_data[0];
+}
+
+unsigned int Get32(const unsigned char *p_data, const bool p_bigEndian)
+{
+    return p_bigEndian ? Get16(p_data, true) << 16 | Get16(p_data + 2, true) : Get16(p_data + 2, false) << 16 | Get16(p_data, false);
+}
+
+// Find the JPEG thumbnail in the Exif data of the beginning of a JPEG file
+// The thumbnail is described by the second IFD of the TIFF structure of the APP1 segment
+bool FindExifThumbnail(const std::vector<char> &p_data, std::size_t &p_offset, std::size_t &p_length)
+{
+    const unsigned char *l_data = reinterpret_cast<const unsigned char *>(p_data.data());
+    const std::size_t l_size = p_data.size();
+    if (l_size < 4 || l_data[0] != 0xFF || l_data[1] != 0xD8)
+        return false;
+    // Segments, until the image data
+    std::size_t l_pos(2);
+    while (l_pos + 4 <= l_size && l_data[l_pos] == 0xFF && l_data[l_pos + 1] != 0xDA)
+    {
+        const std::size_t l_length = l_data[l_pos + 2] << 8 | l_data[l_pos + 3];
+        if (l_data[l_pos + 1] != 0xE1 || l_length < 16 || l_pos + 2 + l_length > l_size || memcmp(l_data + l_pos + 4, "Exif\0\0", 6) != 0)
+        {
+            l_pos += 2 + l_length;
+            continue;
+        }
+        const unsigned char *l_tiff = l_data + l_pos + 10;
+        const std::size_t l_tiffSize = l_length - 8;
+        if ((l_tiff[0] != 'I' && l_tiff[0] != 'M') || l_tiff[1] != l_tiff[0])
+            return false;
+        const bool l_bigEndian = l_tiff[0] == 'M';
+        // Skip the first IFD
+        std::size_t l_ifd = Get32(l_tiff + 4, l_bigEndian);
+        if (l_ifd > l_tiffSize - 2)
+            return false;
+        l_ifd += 2 + 12 * Get16(l_tiff + l_ifd, l_bigEndian);
+        if (l_ifd > l_tiffSize - 4)
+            return false;
+        l_ifd = Get32(l_tiff + l_ifd, l_bigEndian);
+        if (l_ifd == 0 || l_ifd > l_tiffSize - 2)
+            return false;
+        // Offset and length of the thumbnail, relative to the TIFF header
+        const unsigned int l_nbEntries = Get16(l_tiff + l_ifd, l_bigEndian);
+        std::size_t l_offset(0), l_length2(0);
+        for (unsigned int l_i = 0; l_i < l_nbEntries && l_ifd + 2 + 12 * (l_i + 1) <= l_tiffSize; ++l_i)
+        {
+            const unsigned char *l_entry = l_tiff + l_ifd + 2 + 12 * l_i;
+            // SHORT or LONG
+            const unsigned int l_value = Get16(l_entry + 2, l_bigEndian) == 3 ? Get16(l_entry + 8, l_bigEndian) : Get32(l_entry + 8, l_bigEndian);
+            if (Get16(l_entry, l_bigEndian) == 0x0201)
+                l_offset = l_value;
+            else if (Get16(l_entry, l_bigEndian) == 0x0202)
+                l_length2 = l_value;
+        }
+        if (l_length2 < 4 || l_offset > l_tiffSize || l_length2 > l_tiffSize - l_offset || l_tiff[l_offset] != 0xFF || l_tiff[l_offset + 1] != 0xD8)
+            return false;
+        p_offset = l_tiff + l_offset - l_data;
+        p_length = l_length2;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+CImageLoader& CImageLoader::instance(void)
+{
+    static CImageLoader l_singleton;
+    return l_singleton;
+}
+
+CImageLoader::CImageLoader(void):
+    m_nextId(1),
+    m_quit(false)
+{
+    const unsigned int l_nbThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(IMAGE_LOADER_NB_THREADS_MAX)));
+    for (unsigned int l_i = 0; l_i < l_nbThreads; ++l_i)
+        m_workers.push_back(std::thread(&CImageLoader::run, this));
+}
+
+CImageLoader::~CImageLoader(void)
+{
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_quit = true;
+        for (std::list<T_REQUEST>::iterator l_it = m_requests.begin(); l_it != m_requests.end(); ++l_it)
+            l_it->m_cancel = true;
+    }
+    m_condition.notify_all();
+    for (std::vector<std::thread>::iterator l_it = m_workers.begin(); l_it != m_workers.end(); ++l_it)
+        l_it->join();
+    for (std::list<T_REQUEST>::iterator l_it = m_requests.begin(); l_it != m_requests.end(); ++l_it)
+    {
+        if (l_it->m_image != NULL)
+            SDL_FreeSurface(l_it->m_image);
+    }
+}
+
+const bool CImageLoader::isImage(const std::string &p_path)
+{
+    // Targa files have no signature
+    if (File_utils::getLowercaseFileExtension(p_path) == "tga")
+        return true;
+    SDL_RWops *l_rw = SDL_RWFromFile(p_path.c_str(), "rb");
+    if (l_rw == NULL)
+    {
+        SDL_ClearError();
+        return false;
+    }
+    bool l_ret(false);
+    for (int (* const *l_test)(SDL_RWops *) = g_imageTests; !l_ret && *l_test != NULL; ++l_test)
+        l_ret = (*l_test)(l_rw);
+    SDL_RWclose(l_rw);
+    return l_ret;
+}
+
+const unsigned int CImageLoader::load(const std::string &p_path, const int p_width, const int p_height, CImageCache &p_cache, const bool p_first)
+{
+    unsigned int l_id(0);
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        const std::list<T_REQUEST>::iterator l_it = m_requests.emplace(p_first ? m_requests.begin() : m_requests.end());
+        T_REQUEST &l_request = *l_it;
+        l_request.m_id = l_id = m_nextId++;
+        l_request.m_path = p_path;
+        l_request.m_width = p_width;
+        l_request.m_height = p_height;
+        l_request.m_cache = &p_cache;
+        l_request.m_running = false;
+        l_request.m_done = false;
+        l_request.m_cancel = false;
+        l_request.m_image = NULL;
+    }
+    INHIBIT(std::cout << "CImageLoader::load: request " << l_id << ", " << p_path << std::endl;)
+    m_condition.notify_all();
+    return l_id;
+}
+
+void CImageLoader::cancel(const unsigned int p_id)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    for (std::list<T_REQUEST>::iterator l_it = m_requests.begin(); l_it != m_requests.end(); ++l_it)
+    {
+        if (l_it->m_id != p_id)
+            continue;
+        // A running one is removed by its worker
+        if (l_it->m_running)
+        {
+            l_it->m_cancel = true;
+            return;
+        }
+        if (l_it->m_image != NULL)
+            SDL_FreeSurface(l_it->m_image);
+        m_requests.erase(l_it);
+        return;
+    }
+}
+
+const bool CImageLoader::take(const unsigned int p_id, SDL_Surface *&p_image)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    for (std::list<T_REQUEST>::iterator l_it = m_requests.begin(); l_it != m_requests.end(); ++l_it)
+    {
+        if (l_it->m_id != p_id)
+            continue;
+        if (!l_it->m_done)
+            return false;
+        p_image = l_it->m_image;
+        m_requests.erase(l_it);
+        return true;
+    }
+    // Unknown => nothing to wait for
+    p_image = NULL;
+    return true;
+}
+
+void CImageLoader::run(void)
+{
+    std::unique_lock<std::mutex> l_lock(m_mutex);
+    while (!m_quit)
+    {
+        // First request not done nor running
+        std::list<T_REQUEST>::iterator l_it = m_requests.begin();
+        while (l_it != m_requests.end() && (l_it->m_done || l_it->m_running))
+            ++l_it;
+        if (l_it == m_requests.end())
+        {
+            m_condition.wait(l_lock);
+            continue;
+        }
+        l_it->m_running = true;
+        l_lock.unlock();
+        SDL_Surface *l_image = decode(*l_it);
+        l_lock.lock();
+        l_it->m_running = false;
+        if (l_it->m_cancel)
+        {
+            if (l_image != NULL)
+                SDL_FreeSurface(l_image);
+            m_requests.erase(l_it);
+            continue;
+        }
+        l_it->m_image = l_image;
+        l_it->m_done = true;
+    }
+}
+
+SDL_Surface *CImageLoader::decode(const T_REQUEST &p_request)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    struct stat l_stat;
+    if (stat(p_request.m_path.c_str(), &l_stat) == -1 || !S_ISREG(l_stat.st_mode))
+    {
+        std::cerr << "CImageLoader::decode: Error stat " << p_request.m_path << std::endl;
+        return NULL;
+    }
+    // Physical pixels, the size of the scaled image depends on them
+    const int l_width = p_request.m_width * screen.ppu_x;
+    const int l_height = p_request.m_height * screen.ppu_y;
+    SDL_Surface *l_image = p_request.m_cache->get(p_request.m_path, l_stat, l_width, l_height);
+    if (l_image != NULL)
+    {
+        INHIBIT(std::cout << "CImageLoader::decode: " << p_request.m_path << " from the cache in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+        return l_image;
+    }
+    // Read first, so that a cancel doesn't wait for the disk
+    std::vector<char> l_data;
+    // Thumbnails of photos: the one of the camera is enough if it's not smaller
+    std::size_t l_offset(0), l_length(0);
+    if (l_width <= IMAGE_EXIF_FIT_MAX && l_height <= IMAGE_EXIF_FIT_MAX && ReadFile(p_request.m_path, std::min(static_cast<std::size_t>(l_stat.st_size), static_cast<std::size_t>(IMAGE_EXIF_HEAD_SIZE)), p_request.m_cancel, l_data) && FindExifThumbnail(l_data, l_offset, l_length))
+    {
+        SDL_RWops *l_rw = SDL_RWFromConstMem(l_data.data() + l_offset, l_length);
+        l_image = l_rw == NULL ? NULL : IMG_LoadTyped_RW(l_rw, 1, "JPG");
+        if (l_image != NULL && l_image->w < l_width && l_image->h < l_height)
+        {
+            SDL_FreeSurface(l_image);
+            l_image = NULL;
+        }
+        SDL_ClearError();
+    }
+    // From the thumbnail, the image is always cached
+    const bool l_exif = l_image != NULL;
+    if (l_exif)
+    {
+        INHIBIT(std::cout << "CImageLoader::decode: " << p_request.m_path << ": Exif thumbnail " << l_image->w << "x" << l_image->h << std::endl;)
+    }
+    else
+    {
+        // JPEG and PNG files are scaled while decoded, without the full size image
+        SDL_Surface *l_scaled = Image_decoder::loadImageToFit(p_request.m_path, p_request.m_width, p_request.m_height, p_request.m_cancel);
+        if (l_scaled != NULL)
+        {
+            if (!p_request.m_cancel)
+                p_request.m_cache->put(p_request.m_path, l_stat, l_width, l_height, l_scaled);
+            INHIBIT(std::cout << "CImageLoader::decode: " << p_request.m_path << " scaled while decoded in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+            return l_scaled;
+        }
+        if (p_request.m_cancel)
+            return NULL;
+        if (!ReadFile(p_request.m_path, l_stat.st_size, p_request.m_cancel, l_data))
+            return NULL;
+        // The extension is a hint for the formats without signature
+        SDL_RWops *l_rw = SDL_RWFromConstMem(l_data.data(), l_data.size());
+        l_image = l_rw == NULL ? NULL : IMG_LoadTyped_RW(l_rw, 1, File_utils::getLowercaseFileExtension(p_request.m_path).c_str());
+    }
+    if (l_image == NULL)
+    {
+        if (strcmp(IMG_GetError(), "Unsupported image format") != 0)
+            std::cerr << "CImageLoader::decode: " << p_request.m_path << ": " << IMG_GetError() << std::endl;
+        SDL_ClearError();
+        return NULL;
+    }
+    l_data.clear();
+    if (p_request.m_cancel)
+    {
+        SDL_FreeSurface(l_image);
+        return NULL;
+    }
+    SDL_Surface *l_scaled = SDL_utils::scaleImageToFit(l_image, p_request.m_width, p_request.m_height);
+    // Only downscaled images are worth caching
+    const bool l_reduced = l_scaled != NULL && (l_exif || l_scaled->w * l_scaled->h < l_image->w * l_image->h);
+    SDL_FreeSurface(l_image);
+    if (l_scaled == NULL)
+    {
+        std::cerr << "CImageLoader::decode: Error scaling " << p_request.m_path << ": " << SDL_GetError() << std::endl;
+        SDL_ClearError();
+        return NULL;
+    }
+    if (l_reduced && !p_request.m_cancel)
+        p_request.m_cache->put(p_request.m_path, l_stat, l_width, l_height, l_scaled);
+    INHIBIT(std::cout << "CImageLoader::decode: " << p_request.m_path << " decoded in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    return l_scaled;
+}
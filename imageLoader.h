@@ -0,0 +1,82 @@
+#ifndef _IMAGE_LOADER_H_
+#define _IMAGE_LOADER_H_
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <SDL.h>
+#include "imageCache.h"
+
+// Images decoded and scaled by a pool of worker threads, in order of request
+// unless a request is made to go first
+// The scaled images are kept in the given image cache, so that they're reopened
+// without being decoded again.
+class CImageLoader
+{
+    public:
+
+    // Method to get the instance
+    static CImageLoader& instance(void);
+
+    // True if the file looks like an image, from its first bytes
+    static const bool isImage(const std::string &p_path);
+
+    // Queue the decode of an image, fitted in p_width x p_height, cached in p_cache
+    // If p_first, it's decoded before the queued ones
+    // Returns its id
+    const unsigned int load(const std::string &p_path, const int p_width, const int p_height, CImageCache &p_cache, const bool p_first = false);
+
+    // Cancel a request, queued, running or done
+    void cancel(const unsigned int p_id);
+
+    // Get the result of a request
+    // Returns false until it's done, then p_image is the image, owned by the caller,
+    // or NULL if the file couldn't be decoded
+    const bool take(const unsigned int p_id, SDL_Surface *&p_image);
+
+    private:
+
+    // Forbidden
+    CImageLoader(void);
+    CImageLoader(const CImageLoader &p_source);
+    const CImageLoader &operator =(const CImageLoader &p_source);
+
+    // Destructor, cancels all requests
+    virtual ~CImageLoader(void);
+
+    struct T_REQUEST
+    {
+        unsigned int m_id;
+        std::string m_path;
+        int m_width;
+        int m_height;
+        CImageCache *m_cache;
+        bool m_running;
+        bool m_done;
+        // Read by the worker without the lock
+        std::atomic<bool> m_cancel;
+        SDL_Surface *m_image;
+    };
+
+    // Worker threads
+    void run(void);
+
+    // Decode and scale an image, in a worker thread
+    SDL_Surface *decode(const T_REQUEST &p_request);
+
+    // Requests, in decode order, protected by m_mutex
+    // Entries are not moved, the workers keep a reference to the running ones
+    std::list<T_REQUEST> m_requests;
+    unsigned int m_nextId;
+    bool m_quit;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+#endif
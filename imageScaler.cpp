@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#include "imageScaler.h"
+
+// Weights are fixed point, their sum for a pixel is 1 << IMAGE_SCALER_BITS
+// Weight x 255 x nb of weights must fit in 32 bits, and a weight in 16 bits signed
+#define IMAGE_SCALER_BITS 14
+
+namespace {
+
+// Source pixels of each destination pixel, along an axis
+// The pixels of destination i are m_start[i] to m_start[i] + m_nb[i] - 1,
+// with the weights m_weights[i * m_stride] to m_weights[i * m_stride + m_nb[i] - 1]
+struct T_AXIS
+{
+    std::vector<int> m_start;
+    std::vector<int> m_nb;
+    std::vector<Sint16> m_weights;
+    int m_stride;
+};
+
+void ComputeAxis(const int p_src, const int p_dest, T_AXIS &p_axis)
+{
+    const double l_scale = static_cast<double>(p_src) / p_dest;
+    p_axis.m_stride = p_dest < p_src ? static_cast<int>(std::ceil(l_scale)) + 1 : 2;
+    p_axis.m_start.resize(p_dest);
+    p_axis.m_nb.resize(p_dest);
+    p_axis.m_weights.assign(p_dest * p_axis.m_stride, 0);
+    std::vector<double> l_weights(p_axis.m_stride);
+    for (int l_i = 0; l_i < p_dest; ++l_i)
+    {
+        int l_start(0), l_nb(0);
+        if (p_dest < p_src)
+        {
+            // Area: the source pixels covered by the destination one, by their overlap
+            const double l_begin = l_i * l_scale;
+            const double l_end = std::min((l_i + 1) * l_scale, static_cast<double>(p_src));
+            l_start = static_cast<int>(l_begin);
+            l_nb = std::min(static_cast<int>(std::ceil(l_end)), p_src) - l_start;
+            for (int l_k = 0; l_k < l_nb; ++l_k)
+                l_weights[l_k] = (std::min(l_start + l_k + 1.0, l_end) - std::max(static_cast<double>(l_start + l_k), l_begin)) / l_scale;
+        }
+        else
+        {
+            // Bilinear: the two source pixels around the center of the destination one
+            const double l_x = std::max((l_i + 0.5) * l_scale - 0.5, 0.0);
+            l_start = static_cast<int>(l_x);
+            double l_fraction = l_x - l_start;
+            if (l_start >= p_src - 1)
+            {
+                l_start = p_src - 1;
+                l_fraction = 0.0;
+            }
+            l_nb = l_fraction > 0.0 ? 2 : 1;
+            l_weights[0] = 1.0 - l_fraction;
+            l_weights[1] = l_fraction;
+        }
+        // Fixed point, the rounding error goes to the largest weight
+        Sint16 *l_fixed = &p_axis.m_weights[l_i * p_axis.m_stride];
+        int l_sum(0), l_largest(0);
+        for (int l_k = 0; l_k < l_nb; ++l_k)
+        {
+            l_fixed[l_k] = static_cast<Sint16>(std::lround(l_weights[l_k] * (1 << IMAGE_SCALER_BITS)));
+            l_sum += l_fixed[l_k];
+            if (l_fixed[l_k] > l_fixed[l_largest])
+                l_largest = l_k;
+        }
+        l_fixed[l_largest] += (1 << IMAGE_SCALER_BITS) - l_sum;
+        p_axis.m_start[l_i] = l_start;
+        p_axis.m_nb[l_i] = l_nb;
+    }
+}
+
+// Rows of the source image with 4 bytes per pixel
+// RGB565 rows are expanded to R, G, B, 255 bytes, in a ring of p_nb rows
+class CRows
+{
+    public:
+
+    CRows(SDL_Surface *p_image, const int p_nb):
+        m_image(p_image),
+        m_rgb565(p_image->format->format == SDL_PIXELFORMAT_RGB565)
+    {
+        if (m_rgb565)
+        {
+            m_buffer.resize(p_nb * p_image->w * 4);
+            m_y.assign(p_nb, -1);
+        }
+    }
+
+    const Uint8 *get(const int p_y)
+    {
+        const Uint8 *l_row = static_cast<const Uint8 *>(m_image->pixels) + p_y * m_image->pitch;
+        if (!m_rgb565)
+            return l_row;
+        const int l_slot = p_y % m_y.size();
+        Uint8 *l_dest = &m_buffer[l_slot * m_image->w * 4];
+        if (m_y[l_slot] == p_y)
+            return l_dest;
+        m_y[l_slot] = p_y;
+        const Uint16 *l_pixel = reinterpret_cast<const Uint16 *>(l_row);
+        for (int l_x = 0; l_x < m_image->w; ++l_x, l_dest += 4)
+        {
+            const unsigned int l_r = l_pixel[l_x] >> 11, l_g = (l_pixel[l_x] >> 5) & 0x3F, l_b = l_pixel[l_x] & 0x1F;
+            l_dest[0] = l_r << 3 | l_r >> 2;
+            l_dest[1] = l_g << 2 | l_g >> 4;
+            l_dest[2] = l_b << 3 | l_b >> 2;
+            l_dest[3] = 255;
+        }
+        return &m_buffer[l_slot * m_image->w * 4];
+    }
+
+    private:
+
+    SDL_Surface *m_image;
+    const bool m_rgb565;
+    std::vector<Uint8> m_buffer;
+    std::vector<int> m_y;
+};
+
+// Weighted sum of p_nb rows of p_size bytes
+void ScaleVertical(const Uint8 *const *p_rows, const Sint16 *p_weights, const int p_nb, Uint8 *p_dest, const int p_size)
+{
+    int l_i(0);
+#if defined(__SSE2__)
+    const __m128i l_zero = _mm_setzero_si128();
+    for (; l_i + 16 <= p_size; l_i += 16)
+    {
+        __m128i l_acc[4];
+        for (int l_j = 0; l_j < 4; ++l_j)
+            l_acc[l_j] = _mm_set1_epi32(1 << (IMAGE_SCALER_BITS - 1));
+        // Rows by pairs: madd sums the products of the interleaved 16 bits values
+        for (int l_k = 0; l_k < p_nb; l_k += 2)
+        {
+            const bool l_pair = l_k + 1 < p_nb;
+            const __m128i l_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_rows[l_k] + l_i));
+            const __m128i l_b = l_pair ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_rows[l_k + 1] + l_i)) : l_zero;
+            const __m128i l_weights = _mm_set1_epi32(static_cast<Uint16>(l_pair ? p_weights[l_k + 1] : 0) << 16 | static_cast<Uint16>(p_weights[l_k]));
+            const __m128i l_lo = _mm_unpacklo_epi8(l_a, l_b);
+            const __m128i l_hi = _mm_unpackhi_epi8(l_a, l_b);
+            l_acc[0] = _mm_add_epi32(l_acc[0], _mm_madd_epi16(_mm_unpacklo_epi8(l_lo, l_zero), l_weights));
+            l_acc[1] = _mm_add_epi32(l_acc[1], _mm_madd_epi16(_mm_unpackhi_epi8(l_lo, l_zero), l_weights));
+            l_acc[2] = _mm_add_epi32(l_acc[2], _mm_madd_epi16(_mm_unpacklo_epi8(l_hi, l_zero), l_weights));
+            l_acc[3] = _mm_add_epi32(l_acc[3], _mm_madd_epi16(_mm_unpackhi_epi8(l_hi, l_zero), l_weights));
+        }
+        for (int l_j = 0; l_j < 4; ++l_j)
+            l_acc[l_j] = _mm_srai_epi32(l_acc[l_j], IMAGE_SCALER_BITS);
+        const __m128i l_result = _mm_packus_epi16(_mm_packs_epi32(l_acc[0], l_acc[1]), _mm_packs_epi32(l_acc[2], l_acc[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dest + l_i), l_result);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; l_i + 16 <= p_size; l_i += 16)
+    {
+        uint32x4_t l_acc[4];
+        for (int l_j = 0; l_j < 4; ++l_j)
+            l_acc[l_j] = vdupq_n_u32(0);
+        for (int l_k = 0; l_k < p_nb; ++l_k)
+        {
+            const uint8x16_t l_row = vld1q_u8(p_rows[l_k] + l_i);
+            const uint16x8_t l_lo = vmovl_u8(vget_low_u8(l_row));
+            const uint16x8_t l_hi = vmovl_u8(vget_high_u8(l_row));
+            const uint16_t l_weight = p_weights[l_k];
+            l_acc[0] = vmlal_n_u16(l_acc[0], vget_low_u16(l_lo), l_weight);
+            l_acc[1] = vmlal_n_u16(l_acc[1], vget_high_u16(l_lo), l_weight);
+            l_acc[2] = vmlal_n_u16(l_acc[2], vget_low_u16(l_hi), l_weight);
+            l_acc[3] = vmlal_n_u16(l_acc[3], vget_high_u16(l_hi), l_weight);
+        }
+        const uint8x8_t l_lo = vqmovn_u16(vcombine_u16(vrshrn_n_u32(l_acc[0], IMAGE_SCALER_BITS), vrshrn_n_u32(l_acc[1], IMAGE_SCALER_BITS)));
+        const uint8x8_t l_hi = vqmovn_u16(vcombine_u16(vrshrn_n_u32(l_acc[2], IMAGE_SCALER_BITS), vrshrn_n_u32(l_acc[3], IMAGE_SCALER_BITS)));
+        vst1q_u8(p_dest + l_i, vcombine_u8(l_lo, l_hi));
+    }
+#endif
+    // Remaining bytes
+    for (; l_i < p_size; ++l_i)
+    {
+        int l_acc(1 << (IMAGE_SCALER_BITS - 1));
+        for (int l_k = 0; l_k < p_nb; ++l_k)
+            l_acc += p_rows[l_k][l_i] * p_weights[l_k];
+        p_dest[l_i] = std::min(l_acc >> IMAGE_SCALER_BITS, 255);
+    }
+}
+
+// Weighted sums of the pixels of a row, 4 bytes per pixel
+void ScaleHorizontal(const Uint8 *p_src, const T_AXIS &p_axis, Uint8 *p_dest)
+{
+    const int l_width = p_axis.m_start.size();
+    for (int l_x = 0; l_x < l_width; ++l_x, p_dest += 4)
+    {
+        const Uint8 *l_src = p_src + p_axis.m_start[l_x] * 4;
+        const Sint16 *l_weights = &p_axis.m_weights[l_x * p_axis.m_stride];
+        const int l_nb = p_axis.m_nb[l_x];
+#if defined(__SSE2__)
+        const __m128i l_zero = _mm_setzero_si128();
+        __m128i l_acc = _mm_set1_epi32(1 << (IMAGE_SCALER_BITS - 1));
+        int l_k(0);
+        // Pixels by pairs, their channels interleaved for madd
+        for (; l_k + 1 < l_nb; l_k += 2)
+        {
+            const __m128i l_pixels = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(l_src + l_k * 4)), l_zero);
+            const __m128i l_weights2 = _mm_set1_epi32(static_cast<Uint16>(l_weights[l_k + 1]) << 16 | static_cast<Uint16>(l_weights[l_k]));
+            l_acc = _mm_add_epi32(l_acc, _mm_madd_epi16(_mm_unpacklo_epi16(l_pixels, _mm_srli_si128(l_pixels, 8)), l_weights2));
+        }
+        if (l_k < l_nb)
+        {
+            Uint32 l_pixel;
+            memcpy(&l_pixel, l_src + l_k * 4, 4);
+            const __m128i l_pixels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(l_pixel), l_zero);
+            l_acc = _mm_add_epi32(l_acc, _mm_madd_epi16(_mm_unpacklo_epi16(l_pixels, l_zero), _mm_set1_epi32(static_cast<Uint16>(l_weights[l_k]))));
+        }
+        l_acc = _mm_srai_epi32(l_acc, IMAGE_SCALER_BITS);
+        l_acc = _mm_packus_epi16(_mm_packs_epi32(l_acc, l_zero), l_zero);
+        const Uint32 l_result = _mm_cvtsi128_si32(l_acc);
+        memcpy(p_dest, &l_result, 4);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        uint32x4_t l_acc = vdupq_n_u32(0);
+        for (int l_k = 0; l_k < l_nb; ++l_k)
+        {
+            Uint32 l_pixel;
+            memcpy(&l_pixel, l_src + l_k * 4, 4);
+            const uint16x8_t l_channels = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(l_pixel)));
+            l_acc = vmlal_n_u16(l_acc, vget_low_u16(l_channels), static_cast<uint16_t>(l_weights[l_k]));
+        }
+        const uint16x4_t l_result = vrshrn_n_u32(l_acc, IMAGE_SCALER_BITS);
+        vst1_lane_u32(reinterpret_cast<uint32_t *>(p_dest), vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(l_result, l_result))), 0);
+#else
+        for (int l_c = 0; l_c < 4; ++l_c)
+        {
+            int l_acc(1 << (IMAGE_SCALER_BITS - 1));
+            for (int l_k = 0; l_k < l_nb; ++l_k)
+                l_acc += l_src[l_k * 4 + l_c] * l_weights[l_k];
+            p_dest[l_c] = std::min(l_acc >> IMAGE_SCALER_BITS, 255);
+        }
+#endif
+    }
+}
+
+// R, G, B bytes to RGB565
+void PackRgb565(const Uint8 *p_src, Uint16 *p_dest, const int p_width)
+{
+    for (int l_x = 0; l_x < p_width; ++l_x, p_src += 4)
+        p_dest[l_x] = ((p_src[0] * 31 + 127) / 255) << 11 | ((p_src[1] * 63 + 127) / 255) << 5 | (p_src[2] * 31 + 127) / 255;
+}
+
+} // namespace
+
+SDL_Surface *Image_scaler::scale(SDL_Surface *p_image, const int p_width, const int p_height)
+{
+    // Other formats are scaled as 4 bytes per pixel
+    SDL_Surface *l_src = p_image;
+    if (p_image->format->BytesPerPixel != 4 && p_image->format->format != SDL_PIXELFORMAT_RGB565)
+    {
+        l_src = SDL_ConvertSurfaceFormat(p_image, SDL_PIXELFORMAT_RGBA8888, 0);
+        if (l_src == NULL)
+            return NULL;
+    }
+    const int l_width = std::max(p_width, 1);
+    const int l_height = std::max(p_height, 1);
+    SDL_Surface *l_dest = SDL_CreateRGBSurfaceWithFormat(0, l_width, l_height, l_src->format->BitsPerPixel, l_src->format->format);
+    if (l_dest == NULL || l_src->w == 0 || l_src->h == 0)
+    {
+        if (l_src != p_image)
+            SDL_FreeSurface(l_src);
+        return l_dest;
+    }
+    T_AXIS l_axisX, l_axisY;
+    ComputeAxis(l_src->w, l_width, l_axisX);
+    ComputeAxis(l_src->h, l_height, l_axisY);
+    CRows l_rows(l_src, l_axisY.m_stride);
+    const bool l_rgb565 = l_dest->format->format == SDL_PIXELFORMAT_RGB565;
+    std::vector<const Uint8 *> l_taps(l_axisY.m_stride);
+    std::vector<Uint8> l_column(l_src->w * 4);
+    std::vector<Uint8> l_line(l_rgb565 ? l_width * 4 : 0);
+    for (int l_y = 0; l_y < l_height; ++l_y)
+    {
+        const int l_nb = l_axisY.m_nb[l_y];
+        for (int l_k = 0; l_k < l_nb; ++l_k)
+            l_taps[l_k] = l_rows.get(l_axisY.m_start[l_y] + l_k);
+        // A single row has the full weight
+        const Uint8 *l_src2 = l_taps[0];
+        if (l_nb > 1)
+        {
+            ScaleVertical(l_taps.data(), &l_axisY.m_weights[l_y * l_axisY.m_stride], l_nb, l_column.data(), l_column.size());
+            l_src2 = l_column.data();
+        }
+        Uint8 *l_row = static_cast<Uint8 *>(l_dest->pixels) + l_y * l_dest->pitch;
+        if (l_rgb565)
+        {
+            ScaleHorizontal(l_src2, l_axisX, l_line.data());
+            PackRgb565(l_line.data(), reinterpret_cast<Uint16 *>(l_row), l_width);
+        }
+        else
+        {
+            ScaleHorizontal(l_src2, l_axisX, l_row);
+        }
+    }
+    if (l_src != p_image)
+        SDL_FreeSurface(l_src);
+    return l_dest;
+}
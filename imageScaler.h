@@ -0,0 +1,17 @@
+#ifndef _IMAGE_SCALER_H_
+#define _IMAGE_SCALER_H_
+
+#include <SDL.h>
+
+// Scaler of the images of the viewer and of the icons
+// Each axis is reduced by area averaging, or enlarged by bilinear interpolation.
+// The inner loops use SSE2 or NEON when available.
+namespace Image_scaler
+{
+    // Scale an image to p_width x p_height, in a new surface
+    // 32 bits and RGB565 images keep their format, others are converted to RGBA8888
+    // Returns NULL on error, see SDL_GetError
+    SDL_Surface *scale(SDL_Surface *p_image, const int p_width, const int p_height);
+}
+
+#endif
@@ -0,0 +1,281 @@
+#include <iostream>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "jobQueue.h"
+#include "sizeIndex.h"
+#include "def.h"
+
+// Number of finished jobs kept for display
+#define JOBS_HISTORY_SIZE 4
+
+namespace {
+
+// Count the entries and bytes of a tree, like the engines process them
+void Scan(const int p_dirFd, const char *p_name, const std::atomic<bool> &p_cancel, unsigned long long int &p_bytes, unsigned int &p_files)
+{
+    struct stat l_stat;
+    if (p_cancel || fstatat(p_dirFd, p_name, &l_stat, AT_SYMLINK_NOFOLLOW) == -1)
+        return;
+    ++p_files;
+    if (S_ISREG(l_stat.st_mode))
+        p_bytes += l_stat.st_size;
+    if (!S_ISDIR(l_stat.st_mode))
+        return;
+    const int l_fd = openat(p_dirFd, p_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (l_fd == -1)
+        return;
+    DIR *l_dir = fdopendir(l_fd);
+    if (l_dir == NULL)
+    {
+        close(l_fd);
+        return;
+    }
+    struct dirent *l_ent;
+    while (!p_cancel && (l_ent = readdir(l_dir)) != NULL)
+    {
+        if (l_ent->d_name[0] == '.' && (l_ent->d_name[1] == '\0' || (l_ent->d_name[1] == '.' && l_ent->d_name[2] == '\0')))
+            continue;
+        Scan(l_fd, l_ent->d_name, p_cancel, p_bytes, p_files);
+    }
+    closedir(l_dir);
+}
+
+} // namespace
+
+CJobQueue::CJobQueue(void):
+    m_nextId(1),
+    m_nbFinished(0),
+    m_quit(false)
+{
+    m_worker = std::thread(&CJobQueue::run, this);
+}
+
+CJobQueue::~CJobQueue(void)
+{
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_quit = true;
+        for (std::list<T_JOB>::iterator l_it = m_jobs.begin(); l_it != m_jobs.end(); ++l_it)
+            l_it->m_progress.m_cancel = true;
+    }
+    m_condition.notify_all();
+    m_worker.join();
+}
+
+const unsigned int CJobQueue::add(const T_JOB_TYPE p_type, const std::vector<std::string> &p_sources, const std::string &p_dest)
+{
+    unsigned int l_id(0);
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_jobs.emplace_back();
+        T_JOB &l_job = m_jobs.back();
+        l_job.m_id = l_id = m_nextId++;
+        l_job.m_type = p_type;
+        l_job.m_sources = p_sources;
+        l_job.m_dest = p_dest;
+        l_job.m_status = T_JOB_QUEUED;
+        l_job.m_bytesTotal = 0;
+        l_job.m_filesTotal = 0;
+    }
+    INHIBIT(std::cout << "CJobQueue::add: job " << l_id << ", type " << p_type << ", " << p_sources.size() << " items" << std::endl;)
+    m_condition.notify_all();
+    return l_id;
+}
+
+void CJobQueue::cancel(const unsigned int p_id)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    for (std::list<T_JOB>::iterator l_it = m_jobs.begin(); l_it != m_jobs.end(); ++l_it)
+    {
+        if (l_it->m_id != p_id)
+            continue;
+        cancelJob(*l_it);
+        break;
+    }
+}
+
+void CJobQueue::cancelAll(void)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    for (std::list<T_JOB>::iterator l_it = m_jobs.begin(); l_it != m_jobs.end(); ++l_it)
+        cancelJob(*l_it);
+}
+
+void CJobQueue::cancelJob(T_JOB &p_job)
+{
+    if (p_job.m_status == T_JOB_QUEUED)
+    {
+        // Not started => finished now
+        p_job.m_status = T_JOB_CANCELLED;
+        p_job.m_start = p_job.m_end = std::chrono::steady_clock::now();
+        ++m_nbFinished;
+    }
+    else if (p_job.m_status == T_JOB_RUNNING)
+    {
+        p_job.m_progress.m_cancel = true;
+    }
+}
+
+void CJobQueue::getJobs(std::vector<T_JOB_INFO> &p_jobs) const
+{
+    const std::chrono::steady_clock::time_point l_now = std::chrono::steady_clock::now();
+    p_jobs.clear();
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    for (std::list<T_JOB>::const_iterator l_it = m_jobs.begin(); l_it != m_jobs.end(); ++l_it)
+    {
+        T_JOB_INFO l_info;
+        l_info.m_id = l_it->m_id;
+        l_info.m_type = l_it->m_type;
+        l_info.m_status = l_it->m_status;
+        l_info.m_nbItems = l_it->m_sources.size();
+        l_info.m_bytesDone = l_it->m_progress.m_bytes;
+        l_info.m_bytesTotal = l_it->m_bytesTotal;
+        l_info.m_filesDone = l_it->m_progress.m_files;
+        l_info.m_filesTotal = l_it->m_filesTotal;
+        l_info.m_seconds = 0.0;
+        if (l_it->m_status != T_JOB_QUEUED)
+            l_info.m_seconds = std::chrono::duration<double>((l_it->m_status == T_JOB_RUNNING ? l_now : l_it->m_end) - l_it->m_start).count();
+        {
+            std::lock_guard<std::mutex> l_currentLock(l_it->m_progress.m_mutex);
+            l_info.m_current = l_it->m_progress.m_current;
+        }
+        p_jobs.push_back(l_info);
+    }
+}
+
+const bool CJobQueue::isBusy(void) const
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    for (std::list<T_JOB>::const_iterator l_it = m_jobs.begin(); l_it != m_jobs.end(); ++l_it)
+    {
+        if (l_it->m_status == T_JOB_QUEUED || l_it->m_status == T_JOB_RUNNING)
+            return true;
+    }
+    return false;
+}
+
+const unsigned int CJobQueue::takeNbFinished(void)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    const unsigned int l_ret = m_nbFinished;
+    m_nbFinished = 0;
+    return l_ret;
+}
+
+void CJobQueue::run(void)
+{
+    std::unique_lock<std::mutex> l_lock(m_mutex);
+    while (!m_quit)
+    {
+        // Next queued job
+        std::list<T_JOB>::iterator l_job = m_jobs.begin();
+        while (l_job != m_jobs.end() && l_job->m_status != T_JOB_QUEUED)
+            ++l_job;
+        if (l_job == m_jobs.end())
+        {
+            m_condition.wait(l_lock);
+            continue;
+        }
+        l_job->m_status = T_JOB_RUNNING;
+        l_job->m_start = std::chrono::steady_clock::now();
+        l_lock.unlock();
+        const bool l_ok = execute(*l_job);
+        // Dirs overwritten in or removed are forgotten by the size index
+        CSizeIndex::instance().save();
+        l_lock.lock();
+        l_job->m_end = std::chrono::steady_clock::now();
+        l_job->m_status = l_job->m_progress.m_cancel ? T_JOB_CANCELLED : (l_ok ? T_JOB_DONE : T_JOB_FAILED);
+        ++m_nbFinished;
+        INHIBIT(std::cout << "CJobQueue::run: job " << l_job->m_id << " finished with status " << l_job->m_status << " in " << std::chrono::duration<double>(l_job->m_end - l_job->m_start).count() << "s" << std::endl;)
+        // Forget the oldest finished jobs
+        unsigned int l_nbFinished(0);
+        for (std::list<T_JOB>::reverse_iterator l_it = m_jobs.rbegin(); l_it != m_jobs.rend(); ++l_it)
+        {
+            if (l_it->m_status != T_JOB_QUEUED && l_it->m_status != T_JOB_RUNNING)
+                ++l_nbFinished;
+        }
+        for (std::list<T_JOB>::iterator l_it = m_jobs.begin(); l_nbFinished > JOBS_HISTORY_SIZE && l_it != m_jobs.end(); )
+        {
+            if (l_it->m_status != T_JOB_QUEUED && l_it->m_status != T_JOB_RUNNING)
+            {
+                l_it = m_jobs.erase(l_it);
+                --l_nbFinished;
+            }
+            else
+            {
+                ++l_it;
+            }
+        }
+    }
+}
+
+const bool CJobQueue::execute(T_JOB &p_job)
+{
+    bool l_ret(false);
+    switch (p_job.m_type)
+    {
+        case T_JOB_COPY:
+        {
+            // Totals first, for the progress and the ETA
+            unsigned long long int l_bytes(0);
+            unsigned int l_files(0);
+            for (std::vector<std::string>::const_iterator l_it = p_job.m_sources.begin(); l_it != p_job.m_sources.end(); ++l_it)
+                Scan(AT_FDCWD, l_it->c_str(), p_job.m_progress.m_cancel, l_bytes, l_files);
+            {
+                std::lock_guard<std::mutex> l_lock(m_mutex);
+                p_job.m_bytesTotal = l_bytes;
+                p_job.m_filesTotal = l_files;
+            }
+            l_ret = File_utils::copyFile(p_job.m_sources, p_job.m_dest, &p_job.m_progress);
+            break;
+        }
+        case T_JOB_MOVE:
+        {
+            // Renames are counted per item, copies to another file system like copies
+            unsigned long long int l_bytes(0);
+            unsigned int l_files(p_job.m_sources.size());
+            struct stat l_destStat;
+            struct stat l_stat;
+            if (stat(p_job.m_dest.c_str(), &l_destStat) == 0)
+            {
+                for (std::vector<std::string>::const_iterator l_it = p_job.m_sources.begin(); l_it != p_job.m_sources.end(); ++l_it)
+                {
+                    if (lstat(l_it->c_str(), &l_stat) == 0 && l_stat.st_dev != l_destStat.st_dev)
+                    {
+                        l_files = 0;
+                        for (l_it = p_job.m_sources.begin(); l_it != p_job.m_sources.end(); ++l_it)
+                            Scan(AT_FDCWD, l_it->c_str(), p_job.m_progress.m_cancel, l_bytes, l_files);
+                        break;
+                    }
+                }
+            }
+            {
+                std::lock_guard<std::mutex> l_lock(m_mutex);
+                p_job.m_bytesTotal = l_bytes;
+                p_job.m_filesTotal = l_files;
+            }
+            l_ret = File_utils::moveFile(p_job.m_sources, p_job.m_dest, &p_job.m_progress);
+            break;
+        }
+        case T_JOB_DELETE:
+        {
+            // Number of entries first, the size doesn't matter
+            unsigned long long int l_bytes(0);
+            unsigned int l_files(0);
+            for (std::vector<std::string>::const_iterator l_it = p_job.m_sources.begin(); l_it != p_job.m_sources.end(); ++l_it)
+                Scan(AT_FDCWD, l_it->c_str(), p_job.m_progress.m_cancel, l_bytes, l_files);
+            {
+                std::lock_guard<std::mutex> l_lock(m_mutex);
+                p_job.m_filesTotal = l_files;
+            }
+            l_ret = File_utils::removeFile(p_job.m_sources, &p_job.m_progress);
+            break;
+        }
+        default:
+            break;
+    }
+    return l_ret;
+}
@@ -0,0 +1,122 @@
+#ifndef _JOB_QUEUE_H_
+#define _JOB_QUEUE_H_
+
+#include <list>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "fileutils.h"
+
+// File operations done by the job queue
+typedef enum
+{
+    T_JOB_COPY = 0,
+    T_JOB_MOVE,
+    T_JOB_DELETE
+}
+T_JOB_TYPE;
+
+typedef enum
+{
+    T_JOB_QUEUED = 0,
+    T_JOB_RUNNING,
+    T_JOB_DONE,
+    T_JOB_FAILED,
+    T_JOB_CANCELLED
+}
+T_JOB_STATUS;
+
+// Snapshot of a job, for display
+struct T_JOB_INFO
+{
+    unsigned int m_id;
+    T_JOB_TYPE m_type;
+    T_JOB_STATUS m_status;
+    // Number of selected items
+    unsigned int m_nbItems;
+    // Item being processed
+    std::string m_current;
+    // Progress, totals are 0 until known
+    unsigned long long int m_bytesDone;
+    unsigned long long int m_bytesTotal;
+    unsigned int m_filesDone;
+    unsigned int m_filesTotal;
+    // Running time, in seconds
+    double m_seconds;
+};
+
+// Queue of file operations, executed in order by a worker thread
+class CJobQueue
+{
+    public:
+
+    // Constructor
+    CJobQueue(void);
+
+    // Destructor, cancels all jobs
+    virtual ~CJobQueue(void);
+
+    // Add a job, executed after the previous ones
+    // Returns its id
+    const unsigned int add(const T_JOB_TYPE p_type, const std::vector<std::string> &p_sources, const std::string &p_dest = "");
+
+    // Cancel a job, queued or running
+    void cancel(const unsigned int p_id);
+
+    // Cancel all queued and running jobs
+    void cancelAll(void);
+
+    // Get the queued and running jobs, and the last finished ones
+    void getJobs(std::vector<T_JOB_INFO> &p_jobs) const;
+
+    // True if a job is queued or running
+    const bool isBusy(void) const;
+
+    // Number of jobs finished since the last call
+    const unsigned int takeNbFinished(void);
+
+    private:
+
+    // Forbidden
+    CJobQueue(const CJobQueue &p_source);
+    const CJobQueue &operator =(const CJobQueue &p_source);
+
+    struct T_JOB
+    {
+        unsigned int m_id;
+        T_JOB_TYPE m_type;
+        std::vector<std::string> m_sources;
+        std::string m_dest;
+        T_JOB_STATUS m_status;
+        unsigned long long int m_bytesTotal;
+        unsigned int m_filesTotal;
+        std::chrono::steady_clock::time_point m_start;
+        std::chrono::steady_clock::time_point m_end;
+        T_PROGRESS m_progress;
+    };
+
+    // Worker thread
+    void run(void);
+
+    // Do the operation of a job, in the worker thread
+    const bool execute(T_JOB &p_job);
+
+    // Cancel a job, m_mutex locked
+    void cancelJob(T_JOB &p_job);
+
+    // Jobs, oldest first, protected by m_mutex
+    // Entries are not moved, the worker keeps a reference to the running one
+    std::list<T_JOB> m_jobs;
+    unsigned int m_nextId;
+    unsigned int m_nbFinished;
+    bool m_quit;
+
+    std::thread m_worker;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <SDL.h>
+#include "lineIndex.h"
+#include "def.h"
+
+// One offset kept every LINE_INDEX_STEP lines
+#define LINE_INDEX_STEP 256
+// Bytes scanned at a time
+#define LINE_INDEX_CHUNK (MAPPED_FILE_WINDOW / 2)
+
+CLineIndex::CLineIndex(void):
+    m_nbLines(0),
+    m_nbBytes(0),
+    m_done(true),
+    m_cancel(false)
+{
+}
+
+CLineIndex::~CLineIndex(void)
+{
+    m_cancel = true;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void CLineIndex::start(const std::string &p_path)
+{
+    m_done = false;
+    m_thread = std::thread(&CLineIndex::run, this, p_path);
+}
+
+const std::size_t CLineIndex::getLineLength(const char *p_data, const std::size_t p_size)
+{
+    const char *l_end = static_cast<const char *>(memchr(p_data, '\n', std::min(p_size, static_cast<std::size_t>(LINE_SIZE_MAX))));
+    if (l_end != NULL)
+        return l_end - p_data + 1;
+    if (p_size <= LINE_SIZE_MAX)
+        return 0;
+    // Too long => cut, but not inside a UTF-8 character
+    std::size_t l_length = LINE_SIZE_MAX;
+    while (l_length > LINE_SIZE_MAX - 3 && (p_data[l_length] & 0xC0) == 0x80)
+        --l_length;
+    return l_length;
+}
+
+void CLineIndex::run(const std::string p_path)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    CMappedFile l_file;
+    if (!l_file.open(p_path))
+    {
+        m_done = true;
+        return;
+    }
+    const unsigned long long int l_size = l_file.getSize();
+    unsigned long long int l_offset(0);
+    unsigned long long int l_nbLines(0);
+    while (l_offset < l_size && !m_cancel)
+    {
+        const std::size_t l_chunkSize = std::min(static_cast<unsigned long long int>(LINE_INDEX_CHUNK), l_size - l_offset);
+        const char *l_data = l_file.get(l_offset, l_chunkSize);
+        if (l_data == NULL)
+            break;
+        const bool l_last = l_offset + l_chunkSize == l_size;
+        std::size_t l_pos(0);
+        std::vector<unsigned long long int> l_checkpoints;
+        while (l_pos < l_chunkSize)
+        {
+            std::size_t l_length = getLineLength(l_data + l_pos, l_chunkSize - l_pos);
+            if (l_length == 0)
+            {
+                // Incomplete => in the next chunk, unless it's the end of the file
+                if (!l_last)
+                    break;
+                l_length = l_chunkSize - l_pos;
+            }
+            if (l_nbLines % LINE_INDEX_STEP == 0)
+                l_checkpoints.push_back(l_offset + l_pos);
+            ++l_nbLines;
+            l_pos += l_length;
+        }
+        if (!l_checkpoints.empty())
+        {
+            std::lock_guard<std::mutex> l_lock(m_mutex);
+            m_checkpoints.insert(m_checkpoints.end(), l_checkpoints.begin(), l_checkpoints.end());
+        }
+        // Lines are visible once their checkpoint is stored
+        m_nbLines = l_nbLines;
+        l_offset += l_pos;
+        m_nbBytes = l_offset;
+    }
+    m_done = true;
+    INHIBIT(std::cout << "CLineIndex::run: " << p_path << ": " << l_nbLines << " lines in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+}
+
+const unsigned long long int CLineIndex::getNbLines(void) const
+{
+    return m_nbLines;
+}
+
+const bool CLineIndex::isDone(void) const
+{
+    return m_done;
+}
+
+const unsigned long long int CLineIndex::getNbBytes(void) const
+{
+    return m_nbBytes;
+}
+
+const unsigned long long int CLineIndex::getOffset(CMappedFile &p_file, const unsigned long long int p_line) const
+{
+    unsigned long long int l_offset(0);
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        if (p_line / LINE_INDEX_STEP < m_checkpoints.size())
+            l_offset = m_checkpoints[p_line / LINE_INDEX_STEP];
+    }
+    // From the checkpoint, LINE_INDEX_STEP lines at most
+    for (unsigned int l_i = p_line % LINE_INDEX_STEP; l_i > 0; --l_i)
+    {
+        const std::size_t l_size = std::min(static_cast<unsigned long long int>(LINE_SIZE_MAX + 1), p_file.getSize() - l_offset);
+        const char *l_data = p_file.get(l_offset, l_size);
+        if (l_data == NULL)
+            break;
+        const std::size_t l_length = getLineLength(l_data, l_size);
+        l_offset += l_length ? l_length : l_size;
+    }
+    return l_offset;
+}
+
+const unsigned long long int CLineIndex::getLine(CMappedFile &p_file, const unsigned long long int p_offset) const
+{
+    unsigned long long int l_line(0);
+    unsigned long long int l_offset(0);
+    {
+        // Last checkpoint before the offset
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        const std::vector<unsigned long long int>::const_iterator l_it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), p_offset);
+        if (l_it != m_checkpoints.begin())
+        {
+            l_line = (l_it - m_checkpoints.begin() - 1) * LINE_INDEX_STEP;
+            l_offset = *(l_it - 1);
+        }
+    }
+    // Then line by line
+    for (;;)
+    {
+        const std::size_t l_size = std::min(static_cast<unsigned long long int>(LINE_SIZE_MAX + 1), p_file.getSize() - l_offset);
+        const char *l_data = p_file.get(l_offset, l_size);
+        if (l_data == NULL)
+            break;
+        const std::size_t l_length = getLineLength(l_data, l_size);
+        if (l_offset + (l_length ? l_length : l_size) > p_offset)
+            break;
+        l_offset += l_length ? l_length : l_size;
+        ++l_line;
+    }
+    return l_line;
+}
@@ -0,0 +1,69 @@
+#ifndef _LINE_INDEX_H_
+#define _LINE_INDEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mappedFile.h"
+
+// Longer lines are cut, so that any line is read in bounded time
+#define LINE_SIZE_MAX 4096
+
+// Sparse index of the lines of a file, built in the background
+// The offset of one line in LINE_INDEX_STEP is kept, the others are found from it
+class CLineIndex
+{
+    public:
+
+    // Constructor
+    CLineIndex(void);
+
+    // Destructor, stops the indexing
+    virtual ~CLineIndex(void);
+
+    // Start indexing the given file
+    void start(const std::string &p_path);
+
+    // Number of lines indexed so far
+    const unsigned long long int getNbLines(void) const;
+
+    // True when the whole file is indexed
+    const bool isDone(void) const;
+
+    // Size of the part of the file indexed so far
+    const unsigned long long int getNbBytes(void) const;
+
+    // Offset of a line, p_line < getNbLines(), read from p_file
+    const unsigned long long int getOffset(CMappedFile &p_file, const unsigned long long int p_line) const;
+
+    // Line containing an offset, p_offset < getNbBytes(), read from p_file
+    const unsigned long long int getLine(CMappedFile &p_file, const unsigned long long int p_offset) const;
+
+    // Length of the line at the beginning of p_data, '\n' included
+    // Up to LINE_SIZE_MAX + 1 bytes are read, returns 0 if the line is not complete in p_size bytes
+    static const std::size_t getLineLength(const char *p_data, const std::size_t p_size);
+
+    private:
+
+    // Forbidden
+    CLineIndex(const CLineIndex &p_source);
+    const CLineIndex &operator =(const CLineIndex &p_source);
+
+    // Indexing thread
+    void run(const std::string p_path);
+
+    // Offsets of the lines 0, LINE_INDEX_STEP, 2 * LINE_INDEX_STEP...
+    std::vector<unsigned long long int> m_checkpoints;
+    mutable std::mutex m_mutex;
+
+    std::atomic<unsigned long long int> m_nbLines;
+    std::atomic<unsigned long long int> m_nbBytes;
+    std::atomic<bool> m_done;
+    std::atomic<bool> m_cancel;
+    std::thread m_thread;
+};
+
+#endif
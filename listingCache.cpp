@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iterator>
+#include <time.h>
+#include "listingCache.h"
+#include "def.h"
+
+CListingCache& CListingCache::instance(void)
+{
+    static CListingCache l_singleton;
+    return l_singleton;
+}
+
+CListingCache::CListingCache(void) :
+    m_bytes(0),
+    m_nbHits(0),
+    m_nbMisses(0)
+{
+}
+
+const bool CListingCache::get(const std::string &p_path, const struct stat &p_stat, const T_SORT_MODE p_mode, T_FILE_LIST &p_dirs, T_FILE_LIST &p_files)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    std::unordered_map<std::string, std::list<T_ENTRY>::iterator>::iterator l_it = m_index.find(p_path);
+    if (l_it == m_index.end())
+    {
+        ++m_nbMisses;
+        INHIBIT(std::cout << "CListingCache: miss " << p_path << " (" << m_nbHits << " hits, " << m_nbMisses << " misses)" << std::endl;)
+        return false;
+    }
+    const T_ENTRY &l_entry = *l_it->second;
+    if (l_entry.m_mode != p_mode || l_entry.m_dev != p_stat.st_dev || l_entry.m_ino != p_stat.st_ino || l_entry.m_mtime.tv_sec != p_stat.st_mtim.tv_sec || l_entry.m_mtime.tv_nsec != p_stat.st_mtim.tv_nsec)
+    {
+        // The dir has changed, or the sort order
+        erase(l_it->second);
+        ++m_nbMisses;
+        INHIBIT(std::cout << "CListingCache: stale " << p_path << " (" << m_nbHits << " hits, " << m_nbMisses << " misses)" << std::endl;)
+        return false;
+    }
+    // Move to the front
+    m_entries.splice(m_entries.begin(), m_entries, l_it->second);
+    p_dirs = l_entry.m_dirs;
+    p_files = l_entry.m_files;
+    ++m_nbHits;
+    INHIBIT(std::cout << "CListingCache: hit " << p_path << " (" << m_nbHits << " hits, " << m_nbMisses << " misses)" << std::endl;)
+    return true;
+}
+
+void CListingCache::put(const std::string &p_path, const struct stat &p_stat, const T_SORT_MODE p_mode, const T_FILE_LIST &p_dirs, const T_FILE_LIST &p_files)
+{
+    // A dir modified within the mtime granularity (2s on FAT) could change
+    // again without its mtime changing => don't cache it yet
+    struct timespec l_now;
+    clock_gettime(CLOCK_REALTIME, &l_now);
+    if (l_now.tv_sec - p_stat.st_mtim.tv_sec < 2)
+        return;
+    T_ENTRY l_entry;
+    l_entry.m_path = p_path;
+    l_entry.m_dev = p_stat.st_dev;
+    l_entry.m_ino = p_stat.st_ino;
+    l_entry.m_mtime = p_stat.st_mtim;
+    l_entry.m_mode = p_mode;
+    l_entry.m_dirs = p_dirs;
+    l_entry.m_files = p_files;
+    // File sizes can change without the dir changing => don't keep them
+    l_entry.m_files.resetSizes();
+    l_entry.m_bytes = sizeof(T_ENTRY) + p_path.size() + l_entry.m_dirs.bytes() + l_entry.m_files.bytes();
+    if (l_entry.m_bytes > LISTING_CACHE_SIZE_MAX)
+        return;
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    std::unordered_map<std::string, std::list<T_ENTRY>::iterator>::iterator l_it = m_index.find(p_path);
+    if (l_it != m_index.end())
+        erase(l_it->second);
+    // Evict the least recently used entries
+    while (!m_entries.empty() && m_bytes + l_entry.m_bytes > LISTING_CACHE_SIZE_MAX)
+        erase(std::prev(m_entries.end()));
+    m_bytes += l_entry.m_bytes;
+    m_entries.push_front(std::move(l_entry));
+    m_index[p_path] = m_entries.begin();
+}
+
+void CListingCache::erase(std::list<T_ENTRY>::iterator p_it)
+{
+    m_bytes -= p_it->m_bytes;
+    m_index.erase(p_it->m_path);
+    m_entries.erase(p_it);
+}
+
+const unsigned int CListingCache::getNbHits(void) const
+{
+    return m_nbHits;
+}
+
+const unsigned int CListingCache::getNbMisses(void) const
+{
+    return m_nbMisses;
+}
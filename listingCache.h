@@ -0,0 +1,69 @@
+#ifndef _LISTING_CACHE_H_
+#define _LISTING_CACHE_H_
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include "fileLister.h"
+
+// LRU cache of sorted dir listings
+// An entry is valid as long as the dir has the same device, inode and mtime
+class CListingCache
+{
+    public:
+
+    // Method to get the instance
+    static CListingCache& instance(void);
+
+    // Get the listing of the given dir, stat'ed in p_stat, sorted in p_mode
+    // Returns false if it's not cached or if the dir has changed
+    const bool get(const std::string &p_path, const struct stat &p_stat, const T_SORT_MODE p_mode, T_FILE_LIST &p_dirs, T_FILE_LIST &p_files);
+
+    // Store the listing of the given dir, stat'ed in p_stat before reading it
+    void put(const std::string &p_path, const struct stat &p_stat, const T_SORT_MODE p_mode, const T_FILE_LIST &p_dirs, const T_FILE_LIST &p_files);
+
+    // Statistics
+    const unsigned int getNbHits(void) const;
+    const unsigned int getNbMisses(void) const;
+
+    private:
+
+    // Forbidden
+    CListingCache(void);
+    CListingCache(const CListingCache &p_source);
+    const CListingCache &operator =(const CListingCache &p_source);
+
+    struct T_ENTRY
+    {
+        std::string m_path;
+        dev_t m_dev;
+        ino_t m_ino;
+        struct timespec m_mtime;
+        T_SORT_MODE m_mode;
+        T_FILE_LIST m_dirs;
+        T_FILE_LIST m_files;
+        std::size_t m_bytes;
+    };
+
+    // Remove the given entry
+    void erase(std::list<T_ENTRY>::iterator p_it);
+
+    // Entries, most recently used first
+    std::list<T_ENTRY> m_entries;
+    std::unordered_map<std::string, std::list<T_ENTRY>::iterator> m_index;
+
+    // Approximate memory used by the entries
+    std::size_t m_bytes;
+
+    // Statistics
+    unsigned int m_nbHits;
+    unsigned int m_nbMisses;
+
+    // Entries are stored by the lister threads
+    std::mutex m_mutex;
+};
+
+#endif
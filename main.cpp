@@ -11,16 +11,7 @@
 #include "resourceManager.h"
 #include "commander.h"
 
-// Globals
-SDL_Surface *ScreenSurface;
-
-SDL_Window *Globals::g_sdlwindow=NULL;
-SDL_Surface *Globals::g_screen = NULL;
-const SDL_Color Globals::g_colorTextNormal = {COLOR_TEXT_NORMAL};
-const SDL_Color Globals::g_colorTextTitle = {COLOR_TEXT_TITLE};
-const SDL_Color Globals::g_colorTextDir = {COLOR_TEXT_DIR};
-const SDL_Color Globals::g_colorTextSelected = {COLOR_TEXT_SELECTED};
-std::vector<CWindow *> Globals::g_windows;
+extern SDL_Surface *ScreenSurface;
 
 namespace {
 
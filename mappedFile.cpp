@@ -0,0 +1,122 @@
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mappedFile.h"
+#include "def.h"
+
+CMappedFile::CMappedFile(void):
+    m_fd(-1),
+    m_size(0),
+    m_data(NULL),
+    m_dataOffset(0),
+    m_dataSize(0),
+    m_whole(false)
+{
+}
+
+CMappedFile::~CMappedFile(void)
+{
+    close();
+}
+
+const bool CMappedFile::open(const std::string &p_path)
+{
+    close();
+    m_fd = ::open(p_path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat l_stat;
+    if (m_fd == -1 || fstat(m_fd, &l_stat) == -1)
+    {
+        std::cerr << "CMappedFile::open: Error open " << p_path << ": " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    m_size = l_stat.st_size;
+    // Whole file when the address space allows it, a window is mapped on demand otherwise
+    if (sizeof(void *) >= 8 && m_size > 0)
+    {
+        void *l_data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (l_data != MAP_FAILED)
+        {
+            m_data = static_cast<char *>(l_data);
+            m_dataSize = m_size;
+            m_whole = true;
+        }
+    }
+    INHIBIT(std::cout << "CMappedFile::open: " << p_path << ": " << m_size << " bytes, " << (m_whole ? "whole" : "windowed") << std::endl;)
+    return true;
+}
+
+void CMappedFile::close(void)
+{
+    if (m_data != NULL)
+    {
+        munmap(m_data, m_dataSize);
+        m_data = NULL;
+    }
+    if (m_fd != -1)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+    m_dataOffset = 0;
+    m_dataSize = 0;
+    m_whole = false;
+    std::vector<char>().swap(m_buffer);
+}
+
+const unsigned long long int CMappedFile::getSize(void) const
+{
+    return m_size;
+}
+
+const char *CMappedFile::get(const unsigned long long int p_offset, const std::size_t p_length)
+{
+    if (m_fd == -1 || p_offset + p_length > m_size || p_offset >= m_size)
+        return NULL;
+    // Pages past the end of a file truncated meanwhile would raise SIGBUS
+    // => what remains is read into the buffer instead, padded with zeros
+    struct stat l_stat;
+    if (fstat(m_fd, &l_stat) == 0 && static_cast<unsigned long long int>(l_stat.st_size) < p_offset + p_length)
+    {
+        if (static_cast<unsigned long long int>(l_stat.st_size) <= p_offset)
+            return NULL;
+        INHIBIT(std::cout << "CMappedFile::get: file truncated to " << l_stat.st_size << " bytes, reading " << p_offset << std::endl;)
+        m_buffer.assign(p_length, '\0');
+        std::size_t l_done(0);
+        while (l_done < p_length)
+        {
+            const ssize_t l_nb = pread(m_fd, &m_buffer[l_done], p_length - l_done, p_offset + l_done);
+            if (l_nb > 0)
+                l_done += l_nb;
+            else if (l_nb == 0 || errno != EINTR)
+                break;
+        }
+        return &m_buffer[0];
+    }
+    if (m_data != NULL && p_offset >= m_dataOffset && p_offset + p_length <= m_dataOffset + m_dataSize)
+        return m_data + (p_offset - m_dataOffset);
+    // Move the window, aligned on a page
+    if (m_data != NULL)
+    {
+        munmap(m_data, m_dataSize);
+        m_data = NULL;
+    }
+    const unsigned long long int l_pageSize = sysconf(_SC_PAGESIZE);
+    m_dataOffset = p_offset - p_offset % l_pageSize;
+    m_dataSize = std::min(static_cast<unsigned long long int>(MAPPED_FILE_WINDOW), m_size - m_dataOffset);
+    void *l_data = mmap(NULL, m_dataSize, PROT_READ, MAP_SHARED, m_fd, m_dataOffset);
+    if (l_data == MAP_FAILED)
+    {
+        std::cerr << "CMappedFile::get: Error mmap: " << strerror(errno) << std::endl;
+        m_dataSize = 0;
+        return NULL;
+    }
+    m_data = static_cast<char *>(l_data);
+    return m_data + (p_offset - m_dataOffset);
+}
@@ -0,0 +1,57 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only memory mapping of a file of any size
+// The whole file is mapped on 64 bit systems, a sliding window elsewhere
+// An object is used by one thread at a time, each thread opens its own
+class CMappedFile
+{
+    public:
+
+    // Constructor
+    CMappedFile(void);
+
+    // Destructor
+    virtual ~CMappedFile(void);
+
+    // Map the given file
+    const bool open(const std::string &p_path);
+
+    // Unmap the file
+    void close(void);
+
+    // Size of the file when it was opened
+    const unsigned long long int getSize(void) const;
+
+    // Bytes [p_offset, p_offset + p_length) of the file, p_length <= MAPPED_FILE_WINDOW / 2
+    // The pointer is valid until the next call, NULL past the end
+    // If the file was truncated meanwhile, the missing bytes are zeros
+    const char *get(const unsigned long long int p_offset, const std::size_t p_length);
+
+    private:
+
+    // Forbidden
+    CMappedFile(const CMappedFile &p_source);
+    const CMappedFile &operator =(const CMappedFile &p_source);
+
+    // File descriptor, kept for the windows
+    int m_fd;
+    unsigned long long int m_size;
+
+    // Mapped part of the file
+    char *m_data;
+    unsigned long long int m_dataOffset;
+    std::size_t m_dataSize;
+
+    // True if the whole file is mapped
+    bool m_whole;
+
+    // Bytes read when the file was truncated after it was opened
+    std::vector<char> m_buffer;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <SDL.h>
+#include "mountList.h"
+#include "def.h"
+
+namespace {
+
+// File systems without storage
+const char * const g_pseudoTypes[] = {
+    "autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs", "debugfs", "devpts", "devtmpfs",
+    "efivarfs", "fusectl", "hugetlbfs", "mqueue", "nsfs", "proc", "pstore", "rpc_pipefs", "securityfs",
+    "sysfs", "tracefs", NULL
+};
+
+bool IsPseudo(const std::string &p_type)
+{
+    for (const char * const *l_type = g_pseudoTypes; *l_type != NULL; ++l_type)
+    {
+        if (p_type == *l_type)
+            return true;
+    }
+    return false;
+}
+
+// mountinfo escapes spaces, tabs, newlines and backslashes as \ooo
+std::string Unescape(const std::string &p_field)
+{
+    std::string l_ret;
+    l_ret.reserve(p_field.size());
+    for (std::size_t l_i = 0; l_i < p_field.size(); ++l_i)
+    {
+        if (p_field[l_i] == '\\' && l_i + 3 < p_field.size() && p_field[l_i + 1] >= '0' && p_field[l_i + 1] <= '3')
+        {
+            l_ret += static_cast<char>(((p_field[l_i + 1] - '0') << 6) | ((p_field[l_i + 2] - '0') << 3) | (p_field[l_i + 3] - '0'));
+            l_i += 3;
+        }
+        else
+        {
+            l_ret += p_field[l_i];
+        }
+    }
+    return l_ret;
+}
+
+bool CompareMountPoints(const T_MOUNT &p_a, const T_MOUNT &p_b)
+{
+    return p_a.m_mountPoint < p_b.m_mountPoint;
+}
+
+} // namespace
+
+CMountList& CMountList::instance(void)
+{
+    static CMountList l_singleton;
+    return l_singleton;
+}
+
+CMountList::CMountList(void):
+    m_generation(0),
+    m_running(false)
+{
+}
+
+CMountList::~CMountList(void)
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void CMountList::refresh(void)
+{
+    if (m_running)
+        return;
+    if (m_thread.joinable())
+        m_thread.join();
+    m_running = true;
+    m_thread = std::thread(&CMountList::run, this);
+}
+
+const unsigned int CMountList::getMounts(std::vector<T_MOUNT> &p_mounts) const
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    p_mounts = m_mounts;
+    return m_generation;
+}
+
+void CMountList::run(void)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    std::vector<T_MOUNT> l_mounts;
+    // Device ("major:minor") of each mount, and its root in the device
+    std::vector<std::pair<std::string, bool> > l_devices;
+    std::ifstream l_file("/proc/self/mountinfo");
+    if (!l_file.is_open())
+        std::cerr << "CMountList::run: Error opening /proc/self/mountinfo" << std::endl;
+    std::string l_line;
+    while (std::getline(l_file, l_line))
+    {
+        // ID, parent ID, major:minor, root, mount point, options, optional fields, "-", type, source, super options
+        std::istringstream l_iss(l_line);
+        std::vector<std::string> l_fields;
+        std::string l_field;
+        while (l_iss >> l_field)
+            l_fields.push_back(l_field);
+        const std::vector<std::string>::iterator l_separator = std::find(l_fields.begin(), l_fields.end(), "-");
+        if (l_fields.size() < 6 || l_separator == l_fields.end() || l_fields.end() - l_separator < 3)
+            continue;
+        T_MOUNT l_mount;
+        l_mount.m_mountPoint = Unescape(l_fields[4]);
+        l_mount.m_type = *(l_separator + 1);
+        l_mount.m_device = Unescape(*(l_separator + 2));
+        if (IsPseudo(l_mount.m_type))
+            continue;
+        struct statvfs l_stat;
+        if (statvfs(l_mount.m_mountPoint.c_str(), &l_stat) == -1 || l_stat.f_blocks == 0)
+            continue;
+        l_mount.m_size = static_cast<unsigned long long int>(l_stat.f_blocks) * l_stat.f_frsize;
+        l_mount.m_used = static_cast<unsigned long long int>(l_stat.f_blocks - l_stat.f_bfree) * l_stat.f_frsize;
+        l_mount.m_available = static_cast<unsigned long long int>(l_stat.f_bavail) * l_stat.f_frsize;
+        // A mount over another one hides it
+        std::vector<T_MOUNT>::iterator l_hidden = l_mounts.begin();
+        while (l_hidden != l_mounts.end() && l_hidden->m_mountPoint != l_mount.m_mountPoint)
+            ++l_hidden;
+        if (l_hidden != l_mounts.end())
+        {
+            l_devices.erase(l_devices.begin() + (l_hidden - l_mounts.begin()));
+            l_mounts.erase(l_hidden);
+        }
+        // A device mounted several times (bind mounts) is listed once, preferably at its root
+        const bool l_root = l_fields[3] == "/";
+        std::vector<std::pair<std::string, bool> >::iterator l_it = l_devices.begin();
+        while (l_it != l_devices.end() && l_it->first != l_fields[2])
+            ++l_it;
+        if (l_it == l_devices.end())
+        {
+            l_devices.push_back(std::make_pair(l_fields[2], l_root));
+            l_mounts.push_back(l_mount);
+        }
+        else if (l_root && !l_it->second)
+        {
+            l_it->second = true;
+            l_mounts[l_it - l_devices.begin()] = l_mount;
+        }
+    }
+    std::sort(l_mounts.begin(), l_mounts.end(), CompareMountPoints);
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_mounts.swap(l_mounts);
+        ++m_generation;
+    }
+    INHIBIT(std::cout << "CMountList::run: " << m_mounts.size() << " mounts in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    m_running = false;
+}
+
+const int CMountList::find(const std::vector<T_MOUNT> &p_mounts, const std::string &p_path)
+{
+    // The longest mount point containing the path
+    std::string l_path(p_path);
+    {
+        char l_buffer[PATH_MAX];
+        if (realpath(p_path.c_str(), l_buffer) != NULL)
+            l_path = l_buffer;
+    }
+    int l_ret(-1);
+    std::size_t l_length(0);
+    for (std::vector<T_MOUNT>::const_iterator l_it = p_mounts.begin(); l_it != p_mounts.end(); ++l_it)
+    {
+        const std::string &l_mountPoint = l_it->m_mountPoint;
+        if (l_mountPoint.size() < l_length || l_path.compare(0, l_mountPoint.size(), l_mountPoint) != 0)
+            continue;
+        if (l_path.size() > l_mountPoint.size() && l_path[l_mountPoint.size()] != '/' && l_mountPoint != "/")
+            continue;
+        l_ret = l_it - p_mounts.begin();
+        l_length = l_mountPoint.size();
+    }
+    return l_ret;
+}
@@ -0,0 +1,60 @@
+#ifndef _MOUNT_LIST_H_
+#define _MOUNT_LIST_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A mounted file system, and its usage
+struct T_MOUNT
+{
+    std::string m_mountPoint;
+    std::string m_device;
+    std::string m_type;
+    unsigned long long int m_size;
+    unsigned long long int m_used;
+    unsigned long long int m_available;
+};
+
+// Mounted file systems, from /proc/self/mountinfo and statvfs()
+// Read in the background, so the last results are available at once
+class CMountList
+{
+    public:
+
+    // Method to get the instance
+    static CMountList& instance(void);
+
+    // Read the mounts again in the background, unless it's in progress
+    void refresh(void);
+
+    // Get the last results
+    // Returns the number of reads completed so far, 0 = no result yet
+    const unsigned int getMounts(std::vector<T_MOUNT> &p_mounts) const;
+
+    // Index of the mount containing p_path in p_mounts, -1 if none
+    static const int find(const std::vector<T_MOUNT> &p_mounts, const std::string &p_path);
+
+    private:
+
+    // Forbidden
+    CMountList(void);
+    ~CMountList(void);
+    CMountList(const CMountList &p_source);
+    const CMountList &operator =(const CMountList &p_source);
+
+    // Read the mounts, in the background thread
+    void run(void);
+
+    // Last results, protected by m_mutex
+    std::vector<T_MOUNT> m_mounts;
+    unsigned int m_generation;
+    mutable std::mutex m_mutex;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+};
+
+#endif
@@ -1,22 +1,59 @@
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
 #include "panel.h"
 #include "resourceManager.h"
 #include "screen.h"
 #include "sdlutils.h"
 #include "fileutils.h"
+#include "imageLoader.h"
 
 namespace {
 #define PANEL_SIZE (screen.w / 2 - 2)
 #define NAME_SIZE (PANEL_SIZE - 18)
 #define CONTENTS_H (screen.h - HEADER_H - FOOTER_H)
+// Thumbnail view: a cell is the thumbnail and the name under it
+#define CELL_W (THUMBNAIL_SIZE + 8)
+#define CELL_H (THUMBNAIL_SIZE + LINE_HEIGHT + 4)
+#define NB_COLUMNS static_cast<unsigned int>(std::max(1, PANEL_SIZE / CELL_W))
+#define NB_VISIBLE_ROWS static_cast<unsigned int>((CONTENTS_H - 1) / CELL_H + 1)
+#define NB_FULLY_VISIBLE_ROWS static_cast<unsigned int>(std::max(1, CONTENTS_H / CELL_H))
+
+// Row colors, indexed by T_ROW_COLOR and T_ROW_BG
+const SDL_Color *RowColor(const int p_color)
+{
+    static const SDL_Color *l_colors[3] = {&Globals::g_colorTextNormal, &Globals::g_colorTextDir, &Globals::g_colorTextSelected};
+    return l_colors[p_color];
+}
+const SDL_Color RowBackground(const int p_bg)
+{
+    static const SDL_Color l_bgs[4] = {{COLOR_BG_1}, {COLOR_BG_2}, {COLOR_CURSOR_1}, {COLOR_CURSOR_2}};
+    return l_bgs[p_bg];
+}
 } // namespace
 
 CPanel::CPanel(const std::string &p_path, const Sint16 p_x):
     m_currentPath(""),
     m_camera(0),
+    m_viewMode(T_VIEW_LIST),
     m_x(p_x),
     m_highlightedLine(0),
+    m_inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+    m_watch(-1),
+    m_restoreLine(0),
+    m_cursorMoved(false),
+    m_rowBytes(0),
+    m_nbRowHits(0),
+    m_nbRowMisses(0),
+    m_renderedCamera(0),
+    m_renderedLine(0),
+    m_renderedNbTotal(0),
+    m_renderedActive(false),
+    m_damageAll(true),
+    m_damageFooter(false),
     m_iconDir(CResourceManager::instance().getSurface(CResourceManager::T_SURFACE_FOLDER)),
     m_iconFile(CResourceManager::instance().getSurface(CResourceManager::T_SURFACE_FILE)),
     m_iconImg(CResourceManager::instance().getSurface(CResourceManager::T_SURFACE_FILE_IMAGE)),
@@ -27,7 +64,10 @@ CPanel::CPanel(const std::string &p_path, const Sint16 p_x):
     m_cursor2(CResourceManager::instance().getSurface(CResourceManager::T_SURFACE_CURSOR2)),
     m_font(CResourceManager::instance().getFont())
 {
+    if (m_inotifyFd == -1)
+        std::cerr << "CPanel: inotify unavailable, full refresh only" << std::endl;
     // List the given path
+    int l_watch = addWatch(p_path);
     if (m_fileLister.list(p_path))
     {
         // Path OK
@@ -36,115 +76,196 @@ CPanel::CPanel(const std::string &p_path, const Sint16 p_x):
     else
     {
         // The path is wrong => take default
+        removeWatch(l_watch);
+        l_watch = addWatch(PATH_DEFAULT);
         m_fileLister.list(PATH_DEFAULT);
         m_currentPath = PATH_DEFAULT;
     }
+    setWatch(l_watch);
 }
 
 CPanel::~CPanel(void)
 {
+    if (m_inotifyFd != -1)
+        close(m_inotifyFd);
+    clearRows();
+    clearThumbnails();
 }
 
 void CPanel::render(const bool p_active) const
 {
     // Draw panel
-    const Sint16 l_x = m_x + m_iconDir->w / screen.ppu_x + 2;
+    CResourceManager &l_resources = CResourceManager::instance();
+    // Current dir, the end is shown if it's too long
+    const int l_pathWidth = l_resources.getTextWidth(m_currentPath);
+    const int l_pathMax = PANEL_SIZE * screen.ppu_x;
+    l_resources.drawText(m_x, HEADER_PADDING_TOP, Globals::g_screen, m_currentPath, Globals::g_colorTextTitle, {COLOR_TITLE_BG}, l_pathWidth > l_pathMax ? l_pathWidth - l_pathMax : 0, l_pathMax);
+    SDL_Rect clip_contents_rect = SDL_utils::Rect(0, Y_LIST * screen.ppu_y, screen.w * screen.ppu_x, CONTENTS_H * screen.ppu_y);
+    // Content
+    SDL_SetClipRect(Globals::g_screen, &clip_contents_rect);
     const unsigned int l_nbTotal = m_fileLister.getNbTotal();
-    Sint16 l_y = Y_LIST;
-    SDL_Surface *l_surfaceTmp = NULL;
-    const SDL_Color *l_color = NULL;
-    SDL_Rect l_rect;
-    // Current dir
-    l_surfaceTmp = SDL_utils::renderText(m_font, m_currentPath, Globals::g_colorTextTitle, {COLOR_TITLE_BG});
-    if (l_surfaceTmp->w > PANEL_SIZE * screen.ppu_x)
+    if (m_viewMode == T_VIEW_THUMBNAILS)
     {
-        l_rect.x = l_surfaceTmp->w - PANEL_SIZE * screen.ppu_x;
-        l_rect.y = 0;
-        l_rect.w = PANEL_SIZE * screen.ppu_x;
-        l_rect.h = l_surfaceTmp->h;
-        SDL_utils::applySurface(m_x, HEADER_PADDING_TOP, l_surfaceTmp, Globals::g_screen, &l_rect);
+        // No stripes under the grid
+        SDL_Rect l_rect = SDL_utils::Rect((m_x - 1) * screen.ppu_x, Y_LIST * screen.ppu_y, screen.w / 2 * screen.ppu_x, CONTENTS_H * screen.ppu_y);
+        SDL_FillRect(Globals::g_screen, &l_rect, SDL_MapRGB(Globals::g_screen->format, COLOR_BG_1));
+        for (unsigned int l_i = m_camera; l_i < m_camera + NB_VISIBLE_ROWS * NB_COLUMNS && l_i < l_nbTotal; ++l_i)
+            renderCell(l_i, p_active);
     }
     else
     {
-        SDL_utils::applySurface(m_x, HEADER_PADDING_TOP, l_surfaceTmp, Globals::g_screen);
+        for (unsigned int l_i = m_camera; l_i < m_camera + NB_VISIBLE_LINES && l_i < l_nbTotal; ++l_i)
+            renderLine(l_i, p_active);
     }
-    SDL_FreeSurface(l_surfaceTmp);
-    SDL_Rect clip_contents_rect = SDL_utils::Rect(0, Y_LIST * screen.ppu_y, screen.w * screen.ppu_x, CONTENTS_H * screen.ppu_y);
-    // Content
-    SDL_SetClipRect(Globals::g_screen, &clip_contents_rect);
-    // Draw cursor
-    SDL_utils::applySurface(m_x - 1, Y_LIST + (m_highlightedLine - m_camera) * LINE_HEIGHT, p_active ? m_cursor1 : m_cursor2, Globals::g_screen);
-    for (unsigned int l_i = m_camera; l_i < m_camera + NB_VISIBLE_LINES && l_i < l_nbTotal; ++l_i)
+    SDL_SetClipRect(Globals::g_screen, nullptr);
+    // Footer
+    renderFooter();
+    // Remember what is on screen, for renderDamage
+    m_renderedCamera = m_camera;
+    m_renderedLine = m_highlightedLine;
+    m_renderedNbTotal = l_nbTotal;
+    m_renderedActive = p_active;
+    m_damageAll = false;
+    m_damageFooter = false;
+    m_damagedLines.clear();
+}
+
+void CPanel::renderDamage(const bool p_active, SDL_Surface *p_background, std::vector<SDL_Rect> &p_rects) const
+{
+    const SDL_Rect l_screenRect = SDL_utils::Rect(0, 0, screen.w * screen.ppu_x, screen.h * screen.ppu_y);
+    SDL_Rect l_column = SDL_utils::Rect((m_x - 1) * screen.ppu_x, 0, screen.w / 2 * screen.ppu_x, screen.h * screen.ppu_y);
+    SDL_IntersectRect(&l_column, &l_screenRect, &l_column);
+    SDL_Rect l_rect;
+    const bool l_changed = m_highlightedLine != m_renderedLine || p_active != m_renderedActive || !m_damagedLines.empty() || m_damageFooter;
+    // Cells are not redrawn one by one, the grid is small
+    if (m_damageAll || m_camera != m_renderedCamera || m_fileLister.getNbTotal() != m_renderedNbTotal || (m_viewMode == T_VIEW_THUMBNAILS && l_changed))
     {
-        // Icon and color
-        if (m_fileLister.isDirectory(l_i))
-        {
-            // Icon
-            if (m_fileLister[l_i].m_name == "..")
-                l_surfaceTmp = m_iconUp;
-            else
-                l_surfaceTmp = m_iconDir;
-            // Color
-            if (m_selectList.find(l_i) != m_selectList.end())
-                l_color = &Globals::g_colorTextSelected;
-            else
-                l_color = &Globals::g_colorTextDir;
-        }
-        else
-        {
-            // Icon
-            const std::string &ext = m_fileLister[l_i].m_ext;
-            if (SDL_utils::isSupportedImageExt(ext))
-                l_surfaceTmp = m_iconImg;
-            else if (ext == "ipk")
-                l_surfaceTmp = m_iconIpk;
-            else if (ext == "opk")
-                l_surfaceTmp = m_iconOpk;
-            else
-                l_surfaceTmp = m_iconFile;
-            // Color
-            if (m_selectList.find(l_i) != m_selectList.end())
-                l_color = &Globals::g_colorTextSelected;
-            else
-                l_color = &Globals::g_colorTextNormal;
-        }
-        SDL_utils::applySurface(m_x, l_y, l_surfaceTmp, Globals::g_screen);
-        // Text
-        SDL_Color l_bg;
-        if (l_i == m_highlightedLine) {
-            if (p_active)
-                l_bg = {COLOR_CURSOR_1};
-            else
-                l_bg = {COLOR_CURSOR_2};
-        } else {
-            static const SDL_Color kLineBg[2] = {{COLOR_BG_1}, {COLOR_BG_2}};
-            l_bg = kLineBg[(l_i - m_camera) % 2];
-        }
-        l_surfaceTmp = SDL_utils::renderText(m_font, m_fileLister[l_i].m_name, *l_color, l_bg);
-        if (l_surfaceTmp->w > NAME_SIZE * screen.ppu_x)
-        {
-            l_rect.x = 0;
-            l_rect.y = 0;
-            l_rect.w = NAME_SIZE * screen.ppu_x;
-            l_rect.h = l_surfaceTmp->h;
-            SDL_utils::applySurface(l_x, l_y + 2, l_surfaceTmp, Globals::g_screen, &l_rect);
-        }
-        else
-        {
-            SDL_utils::applySurface(l_x, l_y + 2, l_surfaceTmp, Globals::g_screen);
-        }
-        SDL_FreeSurface(l_surfaceTmp);
-        // Next line
-        l_y += LINE_HEIGHT;
+        // Whole panel
+        l_rect = l_column;
+        SDL_BlitSurface(p_background, &l_column, Globals::g_screen, &l_rect);
+        render(p_active);
+        p_rects.push_back(l_column);
+        return;
+    }
+    if (!l_changed)
+        return;
+    // Lines of the old and new cursor, and the changed ones
+    m_damagedLines.insert(m_renderedLine);
+    m_damagedLines.insert(m_highlightedLine);
+    SDL_Rect l_contents = SDL_utils::Rect(l_column.x, Y_LIST * screen.ppu_y, l_column.w, CONTENTS_H * screen.ppu_y);
+    SDL_SetClipRect(Globals::g_screen, &l_contents);
+    for (std::set<unsigned int>::const_iterator l_it = m_damagedLines.begin(); l_it != m_damagedLines.end(); ++l_it)
+    {
+        if (*l_it < m_camera || *l_it >= m_camera + NB_VISIBLE_LINES || *l_it >= m_fileLister.getNbTotal())
+            continue;
+        SDL_Rect l_line = SDL_utils::Rect(l_column.x, (Y_LIST + (*l_it - m_camera) * LINE_HEIGHT) * screen.ppu_y, l_column.w, LINE_HEIGHT * screen.ppu_y);
+        SDL_IntersectRect(&l_line, &l_contents, &l_line);
+        l_rect = l_line;
+        SDL_BlitSurface(p_background, &l_line, Globals::g_screen, &l_rect);
+        renderLine(*l_it, p_active);
+        p_rects.push_back(l_line);
     }
     SDL_SetClipRect(Globals::g_screen, nullptr);
-
     // Footer
+    SDL_Rect l_footer = SDL_utils::Rect(l_column.x, FOOTER_Y * screen.ppu_y, l_column.w, FOOTER_H * screen.ppu_y);
+    l_rect = l_footer;
+    SDL_BlitSurface(p_background, &l_footer, Globals::g_screen, &l_rect);
+    renderFooter();
+    p_rects.push_back(l_footer);
+    m_renderedLine = m_highlightedLine;
+    m_renderedActive = p_active;
+    m_damageFooter = false;
+    m_damagedLines.clear();
+}
+
+void CPanel::renderLine(const unsigned int p_i, const bool p_active) const
+{
+    const Sint16 l_y = Y_LIST + (p_i - m_camera) * LINE_HEIGHT;
+    // Cursor
+    if (p_i == m_highlightedLine)
+        SDL_utils::applySurface(m_x - 1, l_y, p_active ? m_cursor1 : m_cursor2, Globals::g_screen);
+    // Icon
+    SDL_utils::applySurface(m_x, l_y, getIcon(p_i), Globals::g_screen);
+    // Text
+    T_ROW_BG l_bg;
+    if (p_i == m_highlightedLine)
+        l_bg = p_active ? T_ROW_CURSOR_1 : T_ROW_CURSOR_2;
+    else
+        l_bg = (p_i - m_camera) % 2 ? T_ROW_BG_2 : T_ROW_BG_1;
+    SDL_Surface *l_surfaceTmp = getRow(p_i, getRowColor(p_i), l_bg);
+    if (l_surfaceTmp != NULL)
+        SDL_utils::applySurface(m_x + m_iconDir->w / screen.ppu_x + 2, l_y + 2, l_surfaceTmp, Globals::g_screen);
+}
+
+void CPanel::renderCell(const unsigned int p_i, const bool p_active) const
+{
+    const Sint16 l_x = m_x + (p_i - m_camera) % NB_COLUMNS * CELL_W;
+    const Sint16 l_y = Y_LIST + (p_i - m_camera) / NB_COLUMNS * CELL_H;
+    // Cursor
+    SDL_Color l_bg = RowBackground(T_ROW_BG_1);
+    if (p_i == m_highlightedLine)
+    {
+        l_bg = RowBackground(p_active ? T_ROW_CURSOR_1 : T_ROW_CURSOR_2);
+        SDL_Rect l_rect = SDL_utils::Rect(l_x * screen.ppu_x, l_y * screen.ppu_y, CELL_W * screen.ppu_x, CELL_H * screen.ppu_y);
+        SDL_FillRect(Globals::g_screen, &l_rect, SDL_MapRGB(Globals::g_screen->format, l_bg.r, l_bg.g, l_bg.b));
+    }
+    // Thumbnail, or icon until it's decoded
+    const T_FILE l_file = m_fileLister[p_i];
+    SDL_Surface *l_surfaceTmp = getIcon(p_i);
+    if (!m_fileLister.isDirectory(p_i) && l_file.m_extClass == T_EXT_IMAGE)
+    {
+        const std::map<std::string, T_THUMBNAIL>::const_iterator l_it = m_thumbnails.find(std::string(l_file.m_name, l_file.m_length));
+        if (l_it != m_thumbnails.end() && l_it->second.m_surface != NULL)
+            l_surfaceTmp = l_it->second.m_surface;
+    }
+    SDL_utils::applySurface(l_x + (CELL_W - l_surfaceTmp->w / screen.ppu_x) / 2, l_y + 2 + (THUMBNAIL_SIZE - l_surfaceTmp->h / screen.ppu_y) / 2, l_surfaceTmp, Globals::g_screen);
+    // Name, cut to the cell
+    CResourceManager::instance().drawText(l_x + 2, l_y + THUMBNAIL_SIZE + 4, Globals::g_screen, l_file.m_name, l_file.m_length, *RowColor(getRowColor(p_i)), l_bg, 0, (CELL_W - 4) * screen.ppu_x);
+}
+
+SDL_Surface *CPanel::getIcon(const unsigned int p_i) const
+{
+    if (m_fileLister.isDirectory(p_i))
+        return strcmp(m_fileLister[p_i].m_name, "..") == 0 ? m_iconUp : m_iconDir;
+    switch (m_fileLister[p_i].m_extClass)
+    {
+        case T_EXT_IMAGE:
+            return m_iconImg;
+        case T_EXT_IPK:
+            return m_iconIpk;
+        case T_EXT_OPK:
+            return m_iconOpk;
+        default:
+            return m_iconFile;
+    }
+}
+
+const CPanel::T_ROW_COLOR CPanel::getRowColor(const unsigned int p_i) const
+{
+    if (m_selectList.find(p_i) != m_selectList.end())
+        return T_ROW_SELECTED;
+    return m_fileLister.isDirectory(p_i) ? T_ROW_DIR : T_ROW_NORMAL;
+}
+
+void CPanel::renderFooter(void) const
+{
+    if (!m_status.empty())
+    {
+        SDL_utils::applyText(m_x + 2, FOOTER_Y + FOOTER_PADDING_TOP, Globals::g_screen, m_font, m_status, Globals::g_colorTextTitle, {COLOR_TITLE_BG});
+        return;
+    }
+    if (m_fileLister.isLoading())
+    {
+        std::ostringstream l_s;
+        l_s << "Loading " << m_fileLister.getNbTotal() - 1 << " entries...";
+        SDL_utils::applyText(m_x + 2, FOOTER_Y + FOOTER_PADDING_TOP, Globals::g_screen, m_font, l_s.str(), Globals::g_colorTextTitle, {COLOR_TITLE_BG});
+        return;
+    }
     std::string l_footer("-");
     if (!m_fileLister.isDirectory(m_highlightedLine))
     {
         std::ostringstream l_s;
-        l_s << m_fileLister[m_highlightedLine].m_size;
+        l_s << m_fileLister.getSize(m_highlightedLine);
         l_footer = l_s.str();
         File_utils::formatSize(l_footer);
     }
@@ -152,9 +273,92 @@ void CPanel::render(const bool p_active) const
     SDL_utils::applyText(m_x + PANEL_SIZE - 2, FOOTER_Y + FOOTER_PADDING_TOP, Globals::g_screen, m_font, l_footer, Globals::g_colorTextTitle, {COLOR_TITLE_BG}, SDL_utils::T_TEXT_ALIGN_RIGHT);
 }
 
+SDL_Surface *CPanel::getRow(const unsigned int p_i, const T_ROW_COLOR p_color, const T_ROW_BG p_bg) const
+{
+    const Uint64 l_key = (static_cast<Uint64>(p_i) << 4) | (p_color << 2) | p_bg;
+    std::unordered_map<Uint64, std::list<T_ROW>::iterator>::const_iterator l_it = m_rowIndex.find(l_key);
+    if (l_it != m_rowIndex.end())
+    {
+        // Move to the front
+        m_rows.splice(m_rows.begin(), m_rows, l_it->second);
+        ++m_nbRowHits;
+        return l_it->second->m_surface;
+    }
+    ++m_nbRowMisses;
+    // Stripes alternate when scrolling => render both at once
+    if (p_bg == T_ROW_BG_1 || p_bg == T_ROW_BG_2)
+    {
+        const T_ROW_BG l_other = p_bg == T_ROW_BG_1 ? T_ROW_BG_2 : T_ROW_BG_1;
+        if (m_rowIndex.find((static_cast<Uint64>(p_i) << 4) | (p_color << 2) | l_other) == m_rowIndex.end())
+            renderRow(p_i, p_color, l_other);
+    }
+    return renderRow(p_i, p_color, p_bg);
+}
+
+SDL_Surface *CPanel::renderRow(const unsigned int p_i, const T_ROW_COLOR p_color, const T_ROW_BG p_bg) const
+{
+    const SDL_Color l_bg = RowBackground(p_bg);
+    SDL_Surface *l_surface = SDL_utils::createImage(NAME_SIZE * screen.ppu_x, TTF_FontHeight(m_font), SDL_MapRGB(Globals::g_screen->format, l_bg.r, l_bg.g, l_bg.b));
+    if (l_surface == NULL)
+        return NULL;
+    const T_FILE l_file = m_fileLister[p_i];
+    CResourceManager::instance().drawText(0, 0, l_surface, l_file.m_name, l_file.m_length, *RowColor(p_color), l_bg, 0, l_surface->w);
+    // Evict the least recently used rows
+    const std::size_t l_bytes = l_surface->pitch * l_surface->h;
+    while (!m_rows.empty() && m_rowBytes + l_bytes > PANEL_ROW_CACHE_SIZE_MAX)
+    {
+        m_rowBytes -= m_rows.back().m_surface->pitch * m_rows.back().m_surface->h;
+        SDL_FreeSurface(m_rows.back().m_surface);
+        m_rowIndex.erase(m_rows.back().m_key);
+        m_rows.pop_back();
+    }
+    T_ROW l_row;
+    l_row.m_key = (static_cast<Uint64>(p_i) << 4) | (p_color << 2) | p_bg;
+    l_row.m_surface = l_surface;
+    m_rows.push_front(l_row);
+    m_rowIndex[l_row.m_key] = m_rows.begin();
+    m_rowBytes += l_bytes;
+    return l_surface;
+}
+
+void CPanel::clearRows(void)
+{
+    INHIBIT(std::cout << "CPanel::clearRows: " << m_rows.size() << " rows, " << m_rowBytes << " bytes (" << m_nbRowHits << " hits, " << m_nbRowMisses << " misses)" << std::endl;)
+    for (std::list<T_ROW>::iterator l_it = m_rows.begin(); l_it != m_rows.end(); ++l_it)
+        SDL_FreeSurface(l_it->m_surface);
+    m_rows.clear();
+    m_rowIndex.clear();
+    m_rowBytes = 0;
+    m_damageAll = true;
+}
+
+const unsigned int CPanel::getNbRowHits(void) const
+{
+    return m_nbRowHits;
+}
+
+const unsigned int CPanel::getNbRowMisses(void) const
+{
+    return m_nbRowMisses;
+}
+
 const bool CPanel::moveCursorUp(unsigned char p_step)
 {
     bool l_ret(false);
+    if (m_viewMode == T_VIEW_THUMBNAILS)
+    {
+        // By rows, a page is what is fully visible
+        if (m_highlightedLine < NB_COLUMNS)
+            return false;
+        const unsigned int l_step = std::min(static_cast<unsigned int>(p_step), NB_FULLY_VISIBLE_ROWS) * NB_COLUMNS;
+        if (m_highlightedLine >= l_step)
+            m_highlightedLine -= l_step;
+        else
+            m_highlightedLine %= NB_COLUMNS;
+        m_cursorMoved = true;
+        adjustCamera();
+        return true;
+    }
     if (m_highlightedLine)
     {
         // Move cursor
@@ -162,6 +366,7 @@ const bool CPanel::moveCursorUp(unsigned char p_step)
             m_highlightedLine -= p_step;
         else
             m_highlightedLine = 0;
+        m_cursorMoved = true;
         // Adjust camera
         adjustCamera();
         // Return true for new render
@@ -174,6 +379,16 @@ const bool CPanel::moveCursorDown(unsigned char p_step)
 {
     bool l_ret(false);
     const unsigned int l_nb = m_fileLister.getNbTotal();
+    if (m_viewMode == T_VIEW_THUMBNAILS)
+    {
+        // By rows, to the last entry from the row above it
+        if (m_highlightedLine / NB_COLUMNS == (l_nb - 1) / NB_COLUMNS)
+            return false;
+        m_highlightedLine = std::min(m_highlightedLine + std::min(static_cast<unsigned int>(p_step), NB_FULLY_VISIBLE_ROWS) * NB_COLUMNS, l_nb - 1);
+        m_cursorMoved = true;
+        adjustCamera();
+        return true;
+    }
     if (m_highlightedLine < l_nb - 1)
     {
         // Move cursor
@@ -181,6 +396,7 @@ const bool CPanel::moveCursorDown(unsigned char p_step)
             m_highlightedLine = l_nb - 1;
         else
             m_highlightedLine += p_step;
+        m_cursorMoved = true;
         // Adjust camera
         adjustCamera();
         // Return true for new render
@@ -189,6 +405,26 @@ const bool CPanel::moveCursorDown(unsigned char p_step)
     return l_ret;
 }
 
+const bool CPanel::moveCursorLeft(void)
+{
+    if (m_viewMode != T_VIEW_THUMBNAILS || m_highlightedLine % NB_COLUMNS == 0)
+        return false;
+    --m_highlightedLine;
+    m_cursorMoved = true;
+    adjustCamera();
+    return true;
+}
+
+const bool CPanel::moveCursorRight(void)
+{
+    if (m_viewMode != T_VIEW_THUMBNAILS || m_highlightedLine % NB_COLUMNS == NB_COLUMNS - 1 || m_highlightedLine + 1 >= m_fileLister.getNbTotal())
+        return false;
+    ++m_highlightedLine;
+    m_cursorMoved = true;
+    adjustCamera();
+    return true;
+}
+
 const bool CPanel::open(const std::string &p_path)
 {
     bool l_ret(false);
@@ -197,7 +433,7 @@ const bool CPanel::open(const std::string &p_path)
     if (p_path.empty())
     {
         // Open highlighted dir
-        if (m_fileLister[m_highlightedLine].m_name == "..")
+        if (strcmp(m_fileLister[m_highlightedLine].m_name, "..") == 0)
         {
             // Go to parent dir
             size_t l_pos = m_currentPath.rfind('/');
@@ -221,22 +457,25 @@ const bool CPanel::open(const std::string &p_path)
         l_newPath = p_path;
     }
     // List the new path
+    const int l_watch = addWatch(l_newPath);
     if (m_fileLister.list(l_newPath))
     {
         // Path OK
         m_currentPath = l_newPath;
+        setWatch(l_watch);
+        clearRows();
+        clearThumbnails();
         // If it's a back movement, restore old dir
-        if (!l_oldDir.empty())
-            m_highlightedLine = m_fileLister.searchDir(l_oldDir);
-        else
-            m_highlightedLine = 0;
-        // Camera
-        adjustCamera();
+        restoreHighlight(l_oldDir, 0);
         // Clear select list
         m_selectList.clear();
         // New render
         l_ret = true;
     }
+    else if (l_watch != m_watch)
+    {
+        removeWatch(l_watch);
+    }
     INHIBIT(std::cout << "open - new current path: " << m_currentPath << std::endl;)
     return l_ret;
 }
@@ -255,6 +494,20 @@ const bool CPanel::goToParentDir(void)
 
 void CPanel::adjustCamera(void)
 {
+    if (m_viewMode == T_VIEW_THUMBNAILS)
+    {
+        // First cell of a row
+        unsigned int l_row = m_camera / NB_COLUMNS;
+        const unsigned int l_highlightedRow = m_highlightedLine / NB_COLUMNS;
+        if ((m_fileLister.getNbTotal() - 1) / NB_COLUMNS < NB_FULLY_VISIBLE_ROWS)
+            l_row = 0;
+        else if (l_highlightedRow < l_row)
+            l_row = l_highlightedRow;
+        else if (l_highlightedRow > l_row + NB_FULLY_VISIBLE_ROWS - 1)
+            l_row = l_highlightedRow - NB_FULLY_VISIBLE_ROWS + 1;
+        m_camera = l_row * NB_COLUMNS;
+        return;
+    }
     if (m_fileLister.getNbTotal() <= NB_VISIBLE_LINES)
         m_camera = 0;
     else if (m_highlightedLine < m_camera)
@@ -263,7 +516,7 @@ void CPanel::adjustCamera(void)
         m_camera = m_highlightedLine - NB_FULLY_VISIBLE_LINES + 1;
 }
 
-const std::string &CPanel::getHighlightedItem(void) const
+const std::string CPanel::getHighlightedItem(void) const
 {
     return m_fileLister[m_highlightedLine].m_name;
 }
@@ -278,6 +531,18 @@ const std::string &CPanel::getCurrentPath(void) const
     return m_currentPath;
 }
 
+void CPanel::getImageList(std::vector<std::string> &p_list) const
+{
+    p_list.clear();
+    const std::string l_prefix = m_currentPath + (m_currentPath == "/" ? "" : "/");
+    for (unsigned int l_i = m_fileLister.getNbDirs(); l_i < m_fileLister.getNbTotal(); ++l_i)
+    {
+        const T_FILE l_file = m_fileLister[l_i];
+        if (l_file.m_extClass == T_EXT_IMAGE)
+            p_list.push_back(l_prefix + std::string(l_file.m_name, l_file.m_length));
+    }
+}
+
 const unsigned int &CPanel::getHighlightedIndex(void) const
 {
     return m_highlightedLine;
@@ -285,35 +550,365 @@ const unsigned int &CPanel::getHighlightedIndex(void) const
 
 const unsigned int CPanel::getHighlightedIndexRelative(void) const
 {
+    // Line of the top of the cell
+    if (m_viewMode == T_VIEW_THUMBNAILS)
+        return (m_highlightedLine - m_camera) / NB_COLUMNS * CELL_H / LINE_HEIGHT;
     return m_highlightedLine - m_camera;
 }
 
 void CPanel::refresh(void)
 {
+    if (m_watch == -1 || m_fileLister.isLoading())
+    {
+        relist();
+        return;
+    }
+    // Clear select list
+    m_selectList.clear();
+    m_damageAll = true;
+    // Changes are known from inotify
+    applyWatchEvents();
+}
+
+const bool CPanel::isWatched(void) const
+{
+    return m_watch != -1;
+}
+
+const bool CPanel::setStatus(const std::string &p_status)
+{
+    if (m_status == p_status)
+        return false;
+    m_status = p_status;
+    m_damageFooter = true;
+    return true;
+}
+
+void CPanel::setSortMode(const T_SORT_MODE p_mode)
+{
+    if (m_fileLister.getSortMode() == p_mode)
+        return;
+    m_fileLister.setSortMode(p_mode);
+    relist();
+}
+
+void CPanel::setViewMode(const T_VIEW_MODE p_mode)
+{
+    if (m_viewMode == p_mode)
+        return;
+    m_viewMode = p_mode;
+    clearThumbnails();
+    adjustCamera();
+    m_damageAll = true;
+}
+
+void CPanel::relist(void)
+{
+    const std::string l_highlighted(getHighlightedItem());
+    const unsigned int l_line(m_highlightedLine);
+    // Clear select list
+    m_selectList.clear();
+    clearRows();
+    clearThumbnails();
     // List current path
+    int l_watch = addWatch(m_currentPath);
     if (m_fileLister.list(m_currentPath))
     {
-        // Adjust selected line
-        if (m_highlightedLine > m_fileLister.getNbTotal() - 1)
-            m_highlightedLine = m_fileLister.getNbTotal() - 1;
+        // Keep the highlighted item, or the same line if it's gone
+        restoreHighlight(l_highlighted, l_line);
     }
     else
     {
         // Current path doesn't exist anymore => default
+        if (l_watch != m_watch)
+            removeWatch(l_watch);
+        l_watch = addWatch(PATH_DEFAULT);
         m_fileLister.list(PATH_DEFAULT);
         m_currentPath = PATH_DEFAULT;
+        restoreHighlight("", 0);
+    }
+    setWatch(l_watch);
+}
+
+const int CPanel::addWatch(const std::string &p_path) const
+{
+    if (m_inotifyFd == -1)
+        return -1;
+    // The same dir keeps its descriptor
+    const int l_watch = inotify_add_watch(m_inotifyFd, p_path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    if (l_watch == -1)
+        std::cerr << "CPanel: unable to watch " << p_path << std::endl;
+    return l_watch;
+}
+
+void CPanel::setWatch(const int p_watch)
+{
+    // Events of the previous descriptor are ignored from now on
+    if (m_watch != p_watch)
+        removeWatch(m_watch);
+    m_watch = p_watch;
+}
+
+void CPanel::removeWatch(const int p_watch) const
+{
+    if (p_watch != -1)
+        inotify_rm_watch(m_inotifyFd, p_watch);
+}
+
+const bool CPanel::applyWatchEvents(void)
+{
+    if (m_watch == -1)
+        return false;
+    char l_buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t l_len = read(m_inotifyFd, l_buffer, sizeof(l_buffer));
+    if (l_len <= 0)
+        // No pending event
+        return false;
+    bool l_changed(false);
+    bool l_relist(false);
+    // Entries written to, their row stays the same
+    std::set<std::string> l_modified;
+    // Names to find back after the changes
+    const std::string l_highlighted(getHighlightedItem());
+    std::vector<std::string> l_selected;
+    for (std::set<unsigned int>::const_iterator l_it = m_selectList.begin(); l_it != m_selectList.end(); ++l_it)
+        l_selected.push_back(m_fileLister[*l_it].m_name);
+    // Apply all pending events
+    while (l_len > 0)
+    {
+        for (char *l_ptr = l_buffer; l_ptr < l_buffer + l_len; l_ptr += sizeof(struct inotify_event) + reinterpret_cast<struct inotify_event *>(l_ptr)->len)
+        {
+            const struct inotify_event *l_event = reinterpret_cast<struct inotify_event *>(l_ptr);
+            if (l_event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost
+                l_relist = true;
+            }
+            else if (l_event->wd != m_watch)
+            {
+                // Event from a previous path
+            }
+            else if (l_event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            {
+                // The current path is gone
+                l_relist = true;
+            }
+            else if (l_event->len)
+            {
+                INHIBIT(std::cout << "CPanel: inotify event " << std::hex << l_event->mask << std::dec << " " << l_event->name << std::endl;)
+                if (l_event->mask & (IN_DELETE | IN_MOVED_FROM))
+                    l_changed = m_fileLister.removeEntry(l_event->name) || l_changed;
+                else
+                {
+                    const T_ENTRY_CHANGE l_change = m_fileLister.addEntry(l_event->name);
+                    if (l_change == T_ENTRY_LISTED)
+                        l_changed = true;
+                    else if (l_change == T_ENTRY_MODIFIED)
+                        l_modified.insert(l_event->name);
+                }
+            }
+        }
+        l_len = read(m_inotifyFd, l_buffer, sizeof(l_buffer));
+    }
+    if (l_relist)
+    {
+        relist();
+        return true;
+    }
+    if (l_changed)
+    {
+        // Find the highlighted and selected items back
+        // Thumbnails are got again, changed images are seen by their mtime
+        clearRows();
+        clearThumbnails();
+        m_selectList.clear();
+        for (std::vector<std::string>::const_iterator l_it = l_selected.begin(); l_it != l_selected.end(); ++l_it)
+            m_selectList.insert(m_fileLister.search(*l_it));
+        m_selectList.erase(0);
+        locateHighlight(l_highlighted, m_highlightedLine);
+        return true;
+    }
+    // Same entries => only the modified lines, the size in the footer
+    // and the thumbnails of the modified images
+    for (std::set<std::string>::const_iterator l_it = l_modified.begin(); l_it != l_modified.end(); ++l_it)
+    {
+        m_damagedLines.insert(m_fileLister.search(*l_it));
+        reloadThumbnail(*l_it);
+    }
+    if (!l_modified.empty())
+        m_damageFooter = true;
+    return !l_modified.empty();
+}
+
+const bool CPanel::update(void)
+{
+    const bool l_thumbnails = updateThumbnails();
+    // Events are applied once the listing completes
+    if (!m_fileLister.isLoading())
+        return applyWatchEvents() || l_thumbnails;
+    const unsigned int l_nbDirs = m_fileLister.getNbDirs();
+    // Names to find back if the lists get sorted
+    const std::string l_highlighted(getHighlightedItem());
+    std::vector<std::string> l_selected;
+    for (std::set<unsigned int>::const_iterator l_it = m_selectList.begin(); l_it != m_selectList.end(); ++l_it)
+        l_selected.push_back(m_fileLister[*l_it].m_name);
+    if (!m_fileLister.update())
+        return l_thumbnails;
+    clearRows();
+    if (m_fileLister.isLoading())
+    {
+        // A batch was appended => files are shifted by the new dirs
+        const unsigned int l_shift = m_fileLister.getNbDirs() - l_nbDirs;
+        if (l_shift)
+        {
+            if (m_highlightedLine >= l_nbDirs)
+                m_highlightedLine += l_shift;
+            std::set<unsigned int> l_selectList;
+            for (std::set<unsigned int>::const_iterator l_it = m_selectList.begin(); l_it != m_selectList.end(); ++l_it)
+                l_selectList.insert(*l_it >= l_nbDirs ? *l_it + l_shift : *l_it);
+            m_selectList.swap(l_selectList);
+        }
+        adjustCamera();
+    }
+    else
+    {
+        // The lists are sorted now => find items back by name
+        m_selectList.clear();
+        for (std::vector<std::string>::const_iterator l_it = l_selected.begin(); l_it != l_selected.end(); ++l_it)
+            m_selectList.insert(m_fileLister.search(*l_it));
+        m_selectList.erase(0);
+        if (!m_cursorMoved)
+            locateHighlight(m_restoreName, m_restoreLine);
+        else
+            locateHighlight(l_highlighted, m_highlightedLine);
+        m_restoreName.clear();
+    }
+    return true;
+}
+
+const bool CPanel::updateThumbnails(void)
+{
+    if (m_viewMode != T_VIEW_THUMBNAILS)
+        return false;
+    // Images of the visible cells, and of a page around them
+    const unsigned int l_nbTotal = m_fileLister.getNbTotal();
+    const unsigned int l_page = NB_VISIBLE_ROWS * NB_COLUMNS;
+    const unsigned int l_visibleEnd = std::min(m_camera + l_page, l_nbTotal);
+    std::set<std::string> l_kept;
+    std::set<std::string> l_visible;
+    for (unsigned int l_i = m_camera > l_page ? m_camera - l_page : 0; l_i < l_nbTotal && l_i < l_visibleEnd + l_page; ++l_i)
+    {
+        if (m_fileLister.isDirectory(l_i) || m_fileLister[l_i].m_extClass != T_EXT_IMAGE)
+            continue;
+        const T_FILE l_file = m_fileLister[l_i];
+        const std::string l_name(l_file.m_name, l_file.m_length);
+        l_kept.insert(l_name);
+        if (l_i < m_camera || l_i >= l_visibleEnd)
+            continue;
+        l_visible.insert(l_name);
+        // Only the visible cells are requested
+        if (m_thumbnails.find(l_name) == m_thumbnails.end())
+        {
+            T_THUMBNAIL &l_thumbnail = m_thumbnails[l_name];
+            l_thumbnail.m_id = CImageLoader::instance().load(m_currentPath + (m_currentPath == "/" ? "" : "/") + l_name, THUMBNAIL_SIZE, THUMBNAIL_SIZE, CImageCache::thumbnails());
+            l_thumbnail.m_loading = true;
+            l_thumbnail.m_surface = NULL;
+        }
+    }
+    bool l_ret(false);
+    std::map<std::string, T_THUMBNAIL>::iterator l_it = m_thumbnails.begin();
+    while (l_it != m_thumbnails.end())
+    {
+        // Scrolled away: the decoded ones are kept for a page, the others are cancelled,
+        // so that scrolling fast doesn't queue every image of the dir
+        if (l_it->second.m_loading ? l_visible.find(l_it->first) == l_visible.end() : l_kept.find(l_it->first) == l_kept.end())
+        {
+            if (l_it->second.m_loading)
+                CImageLoader::instance().cancel(l_it->second.m_id);
+            if (l_it->second.m_surface != NULL)
+                SDL_FreeSurface(l_it->second.m_surface);
+            l_it = m_thumbnails.erase(l_it);
+            continue;
+        }
+        SDL_Surface *l_surface = NULL;
+        if (l_it->second.m_loading && CImageLoader::instance().take(l_it->second.m_id, l_surface))
+        {
+            // A reloaded thumbnail replaces the previous one
+            l_it->second.m_loading = false;
+            if (l_it->second.m_surface != NULL || l_surface != NULL)
+            {
+                m_damageAll = true;
+                l_ret = true;
+            }
+            if (l_it->second.m_surface != NULL)
+                SDL_FreeSurface(l_it->second.m_surface);
+            l_it->second.m_surface = l_surface;
+        }
+        ++l_it;
+    }
+    return l_ret;
+}
+
+void CPanel::clearThumbnails(void)
+{
+    for (std::map<std::string, T_THUMBNAIL>::iterator l_it = m_thumbnails.begin(); l_it != m_thumbnails.end(); ++l_it)
+    {
+        if (l_it->second.m_loading)
+            CImageLoader::instance().cancel(l_it->second.m_id);
+        if (l_it->second.m_surface != NULL)
+            SDL_FreeSurface(l_it->second.m_surface);
+    }
+    m_thumbnails.clear();
+    m_damageAll = true;
+}
+
+void CPanel::reloadThumbnail(const std::string &p_name)
+{
+    std::map<std::string, T_THUMBNAIL>::iterator l_it = m_thumbnails.find(p_name);
+    if (l_it == m_thumbnails.end())
+        return;
+    if (l_it->second.m_loading)
+        CImageLoader::instance().cancel(l_it->second.m_id);
+    // The image cache sees the change by the mtime
+    l_it->second.m_id = CImageLoader::instance().load(m_currentPath + (m_currentPath == "/" ? "" : "/") + p_name, THUMBNAIL_SIZE, THUMBNAIL_SIZE, CImageCache::thumbnails());
+    l_it->second.m_loading = true;
+}
+
+void CPanel::restoreHighlight(const std::string &p_name, const unsigned int p_line)
+{
+    m_cursorMoved = false;
+    if (m_fileLister.isLoading())
+    {
+        // Wait for the end of the listing
+        m_restoreName = p_name;
+        m_restoreLine = p_line;
         m_highlightedLine = 0;
+        adjustCamera();
+    }
+    else
+    {
+        locateHighlight(p_name, p_line);
+    }
+}
+
+void CPanel::locateHighlight(const std::string &p_name, const unsigned int p_line)
+{
+    m_highlightedLine = p_name.empty() ? 0 : m_fileLister.search(p_name);
+    if (!m_highlightedLine && !p_name.empty() && p_name != "..")
+    {
+        // Item not found => keep the line
+        m_highlightedLine = p_line;
+        if (m_highlightedLine > m_fileLister.getNbTotal() - 1)
+            m_highlightedLine = m_fileLister.getNbTotal() - 1;
     }
-    // Camera
     adjustCamera();
-    // Clear select list
-    m_selectList.clear();
 }
 
 const bool CPanel::addToSelectList(const bool p_step)
 {
-    if (m_fileLister[m_highlightedLine].m_name != "..")
+    if (strcmp(m_fileLister[m_highlightedLine].m_name, "..") != 0)
     {
+        m_damagedLines.insert(m_highlightedLine);
         // Search highlighted element in select list
         std::set<unsigned int>::iterator l_it = m_selectList.find(m_highlightedLine);
         if (l_it == m_selectList.end())
@@ -322,8 +917,20 @@ const bool CPanel::addToSelectList(const bool p_step)
         else
             // Element present => we remove it from the list
             m_selectList.erase(m_highlightedLine);
-        if (p_step)
+        if (p_step && m_viewMode == T_VIEW_THUMBNAILS)
+        {
+            // Next cell, through the rows
+            if (m_highlightedLine + 1 < m_fileLister.getNbTotal())
+            {
+                ++m_highlightedLine;
+                m_cursorMoved = true;
+                adjustCamera();
+            }
+        }
+        else if (p_step)
+        {
             moveCursorDown(1);
+        }
         return true;
     }
     else
@@ -355,11 +962,13 @@ void CPanel::selectAll(void)
     const unsigned int l_nb = m_fileLister.getNbTotal();
     for (unsigned int l_i = 1; l_i < l_nb; ++l_i)
         m_selectList.insert(l_i);
+    clearRows();
 }
 
 void CPanel::selectNone(void)
 {
     m_selectList.clear();
+    clearRows();
 }
 
 const bool CPanel::isDirectoryHighlighted(void) const
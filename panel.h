@@ -3,11 +3,23 @@
 
 #include <string>
 #include <set>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include "fileLister.h"
 #include "def.h"
 
+// View of the entries: list of names, or grid of thumbnails
+typedef enum
+{
+    T_VIEW_LIST = 0,
+    T_VIEW_THUMBNAILS
+}
+T_VIEW_MODE;
+
 class CPanel
 {
     public:
@@ -21,21 +33,42 @@ class CPanel
     // Draw the panel on the screen
     void render(const bool p_active) const;
 
+    // Draw only what changed since the last render, over the previous frame
+    // p_background is the commander background, used to erase lines
+    // Changed rects are added to p_rects
+    void renderDamage(const bool p_active, SDL_Surface *p_background, std::vector<SDL_Rect> &p_rects) const;
+
     // Move cursor
+    // In the thumbnail view, up and down move by rows, left and right inside a row
     const bool moveCursorUp(unsigned char p_step);
     const bool moveCursorDown(unsigned char p_step);
+    const bool moveCursorLeft(void);
+    const bool moveCursorRight(void);
 
     // Open selected item
     const bool open(const std::string &p_path = "");
 
     // Refresh current directory
+    // Only the changes reported by inotify are applied, if available
     void refresh(void);
 
+    // True if the changes of the current directory are reported by inotify
+    const bool isWatched(void) const;
+
+    // Text shown in the footer instead of the size, empty = none
+    // Returns true if it changed
+    const bool setStatus(const std::string &p_status);
+
+    // Merge entries listed in the background, apply inotify events,
+    // and get the thumbnails decoded in the background
+    // Returns true if a new render is needed
+    const bool update(void);
+
     // Go to parent dir
     const bool goToParentDir(void);
 
     // Selected file with just the name
-    const std::string &getHighlightedItem(void) const;
+    const std::string getHighlightedItem(void) const;
 
     // Selected file with full path
     const std::string getHighlightedItemFull(void) const;
@@ -43,6 +76,9 @@ class CPanel
     // Current path
     const std::string &getCurrentPath(void) const;
 
+    // Image files of the current path, with full path, in the listed order
+    void getImageList(std::vector<std::string> &p_list) const;
+
     // Selected index
     const unsigned int &getHighlightedIndex(void) const;
     const unsigned int getHighlightedIndexRelative(void) const;
@@ -61,6 +97,16 @@ class CPanel
     void selectAll(void);
     void selectNone(void);
 
+    // Change the sort order and list current directory again
+    void setSortMode(const T_SORT_MODE p_mode);
+
+    // Change the view
+    void setViewMode(const T_VIEW_MODE p_mode);
+
+    // Row cache statistics
+    const unsigned int getNbRowHits(void) const;
+    const unsigned int getNbRowMisses(void) const;
+
     private:
 
     // Forbidden
@@ -71,24 +117,142 @@ class CPanel
     // Adjust camera
     void adjustCamera(void);
 
+    // Draw a visible line, the content clip rect must be set
+    void renderLine(const unsigned int p_i, const bool p_active) const;
+
+    // Draw a visible cell of the thumbnail view, the content clip rect must be set
+    void renderCell(const unsigned int p_i, const bool p_active) const;
+
+    // Draw the footer
+    void renderFooter(void) const;
+
+    // List current directory again
+    void relist(void);
+
+    // Text color and background of a row
+    typedef enum
+    {
+        T_ROW_NORMAL = 0,
+        T_ROW_DIR,
+        T_ROW_SELECTED
+    }
+    T_ROW_COLOR;
+    typedef enum
+    {
+        T_ROW_BG_1 = 0,
+        T_ROW_BG_2,
+        T_ROW_CURSOR_1,
+        T_ROW_CURSOR_2
+    }
+    T_ROW_BG;
+
+    // Icon and text color of the given entry
+    SDL_Surface *getIcon(const unsigned int p_i) const;
+    const T_ROW_COLOR getRowColor(const unsigned int p_i) const;
+
+    // Get the rendered name of the given entry, from the row cache
+    SDL_Surface *getRow(const unsigned int p_i, const T_ROW_COLOR p_color, const T_ROW_BG p_bg) const;
+
+    // Render the name of the given entry in the row cache
+    SDL_Surface *renderRow(const unsigned int p_i, const T_ROW_COLOR p_color, const T_ROW_BG p_bg) const;
+
+    // Forget all rendered rows, when indices or colors change
+    void clearRows(void);
+
+    // Request the thumbnails of the visible cells, release those far from them,
+    // and get the decoded ones
+    // Returns true if one was decoded
+    const bool updateThumbnails(void);
+
+    // Cancel or free all thumbnails, when the entries change
+    void clearThumbnails(void);
+
+    // Decode the thumbnail of a modified image again
+    // The previous one is shown until then
+    void reloadThumbnail(const std::string &p_name);
+
+    // Watch a path with inotify, before listing it so that no change is missed
+    // Returns the watch descriptor, -1 on error
+    const int addWatch(const std::string &p_path) const;
+
+    // Make a descriptor of addWatch the watch of the current path, or remove it
+    void setWatch(const int p_watch);
+    void removeWatch(const int p_watch) const;
+
+    // Apply the pending inotify events to the file lister
+    // Returns true if an entry was added, removed or modified
+    const bool applyWatchEvents(void);
+
+    // Highlight the given item, or the given line if the item is not found
+    // Deferred until the end of the listing if it's still in progress
+    void restoreHighlight(const std::string &p_name, const unsigned int p_line);
+    void locateHighlight(const std::string &p_name, const unsigned int p_line);
+
     // File lister
     CFileLister m_fileLister;
 
     // Current path
     std::string m_currentPath;
 
-    // Index of the first displayed line
+    // Index of the first displayed line, or cell
     unsigned int m_camera;
 
+    // View
+    T_VIEW_MODE m_viewMode;
+
     // X coordinate
     const Sint16 m_x;
 
     // Highlighted line
     unsigned int m_highlightedLine;
 
+    // inotify instance and watch descriptor on the current path
+    int m_inotifyFd;
+    int m_watch;
+
+    // Item to highlight when the background listing completes
+    std::string m_restoreName;
+    unsigned int m_restoreLine;
+    bool m_cursorMoved;
+
     // Selection list
     std::set<unsigned int> m_selectList;
 
+    // Footer status
+    std::string m_status;
+
+    // Rendered rows, most recently used first
+    // Key = index << 4 | color << 2 | background
+    struct T_ROW
+    {
+        Uint64 m_key;
+        SDL_Surface *m_surface;
+    };
+    mutable std::list<T_ROW> m_rows;
+    mutable std::unordered_map<Uint64, std::list<T_ROW>::iterator> m_rowIndex;
+    mutable std::size_t m_rowBytes;
+    mutable unsigned int m_nbRowHits;
+    mutable unsigned int m_nbRowMisses;
+
+    // Thumbnails of the images around the visible cells, by name
+    // The surface is owned once the loader is done, NULL if it couldn't be decoded
+    struct T_THUMBNAIL
+    {
+        unsigned int m_id;
+        bool m_loading;
+        SDL_Surface *m_surface;
+    };
+    std::map<std::string, T_THUMBNAIL> m_thumbnails;
+
+    // State of the last render, and what changed since
+    mutable unsigned int m_renderedCamera;
+    mutable unsigned int m_renderedLine;
+    mutable unsigned int m_renderedNbTotal;
+    mutable bool m_renderedActive;
+    mutable bool m_damageAll;
+    mutable bool m_damageFooter;
+    mutable std::set<unsigned int> m_damagedLines;
+
     // Pointers to resources
     SDL_Surface *m_iconDir;
     SDL_Surface *m_iconFile;
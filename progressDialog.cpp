@@ -0,0 +1,286 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include "progressDialog.h"
+#include "resourceManager.h"
+#include "fileutils.h"
+#include "screen.h"
+#include "sdlutils.h"
+#include "def.h"
+
+// Refresh period of the progress, in ms
+#define PROGRESS_UPDATE_MS 250
+// Width of the dialog
+#define PROGRESS_W (screen.w * 3 / 4)
+// Lines: title, item, bar, size, speed, 2 options, other jobs
+#define PROGRESS_LINE_OPTIONS 5
+#define PROGRESS_NB_OPTIONS 2
+#define PROGRESS_NB_JOB_LINES 3
+#define PROGRESS_NB_LINES (PROGRESS_LINE_OPTIONS + PROGRESS_NB_OPTIONS + PROGRESS_NB_JOB_LINES)
+
+namespace {
+
+const char *JobName(const T_JOB_TYPE p_type)
+{
+    switch (p_type)
+    {
+        case T_JOB_COPY: return "Copy";
+        case T_JOB_MOVE: return "Move";
+        default: return "Delete";
+    }
+}
+
+const char *StatusName(const T_JOB_STATUS p_status)
+{
+    switch (p_status)
+    {
+        case T_JOB_QUEUED: return "queued";
+        case T_JOB_RUNNING: return "running";
+        case T_JOB_DONE: return "done";
+        case T_JOB_FAILED: return "failed";
+        default: return "cancelled";
+    }
+}
+
+// "Copy 3 items"
+std::string JobTitle(const T_JOB_INFO &p_info)
+{
+    std::ostringstream l_s;
+    l_s << JobName(p_info.m_type) << " " << p_info.m_nbItems << (p_info.m_nbItems == 1 ? " item" : " items");
+    return l_s.str();
+}
+
+} // namespace
+
+CProgressDialog::CProgressDialog(CJobQueue &p_jobs):
+    CWindow(),
+    m_jobs(p_jobs),
+    m_lastUpdate(0),
+    m_closeWhenIdle(false),
+    m_highlightedLine(0),
+    m_image(NULL),
+    m_cursor1(NULL),
+    m_cursor2(NULL),
+    m_x(0),
+    m_y(0)
+{
+    m_closeWhenIdle = m_jobs.isBusy();
+    updateJobs();
+    // Dialog image: title bar and background
+    const int l_height = PROGRESS_NB_LINES * LINE_HEIGHT + 2 * DIALOG_BORDER;
+    m_image = SDL_utils::createImage(PROGRESS_W * screen.ppu_x, l_height * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_BORDER));
+    {
+        SDL_Rect l_rect = SDL_utils::Rect(DIALOG_BORDER * screen.ppu_x, (DIALOG_BORDER + LINE_HEIGHT) * screen.ppu_y, (PROGRESS_W - 2 * DIALOG_BORDER) * screen.ppu_x, (l_height - 2 * DIALOG_BORDER - LINE_HEIGHT) * screen.ppu_y);
+        SDL_FillRect(m_image, &l_rect, SDL_MapRGB(m_image->format, COLOR_BG_1));
+    }
+    // Cursor images
+    m_cursor1 = SDL_utils::createImage((PROGRESS_W - 2 * DIALOG_BORDER) * screen.ppu_x, LINE_HEIGHT * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_1));
+    m_cursor2 = SDL_utils::createImage((PROGRESS_W - 2 * DIALOG_BORDER) * screen.ppu_x, LINE_HEIGHT * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_2));
+    // Centered
+    m_x = (screen.w - PROGRESS_W) / 2;
+    m_y = (screen.h - l_height) / 2;
+}
+
+CProgressDialog::~CProgressDialog(void)
+{
+    if (m_image != NULL)
+    {
+        SDL_FreeSurface(m_image);
+        m_image = NULL;
+    }
+    if (m_cursor1 != NULL)
+    {
+        SDL_FreeSurface(m_cursor1);
+        m_cursor1 = NULL;
+    }
+    if (m_cursor2 != NULL)
+    {
+        SDL_FreeSurface(m_cursor2);
+        m_cursor2 = NULL;
+    }
+}
+
+void CProgressDialog::updateJobs(void)
+{
+    m_jobs.getJobs(m_infos);
+    m_lastUpdate = SDL_GetTicks();
+}
+
+const int CProgressDialog::getMainJob(void) const
+{
+    // The running job, or the next queued one, or the last finished one
+    int l_queued(-1);
+    for (unsigned int l_i = 0; l_i < m_infos.size(); ++l_i)
+    {
+        if (m_infos[l_i].m_status == T_JOB_RUNNING)
+            return l_i;
+        if (m_infos[l_i].m_status == T_JOB_QUEUED && l_queued == -1)
+            l_queued = l_i;
+    }
+    if (l_queued != -1)
+        return l_queued;
+    return static_cast<int>(m_infos.size()) - 1;
+}
+
+void CProgressDialog::render(const bool p_focus) const
+{
+    INHIBIT(std::cout << "CProgressDialog::render  fullscreen: " << isFullScreen() << "  focus: " << p_focus << std::endl;)
+    CResourceManager &l_resources = CResourceManager::instance();
+    const SDL_Color l_bg = {COLOR_BG_1};
+    const Sint16 l_x = m_x + DIALOG_BORDER + DIALOG_MARGIN;
+    const Sint16 l_right = m_x + PROGRESS_W - DIALOG_BORDER - DIALOG_MARGIN;
+    const int l_width = (l_right - l_x) * screen.ppu_x;
+    Sint16 l_y = m_y + 4;
+    // Background
+    SDL_utils::applySurface(m_x, m_y, m_image, Globals::g_screen);
+    // Title
+    const int l_main = getMainJob();
+    std::string l_title("No job");
+    if (l_main != -1)
+    {
+        const T_JOB_INFO &l_info = m_infos[l_main];
+        std::ostringstream l_s;
+        l_s << JobTitle(l_info) << ": " << StatusName(l_info.m_status);
+        unsigned int l_nbQueued(0);
+        for (std::vector<T_JOB_INFO>::const_iterator l_it = m_infos.begin(); l_it != m_infos.end(); ++l_it)
+        {
+            if (l_it->m_status == T_JOB_QUEUED)
+                ++l_nbQueued;
+        }
+        if (l_info.m_status == T_JOB_QUEUED)
+            --l_nbQueued;
+        if (l_nbQueued)
+            l_s << " (+" << l_nbQueued << ")";
+        l_title = l_s.str();
+    }
+    l_resources.drawText(l_x, l_y - 1, Globals::g_screen, l_title, Globals::g_colorTextTitle, {COLOR_BORDER}, 0, l_width);
+    l_y += LINE_HEIGHT;
+    if (l_main != -1)
+    {
+        const T_JOB_INFO &l_info = m_infos[l_main];
+        // Current item, the end is shown if it's too long
+        const std::string l_current(File_utils::getFileName(l_info.m_current));
+        const int l_currentWidth = l_resources.getTextWidth(l_current);
+        l_resources.drawText(l_x, l_y, Globals::g_screen, l_current, Globals::g_colorTextNormal, l_bg, l_currentWidth > l_width ? l_currentWidth - l_width : 0, l_width);
+        l_y += LINE_HEIGHT;
+        // Progress bar, on bytes if known, else on files
+        double l_ratio(0.0);
+        if (l_info.m_status == T_JOB_DONE)
+            l_ratio = 1.0;
+        else if (l_info.m_bytesTotal)
+            l_ratio = static_cast<double>(l_info.m_bytesDone) / l_info.m_bytesTotal;
+        else if (l_info.m_filesTotal)
+            l_ratio = static_cast<double>(l_info.m_filesDone) / l_info.m_filesTotal;
+        if (l_ratio > 1.0)
+            l_ratio = 1.0;
+        {
+            SDL_Rect l_rect = SDL_utils::Rect(l_x * screen.ppu_x, (l_y + 3) * screen.ppu_y, l_width, (LINE_HEIGHT - 6) * screen.ppu_y);
+            SDL_FillRect(Globals::g_screen, &l_rect, SDL_MapRGB(Globals::g_screen->format, COLOR_BG_2));
+            l_rect.w = l_width * l_ratio;
+            SDL_FillRect(Globals::g_screen, &l_rect, SDL_MapRGB(Globals::g_screen->format, COLOR_CURSOR_1));
+        }
+        l_y += LINE_HEIGHT;
+        // Size and files
+        std::ostringstream l_s;
+        if (l_info.m_bytesTotal)
+        {
+            l_s << File_utils::formatBytes(l_info.m_bytesDone) << " / " << File_utils::formatBytes(l_info.m_bytesTotal);
+            l_resources.drawText(l_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg);
+            l_s.str("");
+        }
+        l_s << l_info.m_filesDone << " / " << l_info.m_filesTotal << " files";
+        l_resources.drawText(l_right - l_resources.getTextWidth(l_s.str()) / screen.ppu_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg);
+        l_y += LINE_HEIGHT;
+        // Throughput and ETA
+        if (l_info.m_seconds > 0.5 && l_info.m_bytesDone)
+        {
+            const double l_speed = l_info.m_bytesDone / l_info.m_seconds;
+            l_s.str("");
+            l_s << File_utils::formatBytes(l_speed) << "/s";
+            l_resources.drawText(l_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg);
+            if (l_info.m_status == T_JOB_RUNNING && l_info.m_bytesTotal > l_info.m_bytesDone)
+            {
+                const unsigned int l_eta = (l_info.m_bytesTotal - l_info.m_bytesDone) / l_speed;
+                l_s.str("");
+                l_s << "ETA " << l_eta / 60 << ":" << std::setfill('0') << std::setw(2) << l_eta % 60;
+                l_resources.drawText(l_right - l_resources.getTextWidth(l_s.str()) / screen.ppu_x, l_y, Globals::g_screen, l_s.str(), Globals::g_colorTextNormal, l_bg);
+            }
+        }
+        l_y += LINE_HEIGHT;
+    }
+    else
+    {
+        l_y += (PROGRESS_LINE_OPTIONS - 1) * LINE_HEIGHT;
+    }
+    // Options
+    static const char * const l_options[PROGRESS_NB_OPTIONS] = {"Hide", "Cancel"};
+    for (unsigned int l_i = 0; l_i < PROGRESS_NB_OPTIONS; ++l_i, l_y += LINE_HEIGHT)
+    {
+        if (l_i == m_highlightedLine)
+        {
+            SDL_utils::applySurface(m_x + DIALOG_BORDER, l_y - 4 + DIALOG_BORDER, p_focus ? m_cursor1 : m_cursor2, Globals::g_screen);
+            l_resources.drawText(l_x, l_y, Globals::g_screen, l_options[l_i], Globals::g_colorTextNormal, p_focus ? SDL_Color{COLOR_CURSOR_1} : SDL_Color{COLOR_CURSOR_2});
+        }
+        else
+        {
+            l_resources.drawText(l_x, l_y, Globals::g_screen, l_options[l_i], Globals::g_colorTextNormal, l_bg);
+        }
+    }
+    // Status of the other jobs, most recent first
+    unsigned int l_nbLines(0);
+    for (std::vector<T_JOB_INFO>::const_reverse_iterator l_it = m_infos.rbegin(); l_it != m_infos.rend() && l_nbLines < PROGRESS_NB_JOB_LINES; ++l_it)
+    {
+        if (l_main != -1 && l_it->m_id == m_infos[l_main].m_id)
+            continue;
+        l_resources.drawText(l_x, l_y, Globals::g_screen, JobTitle(*l_it) + ": " + StatusName(l_it->m_status), Globals::g_colorTextNormal, l_bg, 0, l_width);
+        l_y += LINE_HEIGHT;
+        ++l_nbLines;
+    }
+}
+
+const bool CProgressDialog::keyPress(const SDL_Event &p_event)
+{
+    CWindow::keyPress(p_event);
+    bool l_ret(false);
+    switch (p_event.key.keysym.sym)
+    {
+        case MYKEY_PARENT:
+            m_retVal = -1;
+            l_ret = true;
+            break;
+        case MYKEY_UP:
+        case MYKEY_DOWN:
+            m_highlightedLine = 1 - m_highlightedLine;
+            l_ret = true;
+            break;
+        case MYKEY_OPEN:
+            if (m_highlightedLine == 0)
+            {
+                // Hide, jobs continue in the background
+                m_retVal = 1;
+            }
+            else
+            {
+                // Cancel the job shown
+                const int l_main = getMainJob();
+                if (l_main != -1)
+                    m_jobs.cancel(m_infos[l_main].m_id);
+                updateJobs();
+            }
+            l_ret = true;
+            break;
+        default:
+            break;
+    }
+    return l_ret;
+}
+
+const bool CProgressDialog::update(void)
+{
+    if (SDL_GetTicks() - m_lastUpdate < PROGRESS_UPDATE_MS)
+        return false;
+    updateJobs();
+    if (m_closeWhenIdle && !m_jobs.isBusy())
+        m_retVal = 1;
+    return true;
+}
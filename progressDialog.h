@@ -0,0 +1,66 @@
+#ifndef _PROGRESS_DIALOG_H_
+#define _PROGRESS_DIALOG_H_
+
+#include <vector>
+#include <SDL.h>
+#include "window.h"
+#include "jobQueue.h"
+
+// Progress of the jobs of a queue, with options to hide it or cancel the running job
+// Closes by itself when the jobs running at opening are done
+class CProgressDialog : public CWindow
+{
+    public:
+
+    // Constructor
+    CProgressDialog(CJobQueue &p_jobs);
+
+    // Destructor
+    virtual ~CProgressDialog(void);
+
+    private:
+
+    // Forbidden
+    CProgressDialog(void);
+    CProgressDialog(const CProgressDialog &p_source);
+    const CProgressDialog &operator =(const CProgressDialog &p_source);
+
+    // Key press management
+    virtual const bool keyPress(const SDL_Event &p_event);
+
+    // Periodic update
+    virtual const bool update(void);
+
+    // Draw
+    virtual void render(const bool p_focus) const;
+
+    // Get a new snapshot of the jobs
+    void updateJobs(void);
+
+    // Index of the job shown in details, -1 if none
+    const int getMainJob(void) const;
+
+    // The queue
+    CJobQueue &m_jobs;
+
+    // Last snapshot of the jobs
+    std::vector<T_JOB_INFO> m_infos;
+    Uint32 m_lastUpdate;
+
+    // Close when no job is left
+    bool m_closeWhenIdle;
+
+    // The highlighted option
+    unsigned int m_highlightedLine;
+
+    // Images
+    SDL_Surface *m_image;
+    SDL_Surface *m_cursor1;
+    SDL_Surface *m_cursor2;
+
+    // Coordinates
+    Sint16 m_x;
+    Sint16 m_y;
+};
+
+#endif
@@ -1,11 +1,14 @@
 #include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
 
 #include <SDL_image.h>
-#include <SDL2_rotozoom.h>
 #include "resourceManager.h"
 #include "def.h"
 #include "screen.h"
 #include "sdlutils.h"
+#include "imageScaler.h"
 
 namespace {
 
@@ -16,19 +19,88 @@ SDL_Surface *LoadIcon(const char *path) {
         std::cerr << "LoadIcon(\"" << path << "\"): " << IMG_GetError() << std::endl;
         return nullptr;
     }
-    SDL_Surface *scaled = nullptr;
-    if ((screen.ppu_x == 1 || screen.ppu_x == 2) && (screen.ppu_y == 1 || screen.ppu_y == 2)) {
-        scaled = shrinkSurface(img, 2 / screen.ppu_x, 2 / screen.ppu_y);
-    } else {
-        scaled = zoomSurface(img, screen.ppu_x / 2, screen.ppu_y / 2, SMOOTHING_ON);
-    }
+    // Icons are made for 2 pixels per unit
+    SDL_Surface *scaled = Image_scaler::scale(img, img->w * screen.ppu_x / 2, img->h * screen.ppu_y / 2);
     SDL_FreeSurface(img);
+    if (scaled == nullptr)
+    {
+        std::cerr << "LoadIcon(\"" << path << "\"): " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
     // SDL_Surface *display = SDL_DisplayFormatAlpha(scaled);
     SDL_Surface *display = SDL_ConvertSurfaceFormat(scaled, SDL_PIXELFORMAT_RGBA8888, 0);
     SDL_FreeSurface(scaled);
     return display;
 }
 
+// Decode the UTF-8 character at p_it, and move p_it after it
+// Invalid sequences give U+FFFD
+Uint32 DecodeUtf8(const char *&p_it, const char *p_end)
+{
+    const unsigned char l_lead = *p_it++;
+    if (l_lead < 0x80)
+        return l_lead;
+    int l_nb = 0;
+    Uint32 l_c = 0;
+    if (l_lead >= 0xC2 && l_lead < 0xE0)
+    {
+        l_nb = 1;
+        l_c = l_lead & 0x1F;
+    }
+    else if (l_lead >= 0xE0 && l_lead < 0xF0)
+    {
+        l_nb = 2;
+        l_c = l_lead & 0x0F;
+    }
+    else if (l_lead >= 0xF0 && l_lead < 0xF5)
+    {
+        l_nb = 3;
+        l_c = l_lead & 0x07;
+    }
+    else
+    {
+        return 0xFFFD;
+    }
+    for ( ; l_nb > 0; --l_nb)
+    {
+        if (p_it == p_end || (static_cast<unsigned char>(*p_it) & 0xC0) != 0x80)
+            return 0xFFFD;
+        l_c = (l_c << 6) | (static_cast<unsigned char>(*p_it++) & 0x3F);
+    }
+    return l_c;
+}
+
+// Encode a code point in UTF-8, NUL-terminated
+void EncodeUtf8(const Uint32 p_c, char p_out[5])
+{
+    if (p_c < 0x80)
+    {
+        p_out[0] = p_c;
+        p_out[1] = '\0';
+    }
+    else if (p_c < 0x800)
+    {
+        p_out[0] = 0xC0 | (p_c >> 6);
+        p_out[1] = 0x80 | (p_c & 0x3F);
+        p_out[2] = '\0';
+    }
+    else if (p_c < 0x10000)
+    {
+        p_out[0] = 0xE0 | (p_c >> 12);
+        p_out[1] = 0x80 | ((p_c >> 6) & 0x3F);
+        p_out[2] = 0x80 | (p_c & 0x3F);
+        p_out[3] = '\0';
+    }
+    else
+    {
+        p_out[0] = 0xF0 | (p_c >> 18);
+        p_out[1] = 0x80 | ((p_c >> 12) & 0x3F);
+        p_out[2] = 0x80 | ((p_c >> 6) & 0x3F);
+        p_out[3] = 0x80 | (p_c & 0x3F);
+        p_out[4] = '\0';
+    }
+}
+
 } // namespace
 
 CResourceManager& CResourceManager::instance(void)
@@ -38,7 +110,8 @@ CResourceManager& CResourceManager::instance(void)
 }
 
 CResourceManager::CResourceManager(void) :
-    m_font(NULL)
+    m_font(NULL),
+    m_glyphBytes(0)
 {
     // Load images
     m_surfaces[T_SURFACE_FOLDER] = LoadIcon(RES_DIR "folder.png");
@@ -66,6 +139,17 @@ void CResourceManager::sdlCleanup(void)
             m_surfaces[l_i] = NULL;
         }
     }
+    // Free glyphs
+    for (std::list<T_GLYPH>::iterator l_it = m_glyphs.begin(); l_it != m_glyphs.end(); ++l_it)
+    {
+        if (l_it->m_surface != NULL)
+            SDL_FreeSurface(l_it->m_surface);
+    }
+    m_glyphs.clear();
+    m_glyphIndex.clear();
+    m_glyphBytes = 0;
+    m_glyphColors.clear();
+    m_advances.clear();
     // Free font
     if (m_font != NULL)
     {
@@ -83,3 +167,161 @@ TTF_Font *CResourceManager::getFont(void) const
 {
     return m_font;
 }
+
+const int CResourceManager::getAdvance(const Uint32 p_codePoint)
+{
+    std::unordered_map<Uint32, int>::const_iterator l_it = m_advances.find(p_codePoint);
+    if (l_it != m_advances.end())
+        return l_it->second;
+    int l_advance(0);
+    if (p_codePoint < 0x10000)
+    {
+        int l_minX, l_maxX, l_minY, l_maxY;
+        if (TTF_GlyphMetrics(m_font, p_codePoint, &l_minX, &l_maxX, &l_minY, &l_maxY, &l_advance) != 0)
+            l_advance = 0;
+    }
+    else
+    {
+        // Outside of the BMP, use the rendered width
+        char l_utf8[5];
+        EncodeUtf8(p_codePoint, l_utf8);
+        int l_height;
+        if (TTF_SizeUTF8(m_font, l_utf8, &l_advance, &l_height) != 0)
+            l_advance = 0;
+    }
+    m_advances[p_codePoint] = l_advance;
+    return l_advance;
+}
+
+SDL_Surface *CResourceManager::getGlyph(const Uint32 p_codePoint, const Uint32 p_mark, const SDL_Color &p_fg, const SDL_Color &p_bg)
+{
+    // Index of the colors
+    const Uint64 l_colors = (static_cast<Uint64>((p_fg.r << 16) | (p_fg.g << 8) | p_fg.b) << 24) | (p_bg.r << 16) | (p_bg.g << 8) | p_bg.b;
+    const Uint64 l_colorIndex = m_glyphColors.insert(std::make_pair(l_colors, static_cast<Uint64>(m_glyphColors.size()))).first->second;
+    const Uint64 l_key = (l_colorIndex << 42) | (static_cast<Uint64>(p_mark) << 21) | p_codePoint;
+    std::unordered_map<Uint64, std::list<T_GLYPH>::iterator>::const_iterator l_it = m_glyphIndex.find(l_key);
+    if (l_it != m_glyphIndex.end())
+    {
+        m_glyphs.splice(m_glyphs.begin(), m_glyphs, l_it->second);
+        return l_it->second->m_surface;
+    }
+    char l_utf8[9];
+    EncodeUtf8(p_codePoint, l_utf8);
+    if (p_mark)
+        EncodeUtf8(p_mark, l_utf8 + strlen(l_utf8));
+    SDL_Surface *l_glyph = renderGlyph(l_utf8, getAdvance(p_codePoint), p_fg, p_bg);
+    // Evict the least recently used glyphs
+    const std::size_t l_bytes = l_glyph == NULL ? 0 : l_glyph->pitch * l_glyph->h;
+    while (!m_glyphs.empty() && m_glyphBytes + l_bytes > GLYPH_CACHE_SIZE_MAX)
+    {
+        if (m_glyphs.back().m_surface != NULL)
+        {
+            m_glyphBytes -= m_glyphs.back().m_surface->pitch * m_glyphs.back().m_surface->h;
+            SDL_FreeSurface(m_glyphs.back().m_surface);
+        }
+        m_glyphIndex.erase(m_glyphs.back().m_key);
+        m_glyphs.pop_back();
+    }
+    INHIBIT(std::cout << "CResourceManager::getGlyph: U+" << std::hex << p_codePoint << std::dec << " rendered, " << m_glyphs.size() + 1 << " glyphs, " << m_glyphBytes + l_bytes << " bytes" << std::endl;)
+    T_GLYPH l_entry;
+    l_entry.m_key = l_key;
+    l_entry.m_surface = l_glyph;
+    m_glyphs.push_front(l_entry);
+    m_glyphIndex[l_key] = m_glyphs.begin();
+    m_glyphBytes += l_bytes;
+    return l_glyph;
+}
+
+SDL_Surface *CResourceManager::renderGlyph(const char *p_utf8, const int p_advance, const SDL_Color &p_fg, const SDL_Color &p_bg)
+{
+    // Render the glyph on a background one advance wide
+    if (p_advance <= 0)
+        return NULL;
+    SDL_Surface *l_glyph = SDL_utils::createImage(p_advance, TTF_FontHeight(m_font), SDL_MapRGB(Globals::g_screen->format, p_bg.r, p_bg.g, p_bg.b));
+    SDL_Surface *l_rendered = TTF_RenderUTF8_Shaded(m_font, p_utf8, p_fg, p_bg);
+    if (l_rendered != NULL)
+    {
+        SDL_BlitSurface(l_rendered, NULL, l_glyph, NULL);
+        SDL_FreeSurface(l_rendered);
+    }
+    else
+    {
+        SDL_ClearError();
+    }
+    return l_glyph;
+}
+
+const int CResourceManager::drawText(const Sint16 p_x, const Sint16 p_y, SDL_Surface *p_destination, const char *p_text, const std::size_t p_length, const SDL_Color &p_fg, const SDL_Color &p_bg, const int p_skip, const int p_width)
+{
+    if (m_font == NULL)
+        return 0;
+    const char *l_it = p_text;
+    const char *l_end = p_text + p_length;
+    const int l_x = p_x * screen.ppu_x;
+    const int l_y = p_y * screen.ppu_y;
+    const int l_width = p_width < 0 ? INT_MAX : p_width;
+    // Pen position, relative to l_x
+    int l_pen = -p_skip;
+    SDL_Rect l_clip;
+    SDL_Rect l_offset;
+    while (l_it < l_end && l_pen < l_width)
+    {
+        const char *l_start = l_it;
+        const Uint32 l_codePoint = DecodeUtf8(l_it, l_end);
+        // The combining marks that follow, without advance, are rendered
+        // by the font with the glyph, e.g. NFD "e" + U+0301
+        Uint32 l_mark(0);
+        unsigned int l_nbMarks(0);
+        const char *l_next = l_it;
+        while (l_next < l_end)
+        {
+            const Uint32 l_c = DecodeUtf8(l_next, l_end);
+            if (getAdvance(l_c) != 0)
+                break;
+            l_mark = l_c;
+            l_it = l_next;
+            ++l_nbMarks;
+        }
+        // More than one mark is rare => not cached
+        SDL_Surface *l_glyph = l_nbMarks <= 1 ? getGlyph(l_codePoint, l_mark, p_fg, p_bg) : renderGlyph(std::string(l_start, l_it).c_str(), getAdvance(l_codePoint), p_fg, p_bg);
+        if (l_glyph == NULL)
+            continue;
+        if (l_pen + l_glyph->w > 0)
+        {
+            // Blit the visible part of the glyph
+            l_clip.x = l_pen < 0 ? -l_pen : 0;
+            l_clip.y = 0;
+            l_clip.w = std::min(l_glyph->w, l_width - l_pen) - l_clip.x;
+            l_clip.h = l_glyph->h;
+            l_offset.x = l_x + l_pen + l_clip.x;
+            l_offset.y = l_y;
+            SDL_BlitSurface(l_glyph, &l_clip, p_destination, &l_offset);
+        }
+        l_pen += l_glyph->w;
+        if (l_nbMarks > 1)
+            SDL_FreeSurface(l_glyph);
+    }
+    return std::max(0, std::min(l_pen, l_width));
+}
+
+const int CResourceManager::drawText(const Sint16 p_x, const Sint16 p_y, SDL_Surface *p_destination, const std::string &p_text, const SDL_Color &p_fg, const SDL_Color &p_bg, const int p_skip, const int p_width)
+{
+    return drawText(p_x, p_y, p_destination, p_text.c_str(), p_text.size(), p_fg, p_bg, p_skip, p_width);
+}
+
+const int CResourceManager::getTextWidth(const char *p_text, const std::size_t p_length)
+{
+    if (m_font == NULL)
+        return 0;
+    int l_width(0);
+    const char *l_it = p_text;
+    const char *l_end = p_text + p_length;
+    while (l_it < l_end)
+        l_width += getAdvance(DecodeUtf8(l_it, l_end));
+    return l_width;
+}
+
+const int CResourceManager::getTextWidth(const std::string &p_text)
+{
+    return getTextWidth(p_text.c_str(), p_text.size());
+}
@@ -1,6 +1,9 @@
 #ifndef _RESOURCEMANAGER_H_
 #define _RESOURCEMANAGER_H_
 
+#include <string>
+#include <list>
+#include <unordered_map>
 #include <SDL.h>
 #include <SDL_ttf.h>
 
@@ -35,6 +38,17 @@ class CResourceManager
     // Get the loaded font
     TTF_Font *getFont(void) const;
 
+    // Draw a UTF-8 text with the loaded font, using the glyph cache
+    // p_x and p_y are logical coordinates, like SDL_utils::applySurface
+    // The first p_skip pixels of the text are not drawn, nor the pixels after p_width (-1 = no limit)
+    // Returns the drawn width, in pixels
+    const int drawText(const Sint16 p_x, const Sint16 p_y, SDL_Surface *p_destination, const char *p_text, const std::size_t p_length, const SDL_Color &p_fg, const SDL_Color &p_bg, const int p_skip = 0, const int p_width = -1);
+    const int drawText(const Sint16 p_x, const Sint16 p_y, SDL_Surface *p_destination, const std::string &p_text, const SDL_Color &p_fg, const SDL_Color &p_bg, const int p_skip = 0, const int p_width = -1);
+
+    // Width of a text drawn by drawText, in pixels
+    const int getTextWidth(const char *p_text, const std::size_t p_length);
+    const int getTextWidth(const std::string &p_text);
+
     private:
 
     // Forbidden
@@ -45,8 +59,35 @@ class CResourceManager
     // Images
     SDL_Surface *m_surfaces[NB_SURFACES];
 
+    // Get a glyph from the cache, rendered on first use
+    // with the combining mark p_mark over it, if not 0
+    // Returns NULL for glyphs without advance
+    SDL_Surface *getGlyph(const Uint32 p_codePoint, const Uint32 p_mark, const SDL_Color &p_fg, const SDL_Color &p_bg);
+
+    // Render UTF-8 text on a background p_advance pixels wide
+    // Returns NULL if p_advance is 0
+    SDL_Surface *renderGlyph(const char *p_utf8, const int p_advance, const SDL_Color &p_fg, const SDL_Color &p_bg);
+
+    // Get the advance of a glyph, in pixels
+    const int getAdvance(const Uint32 p_codePoint);
+
     // Font
     TTF_Font *m_font;
+
+    // Glyph cache, in the screen format, each glyph is one advance wide
+    // Most recently used first, limited to GLYPH_CACHE_SIZE_MAX bytes
+    // Key = index in m_glyphColors << 42 | combining mark << 21 | code point
+    struct T_GLYPH
+    {
+        Uint64 m_key;
+        SDL_Surface *m_surface;
+    };
+    std::list<T_GLYPH> m_glyphs;
+    std::unordered_map<Uint64, std::list<T_GLYPH>::iterator> m_glyphIndex;
+    std::size_t m_glyphBytes;
+    // Index of each fg << 24 | bg color pair
+    std::unordered_map<Uint64, Uint64> m_glyphColors;
+    std::unordered_map<Uint32, int> m_advances;
 };
 
 #endif
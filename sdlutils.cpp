@@ -1,12 +1,14 @@
 #include "sdlutils.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include <SDL_image.h>
-#include <SDL2_rotozoom.h>
 #include "def.h"
 #include "fileutils.h"
+#include "imageScaler.h"
 #include "resourceManager.h"
 #include "screen.h"
 
@@ -16,36 +18,30 @@ bool SDL_utils::isSupportedImageExt(const std::string &ext) {
     return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "ico" || ext == "bmp" || ext == "xcf";
 }
 
-SDL_Surface *SDL_utils::loadImageToFit(const std::string &p_filename, int fit_w, int fit_h)
+SDL_Surface *SDL_utils::scaleImageToFit(SDL_Surface *p_image, int fit_w, int fit_h)
 {
-    // Load image
-    SDL_Surface *l_img = IMG_Load(p_filename.c_str());
-    if (IMG_GetError() != nullptr && *IMG_GetError() != '\0') {
-        if (!strcmp(IMG_GetError(), "Unsupported image format") == 0)
-            std::cerr << "SDL_utils::loadImageToFit: " << IMG_GetError() << std::endl;
-        SDL_ClearError();
-        return nullptr;
-    }
-    const double aspect_ratio = static_cast<double>(l_img->w) / l_img->h;
     int target_w, target_h;
-    if (fit_w * l_img->h <= fit_h * l_img->w) {
-        target_w = std::min(l_img->w, fit_w);
+    getFitSize(p_image->w, p_image->h, fit_w, fit_h, target_w, target_h);
+    SDL_Surface *l_img2 = Image_scaler::scale(p_image, target_w, target_h);
+    if (l_img2 == nullptr || l_img2->format->format == SDL_PIXELFORMAT_RGBA8888)
+        return l_img2;
+    SDL_Surface *l_img3 = SDL_ConvertSurfaceFormat(l_img2, SDL_PIXELFORMAT_RGBA8888, 0);
+    SDL_FreeSurface(l_img2);
+    return l_img3;
+}
+
+void SDL_utils::getFitSize(int image_w, int image_h, int fit_w, int fit_h, int &target_w, int &target_h)
+{
+    const double aspect_ratio = static_cast<double>(image_w) / image_h;
+    if (fit_w * image_h <= fit_h * image_w) {
+        target_w = std::min(image_w, fit_w);
         target_h = target_w / aspect_ratio;
     } else {
-        target_h = std::min(l_img->h, fit_h);
+        target_h = std::min(image_h, fit_h);
         target_w = target_h * aspect_ratio;
     }
     target_w *= screen.ppu_x;
     target_h *= screen.ppu_y;
-    SDL_Surface *l_img2 = zoomSurface(l_img, static_cast<double>(target_w) / l_img->w, static_cast<double>(target_h) / l_img->h, SMOOTHING_ON);
-    SDL_FreeSurface(l_img);
-
-    const std::string ext = File_utils::getLowercaseFileExtension(p_filename);
-    const bool supports_alpha = ext != "xcf" && ext != "jpg" && ext != "jpeg";
-    // SDL_Surface *l_img3 = supports_alpha ? SDL_DisplayFormatAlpha(l_img2) : SDL_DisplayFormat(l_img2);
-    SDL_Surface *l_img3 = SDL_ConvertSurfaceFormat(l_img2, SDL_PIXELFORMAT_RGBA8888, 0); 
-    SDL_FreeSurface(l_img2);
-    return l_img3;
 }
 
 void SDL_utils::applySurface(const Sint16 p_x, const Sint16 p_y, SDL_Surface* p_source, SDL_Surface* p_destination, SDL_Rect *p_clip)
@@ -81,6 +77,24 @@ SDL_Surface *SDL_utils::renderText(TTF_Font *p_font, const std::string &p_text,
 
 void SDL_utils::applyText(Sint16 p_x, Sint16 p_y, SDL_Surface* p_destination, TTF_Font *p_font, const std::string &p_text, const SDL_Color &p_fg, const SDL_Color &p_bg, const T_TEXT_ALIGN p_align)
 {
+    CResourceManager &l_resources = CResourceManager::instance();
+    if (p_font == l_resources.getFont())
+    {
+        // Loaded font => glyph cache
+        switch (p_align)
+        {
+            case T_TEXT_ALIGN_RIGHT:
+                p_x -= l_resources.getTextWidth(p_text) / screen.ppu_x;
+                break;
+            case T_TEXT_ALIGN_CENTER:
+                p_x -= l_resources.getTextWidth(p_text) / 2 / screen.ppu_x;
+                break;
+            default:
+                break;
+        }
+        l_resources.drawText(p_x, p_y, p_destination, p_text, p_fg, p_bg);
+        return;
+    }
     SDL_Surface *l_text = renderText(p_font, p_text, p_fg, p_bg);
     switch (p_align)
     {
@@ -114,10 +128,76 @@ SDL_Surface *SDL_utils::createImage(const int p_width, const int p_height, const
     return l_ret;
 }
 
+// Frames per line of statistics, when COMMANDER_FRAME_TIMES is set
+#define FRAME_TIMES_NB 100
+
+namespace {
+// Next render must draw all windows
+bool g_fullRender = true;
+
+// Render times, in performance counter ticks
+struct T_FRAME_TIMES
+{
+    T_FRAME_TIMES(const char *p_name) : m_name(p_name), m_nbFrames(0), m_total(0), m_max(0) {}
+    const char *m_name;
+    unsigned int m_nbFrames;
+    Uint64 m_total;
+    Uint64 m_max;
+};
+T_FRAME_TIMES g_fullFrames("full");
+T_FRAME_TIMES g_damageFrames("damage");
+
+// Frame timing is enabled at run time, to be measured on the device
+// by running the commander with COMMANDER_FRAME_TIMES=1
+bool FrameTimesEnabled(void)
+{
+    static const bool l_enabled = getenv("COMMANDER_FRAME_TIMES") != NULL;
+    return l_enabled;
+}
+
+// COMMANDER_FRAME_TIMES=full renders all windows at each frame,
+// to compare with the damage renders
+bool DamageDisabled(void)
+{
+    static const bool l_disabled = FrameTimesEnabled() && strcmp(getenv("COMMANDER_FRAME_TIMES"), "full") == 0;
+    return l_disabled;
+}
+
+// Count a frame, and print the average and maximum every FRAME_TIMES_NB frames
+void AddFrameTime(T_FRAME_TIMES &p_frames, const Uint64 p_time)
+{
+    ++p_frames.m_nbFrames;
+    p_frames.m_total += p_time;
+    p_frames.m_max = std::max(p_frames.m_max, p_time);
+    if (p_frames.m_nbFrames < FRAME_TIMES_NB)
+        return;
+    const Uint64 l_frequency = SDL_GetPerformanceFrequency();
+    std::cout << "Frame times: " << p_frames.m_name << ": " << p_frames.m_nbFrames << " frames, average " << p_frames.m_total * 1000000 / l_frequency / p_frames.m_nbFrames << "us, max " << p_frames.m_max * 1000000 / l_frequency << "us" << std::endl;
+    p_frames.m_nbFrames = 0;
+    p_frames.m_total = 0;
+    p_frames.m_max = 0;
+}
+} // namespace
+
 void SDL_utils::renderAll(void)
 {
     if (Globals::g_windows.empty())
         return;
+    const Uint64 l_time = SDL_GetPerformanceCounter();
+    // Damage of the top window, if nothing else changed
+    if (!g_fullRender && !DamageDisabled())
+    {
+        std::vector<SDL_Rect> l_rects;
+        if (Globals::g_windows.back()->renderDamage(l_rects))
+        {
+            if (!l_rects.empty())
+                SDL_UpdateWindowSurfaceRects(Globals::g_sdlwindow, l_rects.data(), l_rects.size());
+            if (FrameTimesEnabled())
+                AddFrameTime(g_damageFrames, SDL_GetPerformanceCounter() - l_time);
+            INHIBIT(std::cout << "SDL_utils::renderAll: " << l_rects.size() << " rects in " << (SDL_GetPerformanceCounter() - l_time) * 1000000 / SDL_GetPerformanceFrequency() << "us" << std::endl;)
+            return;
+        }
+    }
     // First window to draw is the last fullscreen
     unsigned int l_i = Globals::g_windows.size() - 1;
     while (l_i && !Globals::g_windows[l_i]->isFullScreen())
@@ -125,6 +205,16 @@ void SDL_utils::renderAll(void)
     // Draw windows
     for (std::vector<CWindow *>::iterator l_it = Globals::g_windows.begin() + l_i; l_it != Globals::g_windows.end(); ++l_it)
         (*l_it)->render(l_it + 1 == Globals::g_windows.end());
+    SDL_UpdateWindowSurface(Globals::g_sdlwindow);
+    g_fullRender = false;
+    if (FrameTimesEnabled())
+        AddFrameTime(g_fullFrames, SDL_GetPerformanceCounter() - l_time);
+    INHIBIT(std::cout << "SDL_utils::renderAll: " << (SDL_GetPerformanceCounter() - l_time) * 1000000 / SDL_GetPerformanceFrequency() << "us" << std::endl;)
+}
+
+void SDL_utils::invalidateAll(void)
+{
+    g_fullRender = true;
 }
 
 void SDL_utils::hastalavista(void)
@@ -156,9 +246,7 @@ void SDL_utils::pleaseWait(void)
     SDL_FillRect(Globals::g_screen, &l_rect, SDL_MapRGB(Globals::g_screen->format, COLOR_BG_1));
     applySurface((screen.w - l_surfaceTmp->w / screen.ppu_x) / 2, (screen.h - l_surfaceTmp->h / screen.ppu_y) / 2, l_surfaceTmp, Globals::g_screen);
     SDL_FreeSurface(l_surfaceTmp);
-    //SDL_Flip(Globals::g_screen);
-    //SDL_Flip(Globals::g_screen);
-    // SDL_Flip(ScreenSurface);
-    SDL_UpdateWindowSurface(Globals::g_sdlwindow);
     SDL_UpdateWindowSurface(Globals::g_sdlwindow);
+    // Drawn over the windows
+    invalidateAll();
 }
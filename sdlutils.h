@@ -23,8 +23,12 @@ namespace SDL_utils
         return SDL_Rect{x, y, w, h};
     }
 
-    // Load an image to fit the given viewport size.
-    SDL_Surface *loadImageToFit(const std::string &p_filename, int fit_w, int fit_h);
+    // Scale an image to fit the given viewport size, in the viewer format.
+    // See CImageLoader to load one.
+    SDL_Surface *scaleImageToFit(SDL_Surface *p_image, int fit_w, int fit_h);
+
+    // Size of an image of image_w x image_h scaled by scaleImageToFit, in pixels
+    void getFitSize(int image_w, int image_h, int fit_w, int fit_h, int &target_w, int &target_h);
 
     bool isSupportedImageExt(const std::string &filename);
 
@@ -46,9 +50,13 @@ namespace SDL_utils
     // Create an image filled with the given color
     SDL_Surface *createImage(const int p_width, const int p_height, const Uint32 p_color);
 
-    // Render all opened windows
+    // Render all opened windows, and update the screen
+    // Only the damage is drawn if the top window supports it, see CWindow::renderDamage
     void renderAll(void);
 
+    // Force a full render next time, e.g. when the window stack changes
+    void invalidateAll(void);
+
     // Cleanup and quit
     void hastalavista(void);
 
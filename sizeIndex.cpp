@@ -0,0 +1,231 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <SDL.h>
+#include "sizeIndex.h"
+#include "fileutils.h"
+#include "def.h"
+
+// File header, and version of the entries
+#define SIZE_INDEX_MAGIC "CSIX"
+#define SIZE_INDEX_VERSION 1
+
+CSizeIndex& CSizeIndex::instance(void)
+{
+    static CSizeIndex l_singleton;
+    return l_singleton;
+}
+
+CSizeIndex::CSizeIndex(void) :
+    m_session(1),
+    m_loaded(false),
+    m_dirty(false)
+{
+    // Without home, the index lasts until exit
+    const char *l_home = getenv("HOME");
+    if (SIZE_INDEX_FILE[0] == '/')
+        m_path = SIZE_INDEX_FILE;
+    else if (l_home != NULL && *l_home != '\0')
+        m_path = std::string(l_home) + "/" + SIZE_INDEX_FILE;
+}
+
+CSizeIndex::~CSizeIndex(void)
+{
+    save();
+}
+
+void CSizeIndex::load(void)
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+    if (m_path.empty())
+        return;
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    std::string l_buffer;
+    {
+        std::ifstream l_file(m_path.c_str(), std::ios::in | std::ios::binary);
+        if (!l_file.is_open())
+            return;
+        std::ostringstream l_s;
+        l_s << l_file.rdbuf();
+        l_buffer = l_s.str();
+    }
+    // Header: magic, version, last session, number of entries
+    std::size_t l_pos = sizeof(SIZE_INDEX_MAGIC) - 1;
+    std::uint32_t l_version(0);
+    std::uint32_t l_session(0);
+    std::uint32_t l_nbEntries(0);
+    if (l_buffer.compare(0, l_pos, SIZE_INDEX_MAGIC) != 0 || !File_utils::readValue(l_buffer, l_pos, l_version) || l_version != SIZE_INDEX_VERSION || !File_utils::readValue(l_buffer, l_pos, l_session) || !File_utils::readValue(l_buffer, l_pos, l_nbEntries))
+    {
+        std::cerr << "CSizeIndex::load: Error " << m_path << " has an unknown format, ignored" << std::endl;
+        return;
+    }
+    m_session = l_session + 1;
+    // Entries: device, inode, mtime, session, own totals, subdir names
+    for (std::uint32_t l_i = 0; l_i < l_nbEntries; ++l_i)
+    {
+        std::uint64_t l_dev, l_ino, l_apparentSize, l_allocatedSize;
+        std::int64_t l_sec;
+        std::uint32_t l_nsec, l_nbFiles, l_nbSubdirs;
+        T_ENTRY l_entry;
+        bool l_ok = File_utils::readValue(l_buffer, l_pos, l_dev) && File_utils::readValue(l_buffer, l_pos, l_ino) && File_utils::readValue(l_buffer, l_pos, l_sec) && File_utils::readValue(l_buffer, l_pos, l_nsec) && File_utils::readValue(l_buffer, l_pos, l_entry.m_session)
+            && File_utils::readValue(l_buffer, l_pos, l_apparentSize) && File_utils::readValue(l_buffer, l_pos, l_allocatedSize) && File_utils::readValue(l_buffer, l_pos, l_nbFiles) && File_utils::readValue(l_buffer, l_pos, l_nbSubdirs);
+        for (std::uint32_t l_j = 0; l_ok && l_j < l_nbSubdirs; ++l_j)
+        {
+            std::uint16_t l_length;
+            l_ok = File_utils::readValue(l_buffer, l_pos, l_length) && l_pos + l_length <= l_buffer.size();
+            if (l_ok)
+            {
+                l_entry.m_size.m_subdirs.push_back(l_buffer.substr(l_pos, l_length));
+                l_pos += l_length;
+            }
+        }
+        if (!l_ok)
+        {
+            std::cerr << "CSizeIndex::load: Error " << m_path << " is truncated, ignored" << std::endl;
+            m_entries.clear();
+            return;
+        }
+        l_entry.m_mtime.tv_sec = l_sec;
+        l_entry.m_mtime.tv_nsec = l_nsec;
+        l_entry.m_size.m_apparentSize = l_apparentSize;
+        l_entry.m_size.m_allocatedSize = l_allocatedSize;
+        l_entry.m_size.m_nbFiles = l_nbFiles;
+        m_entries[std::make_pair(static_cast<dev_t>(l_dev), static_cast<ino_t>(l_ino))] = l_entry;
+    }
+    INHIBIT(std::cout << "CSizeIndex::load: " << m_entries.size() << " dirs, " << l_buffer.size() << " bytes in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+}
+
+const bool CSizeIndex::get(const struct stat &p_stat, T_DIR_SIZE &p_size)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    load();
+    std::map<std::pair<dev_t, ino_t>, T_ENTRY>::iterator l_it = m_entries.find(std::make_pair(p_stat.st_dev, p_stat.st_ino));
+    if (l_it == m_entries.end())
+        return false;
+    if (l_it->second.m_mtime.tv_sec != p_stat.st_mtim.tv_sec || l_it->second.m_mtime.tv_nsec != p_stat.st_mtim.tv_nsec)
+    {
+        // The dir has changed
+        m_entries.erase(l_it);
+        m_dirty = true;
+        return false;
+    }
+    if (l_it->second.m_session != m_session)
+    {
+        l_it->second.m_session = m_session;
+        m_dirty = true;
+    }
+    p_size = l_it->second.m_size;
+    return true;
+}
+
+void CSizeIndex::put(const struct stat &p_stat, const T_DIR_SIZE &p_size)
+{
+    // A dir modified within the mtime granularity (2s on FAT) could change
+    // again without its mtime changing => don't index it yet
+    struct timespec l_now;
+    clock_gettime(CLOCK_REALTIME, &l_now);
+    if (l_now.tv_sec - p_stat.st_mtim.tv_sec < 2)
+        return;
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    load();
+    T_ENTRY &l_entry = m_entries[std::make_pair(p_stat.st_dev, p_stat.st_ino)];
+    l_entry.m_mtime = p_stat.st_mtim;
+    l_entry.m_session = m_session;
+    l_entry.m_size = p_size;
+    m_dirty = true;
+}
+
+void CSizeIndex::invalidate(const struct stat &p_stat)
+{
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    load();
+    if (m_entries.erase(std::make_pair(p_stat.st_dev, p_stat.st_ino)))
+        m_dirty = true;
+}
+
+void CSizeIndex::invalidate(const std::string &p_dir)
+{
+    struct stat l_stat;
+    if (stat(p_dir.c_str(), &l_stat) == 0)
+        invalidate(l_stat);
+}
+
+void CSizeIndex::save(void)
+{
+    std::lock_guard<std::mutex> l_saveLock(m_saveMutex);
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    std::string l_buffer;
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        if (!m_dirty || m_path.empty())
+            return;
+        m_dirty = false;
+        // Too many dirs => drop the ones unused for the longest time
+        if (m_entries.size() > SIZE_INDEX_NB_MAX)
+        {
+            std::vector<unsigned int> l_sessions;
+            l_sessions.reserve(m_entries.size());
+            for (std::map<std::pair<dev_t, ino_t>, T_ENTRY>::const_iterator l_it = m_entries.begin(); l_it != m_entries.end(); ++l_it)
+                l_sessions.push_back(l_it->second.m_session);
+            std::nth_element(l_sessions.begin(), l_sessions.begin() + (m_entries.size() - SIZE_INDEX_NB_MAX), l_sessions.end());
+            const unsigned int l_oldest = l_sessions[m_entries.size() - SIZE_INDEX_NB_MAX];
+            for (std::map<std::pair<dev_t, ino_t>, T_ENTRY>::iterator l_it = m_entries.begin(); l_it != m_entries.end() && m_entries.size() > SIZE_INDEX_NB_MAX; )
+            {
+                if (l_it->second.m_session <= l_oldest)
+                    l_it = m_entries.erase(l_it);
+                else
+                    ++l_it;
+            }
+        }
+        l_buffer.append(SIZE_INDEX_MAGIC);
+        File_utils::writeValue<std::uint32_t>(l_buffer, SIZE_INDEX_VERSION);
+        File_utils::writeValue<std::uint32_t>(l_buffer, m_session);
+        File_utils::writeValue<std::uint32_t>(l_buffer, m_entries.size());
+        for (std::map<std::pair<dev_t, ino_t>, T_ENTRY>::const_iterator l_it = m_entries.begin(); l_it != m_entries.end(); ++l_it)
+        {
+            const T_ENTRY &l_entry = l_it->second;
+            File_utils::writeValue<std::uint64_t>(l_buffer, l_it->first.first);
+            File_utils::writeValue<std::uint64_t>(l_buffer, l_it->first.second);
+            File_utils::writeValue<std::int64_t>(l_buffer, l_entry.m_mtime.tv_sec);
+            File_utils::writeValue<std::uint32_t>(l_buffer, l_entry.m_mtime.tv_nsec);
+            File_utils::writeValue<std::uint32_t>(l_buffer, l_entry.m_session);
+            File_utils::writeValue<std::uint64_t>(l_buffer, l_entry.m_size.m_apparentSize);
+            File_utils::writeValue<std::uint64_t>(l_buffer, l_entry.m_size.m_allocatedSize);
+            File_utils::writeValue<std::uint32_t>(l_buffer, l_entry.m_size.m_nbFiles);
+            File_utils::writeValue<std::uint32_t>(l_buffer, l_entry.m_size.m_subdirs.size());
+            for (std::vector<std::string>::const_iterator l_name = l_entry.m_size.m_subdirs.begin(); l_name != l_entry.m_size.m_subdirs.end(); ++l_name)
+            {
+                File_utils::writeValue<std::uint16_t>(l_buffer, l_name->size());
+                l_buffer.append(*l_name);
+            }
+        }
+    }
+    // Written aside then renamed, a crash leaves the previous index
+    File_utils::makeDirs(File_utils::getPath(m_path));
+    const std::string l_tmp(m_path + ".tmp");
+    {
+        std::ofstream l_file(l_tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        l_file.write(l_buffer.data(), l_buffer.size());
+        if (!l_file.good())
+        {
+            std::cerr << "CSizeIndex::save: Error writing " << l_tmp << std::endl;
+            return;
+        }
+    }
+    if (rename(l_tmp.c_str(), m_path.c_str()) == -1)
+    {
+        std::cerr << "CSizeIndex::save: Error rename " << l_tmp << ": " << strerror(errno) << std::endl;
+        unlink(l_tmp.c_str());
+        return;
+    }
+    INHIBIT(std::cout << "CSizeIndex::save: " << l_buffer.size() << " bytes in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+}
@@ -0,0 +1,88 @@
+#ifndef _SIZE_INDEX_H_
+#define _SIZE_INDEX_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Contents of a dir, as counted by the size scanner
+struct T_DIR_SIZE
+{
+    // Entries directly in the dir, except subdirs
+    unsigned long long int m_apparentSize;
+    unsigned long long int m_allocatedSize;
+    unsigned int m_nbFiles;
+    // Names of the subdirs
+    std::vector<std::string> m_subdirs;
+};
+
+// Persistent index of dir contents, keyed by device, inode and mtime
+// An unchanged dir is answered without being read, its subdirs are checked
+// one by one. A file modified in place doesn't change the mtime of its dir:
+// the file operations of the commander invalidate the dirs they overwrite in,
+// files rewritten by other programs are seen when their dir changes.
+class CSizeIndex
+{
+    public:
+
+    // Method to get the instance
+    static CSizeIndex& instance(void);
+
+    // Get the contents of a dir, stat'ed in p_stat
+    // Returns false if it's not indexed or if the dir has changed
+    const bool get(const struct stat &p_stat, T_DIR_SIZE &p_size);
+
+    // Store the contents of a dir, stat'ed in p_stat before reading it
+    void put(const struct stat &p_stat, const T_DIR_SIZE &p_size);
+
+    // Forget a dir
+    void invalidate(const struct stat &p_stat);
+    void invalidate(const std::string &p_dir);
+
+    // Write the index file, if something has changed
+    void save(void);
+
+    private:
+
+    // Forbidden
+    CSizeIndex(void);
+    CSizeIndex(const CSizeIndex &p_source);
+    const CSizeIndex &operator =(const CSizeIndex &p_source);
+
+    // Destructor, saves the index
+    virtual ~CSizeIndex(void);
+
+    // Read the index file, the first time it's needed
+    void load(void);
+
+    struct T_ENTRY
+    {
+        struct timespec m_mtime;
+        // Last session the entry was used, the oldest ones are dropped first
+        unsigned int m_session;
+        T_DIR_SIZE m_size;
+    };
+
+    // Entries, by device and inode
+    std::map<std::pair<dev_t, ino_t>, T_ENTRY> m_entries;
+
+    // Path of the index file
+    std::string m_path;
+
+    // Current session, incremented at each run
+    unsigned int m_session;
+
+    bool m_loaded;
+    bool m_dirty;
+
+    // Entries are used by the scanner and file operation threads
+    std::mutex m_mutex;
+    // Only one thread writes the file
+    std::mutex m_saveMutex;
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include <iostream>
+#include <cerrno>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <SDL.h>
+#include "sizeScanner.h"
+#include "sizeIndex.h"
+#include "def.h"
+
+// Number of threads scanning
+// stat() waits on the storage, several requests in flight help even on one CPU
+#define SIZE_NB_THREADS 4
+
+CSizeScanner::CSizeScanner(void):
+    m_nbActive(0),
+    m_apparentSize(0),
+    m_allocatedSize(0),
+    m_nbFiles(0),
+    m_nbDirs(0),
+    m_nbErrors(0),
+    m_nbIndexed(0),
+    m_done(true),
+    m_cancel(false)
+{
+}
+
+CSizeScanner::~CSizeScanner(void)
+{
+    cancel();
+    for (std::vector<std::thread>::iterator l_it = m_threads.begin(); l_it != m_threads.end(); ++l_it)
+        l_it->join();
+}
+
+void CSizeScanner::start(const std::vector<std::string> &p_paths)
+{
+    m_done = false;
+    // The items themselves
+    struct stat l_stat;
+    for (std::vector<std::string>::const_iterator l_it = p_paths.begin(); l_it != p_paths.end(); ++l_it)
+    {
+        if (lstat(l_it->c_str(), &l_stat) == -1)
+        {
+            std::cerr << "CSizeScanner::start: Error lstat " << *l_it << ": " << strerror(errno) << std::endl;
+            ++m_nbErrors;
+            continue;
+        }
+        if (!isNew(l_stat))
+            continue;
+        m_apparentSize += l_stat.st_size;
+        m_allocatedSize += static_cast<unsigned long long int>(l_stat.st_blocks) * 512;
+        if (S_ISDIR(l_stat.st_mode))
+        {
+            ++m_nbDirs;
+            m_stack.push_back(*l_it);
+        }
+        else
+        {
+            ++m_nbFiles;
+        }
+    }
+    if (m_stack.empty())
+    {
+        m_done = true;
+        return;
+    }
+    // Their contents
+    INHIBIT(std::cout << "CSizeScanner::start: " << p_paths.size() << " items, " << SIZE_NB_THREADS << " threads" << std::endl;)
+    for (unsigned int l_i = 0; l_i < SIZE_NB_THREADS; ++l_i)
+        m_threads.push_back(std::thread(&CSizeScanner::run, this));
+}
+
+void CSizeScanner::cancel(void)
+{
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_cancel = true;
+    }
+    m_condition.notify_all();
+}
+
+void CSizeScanner::run(void)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    std::unique_lock<std::mutex> l_lock(m_mutex);
+    for (;;)
+    {
+        while (m_stack.empty() && m_nbActive && !m_cancel)
+            m_condition.wait(l_lock);
+        if (m_cancel || m_stack.empty())
+            break;
+        const std::string l_path(m_stack.back());
+        m_stack.pop_back();
+        ++m_nbActive;
+        l_lock.unlock();
+        scanDir(l_path);
+        l_lock.lock();
+        --m_nbActive;
+        // Idle threads wait for new dirs, or for the end
+        m_condition.notify_all();
+    }
+    const bool l_last = !m_nbActive && !m_done;
+    if (!m_nbActive)
+        m_done = true;
+    l_lock.unlock();
+    m_condition.notify_all();
+    INHIBIT(std::cout << "CSizeScanner::run: " << m_nbFiles << " files, " << m_nbDirs << " dirs, " << m_nbIndexed << " from the index in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    // The dirs read are kept for the next time
+    if (l_last)
+        CSizeIndex::instance().save();
+}
+
+void CSizeScanner::scanDir(const std::string &p_path)
+{
+    const int l_fd = open(p_path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (l_fd == -1)
+    {
+        std::cerr << "CSizeScanner::scanDir: Error open " << p_path << ": " << strerror(errno) << std::endl;
+        ++m_nbErrors;
+        return;
+    }
+    // Stat'ed before reading, a change during the scan gives another mtime
+    struct stat l_dirStat;
+    const bool l_hasStat = fstat(l_fd, &l_dirStat) == 0;
+    // Totals of the dir, added at once
+    T_DIR_SIZE l_size;
+    unsigned long long int l_subdirsApparentSize(0);
+    unsigned long long int l_subdirsAllocatedSize(0);
+    std::vector<std::string> l_subdirs;
+    const std::string l_prefix(p_path == "/" ? p_path : p_path + "/");
+    if (l_hasStat && CSizeIndex::instance().get(l_dirStat, l_size) && statSubdirs(l_fd, l_prefix, l_size.m_subdirs, l_subdirsApparentSize, l_subdirsAllocatedSize, l_subdirs))
+    {
+        // Unchanged => only the subdirs are stat'ed
+        close(l_fd);
+        ++m_nbIndexed;
+    }
+    else
+    {
+        DIR *l_dir = fdopendir(l_fd);
+        if (l_dir == NULL)
+        {
+            std::cerr << "CSizeScanner::scanDir: Error open " << p_path << ": " << strerror(errno) << std::endl;
+            close(l_fd);
+            ++m_nbErrors;
+            return;
+        }
+        l_size.m_apparentSize = 0;
+        l_size.m_allocatedSize = 0;
+        l_size.m_nbFiles = 0;
+        l_size.m_subdirs.clear();
+        l_subdirs.clear();
+        l_subdirsApparentSize = 0;
+        l_subdirsAllocatedSize = 0;
+        // Dirs with errors or hard links are not indexed, their totals depend on the rest of the scan
+        bool l_indexable(l_hasStat);
+        struct dirent *l_ent;
+        struct stat l_stat;
+        while (!m_cancel && (l_ent = readdir(l_dir)) != NULL)
+        {
+            if (l_ent->d_name[0] == '.' && (l_ent->d_name[1] == '\0' || (l_ent->d_name[1] == '.' && l_ent->d_name[2] == '\0')))
+                continue;
+            if (fstatat(dirfd(l_dir), l_ent->d_name, &l_stat, AT_SYMLINK_NOFOLLOW) == -1)
+            {
+                ++m_nbErrors;
+                l_indexable = false;
+                continue;
+            }
+            if (S_ISDIR(l_stat.st_mode))
+            {
+                l_size.m_subdirs.push_back(l_ent->d_name);
+                l_subdirs.push_back(l_prefix + l_ent->d_name);
+                l_subdirsApparentSize += l_stat.st_size;
+                l_subdirsAllocatedSize += static_cast<unsigned long long int>(l_stat.st_blocks) * 512;
+                continue;
+            }
+            if (l_stat.st_nlink > 1)
+                l_indexable = false;
+            if (!isNew(l_stat))
+                continue;
+            ++l_size.m_nbFiles;
+            l_size.m_apparentSize += l_stat.st_size;
+            l_size.m_allocatedSize += static_cast<unsigned long long int>(l_stat.st_blocks) * 512;
+        }
+        closedir(l_dir);
+        if (l_indexable && !m_cancel)
+            CSizeIndex::instance().put(l_dirStat, l_size);
+    }
+    m_apparentSize += l_size.m_apparentSize + l_subdirsApparentSize;
+    m_allocatedSize += l_size.m_allocatedSize + l_subdirsAllocatedSize;
+    m_nbFiles += l_size.m_nbFiles;
+    m_nbDirs += l_subdirs.size();
+    if (l_subdirs.empty() || m_cancel)
+        return;
+    {
+        std::lock_guard<std::mutex> l_lock(m_mutex);
+        m_stack.insert(m_stack.end(), l_subdirs.begin(), l_subdirs.end());
+    }
+    m_condition.notify_all();
+}
+
+const bool CSizeScanner::statSubdirs(const int p_fd, const std::string &p_prefix, const std::vector<std::string> &p_names, unsigned long long int &p_apparentSize, unsigned long long int &p_allocatedSize, std::vector<std::string> &p_subdirs)
+{
+    struct stat l_stat;
+    for (std::vector<std::string>::const_iterator l_it = p_names.begin(); l_it != p_names.end(); ++l_it)
+    {
+        // Replaced without the dir changing?
+        if (fstatat(p_fd, l_it->c_str(), &l_stat, AT_SYMLINK_NOFOLLOW) == -1 || !S_ISDIR(l_stat.st_mode))
+            return false;
+        p_apparentSize += l_stat.st_size;
+        p_allocatedSize += static_cast<unsigned long long int>(l_stat.st_blocks) * 512;
+        p_subdirs.push_back(p_prefix + *l_it);
+    }
+    return true;
+}
+
+const bool CSizeScanner::isNew(const struct stat &p_stat)
+{
+    // Dirs can't be hard linked
+    if (S_ISDIR(p_stat.st_mode) || p_stat.st_nlink < 2)
+        return true;
+    std::lock_guard<std::mutex> l_lock(m_linksMutex);
+    return m_links.insert(std::make_pair(p_stat.st_dev, p_stat.st_ino)).second;
+}
+
+const bool CSizeScanner::isDone(void) const
+{
+    return m_done;
+}
+
+const unsigned long long int CSizeScanner::getApparentSize(void) const
+{
+    return m_apparentSize;
+}
+
+const unsigned long long int CSizeScanner::getAllocatedSize(void) const
+{
+    return m_allocatedSize;
+}
+
+const unsigned int CSizeScanner::getNbFiles(void) const
+{
+    return m_nbFiles;
+}
+
+const unsigned int CSizeScanner::getNbDirs(void) const
+{
+    return m_nbDirs;
+}
+
+const unsigned int CSizeScanner::getNbErrors(void) const
+{
+    return m_nbErrors;
+}
+
+const unsigned int CSizeScanner::getNbIndexed(void) const
+{
+    return m_nbIndexed;
+}
@@ -0,0 +1,92 @@
+#ifndef _SIZE_SCANNER_H_
+#define _SIZE_SCANNER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Native disk usage, like "du -cs"
+// Trees are scanned in the background by a few threads, and totals grow as they go
+// Symbolic links are not followed, hard links are counted once
+// Dirs unchanged since a previous scan are not read again, see CSizeIndex
+class CSizeScanner
+{
+    public:
+
+    // Constructor
+    CSizeScanner(void);
+
+    // Destructor, stops the scan
+    virtual ~CSizeScanner(void);
+
+    // Start scanning the given items
+    void start(const std::vector<std::string> &p_paths);
+
+    // Stop the scan
+    void cancel(void);
+
+    // True when all items are scanned
+    const bool isDone(void) const;
+
+    // Totals so far
+    // Apparent = sum of the sizes, allocated = sum of the blocks
+    const unsigned long long int getApparentSize(void) const;
+    const unsigned long long int getAllocatedSize(void) const;
+    const unsigned int getNbFiles(void) const;
+    const unsigned int getNbDirs(void) const;
+    const unsigned int getNbErrors(void) const;
+    // Dirs not read, unchanged since they were indexed
+    const unsigned int getNbIndexed(void) const;
+
+    private:
+
+    // Forbidden
+    CSizeScanner(const CSizeScanner &p_source);
+    const CSizeScanner &operator =(const CSizeScanner &p_source);
+
+    // Worker thread: scan the dirs of the stack until there are no more
+    void run(void);
+
+    // Count the entries of a dir, and push its subdirs
+    // Dirs unchanged since the last scan are taken from the size index
+    void scanDir(const std::string &p_path);
+
+    // Stat the subdirs of an indexed dir, and get their paths
+    // Returns false if one is missing, the index is then outdated
+    const bool statSubdirs(const int p_fd, const std::string &p_prefix, const std::vector<std::string> &p_names, unsigned long long int &p_apparentSize, unsigned long long int &p_allocatedSize, std::vector<std::string> &p_subdirs);
+
+    // Returns false for a hard link already counted
+    const bool isNew(const struct stat &p_stat);
+
+    // Dirs to scan, the last one first
+    std::vector<std::string> m_stack;
+    // Number of dirs being scanned
+    unsigned int m_nbActive;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<std::thread> m_threads;
+
+    // Files with several links already counted
+    std::set<std::pair<dev_t, ino_t> > m_links;
+    std::mutex m_linksMutex;
+
+    // Totals
+    std::atomic<unsigned long long int> m_apparentSize;
+    std::atomic<unsigned long long int> m_allocatedSize;
+    std::atomic<unsigned int> m_nbFiles;
+    std::atomic<unsigned int> m_nbDirs;
+    std::atomic<unsigned int> m_nbErrors;
+    std::atomic<unsigned int> m_nbIndexed;
+
+    std::atomic<bool> m_done;
+    std::atomic<bool> m_cancel;
+};
+
+#endif
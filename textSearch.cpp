@@ -0,0 +1,181 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <string.h>
+#include <SDL.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "textSearch.h"
+#include "mappedFile.h"
+#include "def.h"
+
+// Bytes scanned at a time
+#define SEARCH_CHUNK (MAPPED_FILE_WINDOW / 4)
+
+CTextSearch::CTextSearch(void):
+    m_nbScanned(0),
+    m_size(0),
+    m_done(true),
+    m_cancel(false),
+    m_found(false),
+    m_wrapped(false),
+    m_match(0)
+{
+}
+
+CTextSearch::~CTextSearch(void)
+{
+    cancel();
+}
+
+void CTextSearch::start(const std::string &p_path, const std::string &p_pattern, const unsigned long long int p_offset)
+{
+    cancel();
+    m_cancel = false;
+    m_done = false;
+    m_found = false;
+    m_wrapped = false;
+    m_nbScanned = 0;
+    m_size = 0;
+    m_thread = std::thread(&CTextSearch::run, this, p_path, p_pattern, p_offset);
+}
+
+void CTextSearch::cancel(void)
+{
+    m_cancel = true;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+const char *CTextSearch::find(const char *p_data, const std::size_t p_size, const std::string &p_pattern)
+{
+    const std::size_t l_length = p_pattern.size();
+    if (l_length == 0 || l_length > p_size)
+        return NULL;
+    // Candidates: first and last bytes match, then the middle is compared
+    const char l_first = p_pattern[0];
+    const char l_last = p_pattern[l_length - 1];
+    const char *l_middle = p_pattern.data() + 1;
+    const std::size_t l_middleLength = l_length > 2 ? l_length - 2 : 0;
+    const char *l_pos = p_data;
+    // Candidates start before l_end
+    const char * const l_end = p_data + p_size - l_length + 1;
+#ifdef __SSE2__
+    // 16 candidates at a time
+    const __m128i l_firsts = _mm_set1_epi8(l_first);
+    const __m128i l_lasts = _mm_set1_epi8(l_last);
+    for (; l_end - l_pos >= 16; l_pos += 16)
+    {
+        const __m128i l_blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(l_pos));
+        const __m128i l_blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(l_pos + l_length - 1));
+        unsigned int l_mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(l_blockFirst, l_firsts), _mm_cmpeq_epi8(l_blockLast, l_lasts)));
+        while (l_mask)
+        {
+            const unsigned int l_bit = __builtin_ctz(l_mask);
+            if (memcmp(l_pos + l_bit + 1, l_middle, l_middleLength) == 0)
+                return l_pos + l_bit;
+            l_mask &= l_mask - 1;
+        }
+    }
+#else
+    // 8 candidates at a time in a 64 bit word
+    const std::uint64_t l_ones = 0x0101010101010101ULL;
+    const std::uint64_t l_lows = 0x7F7F7F7F7F7F7F7FULL;
+    const std::uint64_t l_firsts = l_ones * static_cast<unsigned char>(l_first);
+    const std::uint64_t l_lasts = l_ones * static_cast<unsigned char>(l_last);
+    for (; l_end - l_pos >= 8; l_pos += 8)
+    {
+        std::uint64_t l_blockFirst, l_blockLast;
+        memcpy(&l_blockFirst, l_pos, 8);
+        memcpy(&l_blockLast, l_pos + l_length - 1, 8);
+        // Null bytes where both match, then their high bits only
+        const std::uint64_t l_diff = (l_blockFirst ^ l_firsts) | (l_blockLast ^ l_lasts);
+        std::uint64_t l_mask = ~(((l_diff & l_lows) + l_lows) | l_diff | l_lows);
+        while (l_mask)
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            const unsigned int l_bit = __builtin_ctzll(l_mask);
+#else
+            const unsigned int l_bit = 63 - __builtin_clzll(l_mask);
+#endif
+            const unsigned int l_byte = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ? l_bit / 8 : 7 - l_bit / 8;
+            if (memcmp(l_pos + l_byte + 1, l_middle, l_middleLength) == 0)
+                return l_pos + l_byte;
+            l_mask &= ~(1ULL << l_bit);
+        }
+    }
+#endif
+    // The rest, memchr is vectorized by the C library
+    while (l_pos < l_end)
+    {
+        l_pos = static_cast<const char *>(memchr(l_pos, l_first, l_end - l_pos));
+        if (l_pos == NULL)
+            return NULL;
+        if (l_pos[l_length - 1] == l_last && memcmp(l_pos + 1, l_middle, l_middleLength) == 0)
+            return l_pos;
+        ++l_pos;
+    }
+    return NULL;
+}
+
+void CTextSearch::run(const std::string p_path, const std::string p_pattern, const unsigned long long int p_offset)
+{
+    INHIBIT(const Uint32 l_time = SDL_GetTicks();)
+    CMappedFile l_file;
+    if (!l_file.open(p_path) || p_pattern.empty())
+    {
+        m_done = true;
+        return;
+    }
+    const unsigned long long int l_size = l_file.getSize();
+    m_size = l_size;
+    // From the offset to the end, then from the beginning to the offset
+    const unsigned long long int l_starts[2] = {std::min(p_offset, l_size), 0};
+    const unsigned long long int l_ends[2] = {l_size, std::min(p_offset + p_pattern.size() - 1, l_size)};
+    for (unsigned int l_pass = 0; l_pass < 2 && !m_found && !m_cancel; ++l_pass)
+    {
+        for (unsigned long long int l_offset = l_starts[l_pass]; l_offset < l_ends[l_pass] && !m_cancel; l_offset += SEARCH_CHUNK)
+        {
+            // Chunks overlap by the pattern size - 1
+            const std::size_t l_chunkSize = std::min(static_cast<unsigned long long int>(SEARCH_CHUNK + p_pattern.size() - 1), l_ends[l_pass] - l_offset);
+            const char *l_data = l_file.get(l_offset, l_chunkSize);
+            if (l_data == NULL)
+                break;
+            const char *l_match = find(l_data, l_chunkSize, p_pattern);
+            if (l_match != NULL)
+            {
+                m_match = l_offset + (l_match - l_data);
+                m_wrapped = l_pass == 1;
+                m_found = true;
+                break;
+            }
+            m_nbScanned += std::min(static_cast<unsigned long long int>(SEARCH_CHUNK), l_ends[l_pass] - l_offset);
+        }
+    }
+    INHIBIT(std::cout << "CTextSearch::run: " << p_pattern << ": " << (m_found ? "found" : "not found") << ", " << m_nbScanned << " bytes in " << SDL_GetTicks() - l_time << "ms" << std::endl;)
+    m_done = true;
+}
+
+const bool CTextSearch::isDone(void) const
+{
+    return m_done;
+}
+
+const unsigned int CTextSearch::getProgress(void) const
+{
+    return m_size ? std::min(m_nbScanned * 100 / m_size, 100ULL) : 0;
+}
+
+const bool CTextSearch::getMatch(unsigned long long int &p_offset) const
+{
+    if (!m_done || !m_found)
+        return false;
+    p_offset = m_match;
+    return true;
+}
+
+const bool CTextSearch::isWrapped(void) const
+{
+    return m_wrapped;
+}
@@ -0,0 +1,64 @@
+#ifndef _TEXT_SEARCH_H_
+#define _TEXT_SEARCH_H_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+// Search of a string in a file, in the background
+// The mapped file is scanned from an offset to the end, then from the beginning
+class CTextSearch
+{
+    public:
+
+    // Constructor
+    CTextSearch(void);
+
+    // Destructor, stops the search
+    virtual ~CTextSearch(void);
+
+    // Search p_pattern in the given file, from p_offset
+    void start(const std::string &p_path, const std::string &p_pattern, const unsigned long long int p_offset);
+
+    // Stop the search
+    void cancel(void);
+
+    // True when the search is over
+    const bool isDone(void) const;
+
+    // Part of the file scanned, in percent
+    const unsigned int getProgress(void) const;
+
+    // Offset of the match, once it's done
+    // Returns false if there is none
+    const bool getMatch(unsigned long long int &p_offset) const;
+
+    // True if the match was found after wrapping to the beginning
+    const bool isWrapped(void) const;
+
+    // First occurrence of p_pattern in p_data, NULL if none
+    static const char *find(const char *p_data, const std::size_t p_size, const std::string &p_pattern);
+
+    private:
+
+    // Forbidden
+    CTextSearch(const CTextSearch &p_source);
+    const CTextSearch &operator =(const CTextSearch &p_source);
+
+    // Search thread
+    void run(const std::string p_path, const std::string p_pattern, const unsigned long long int p_offset);
+
+    std::thread m_thread;
+
+    // Progress and result
+    std::atomic<unsigned long long int> m_nbScanned;
+    std::atomic<unsigned long long int> m_size;
+    std::atomic<bool> m_done;
+    std::atomic<bool> m_cancel;
+    bool m_found;
+    bool m_wrapped;
+    unsigned long long int m_match;
+};
+
+#endif
@@ -0,0 +1,192 @@
+// Benchmark of CCopyEngine, see the copy-bench target of the Makefile.
+// A generated selection of small files, a tree, a big file and a link is
+// copied the way the commander used to, with "cp -r" then "sync" for each
+// item, and by CCopyEngine, which flushes once at the end.
+// Both copies are compared with the source by "diff -r".
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../copyEngine.h"
+#include "../deleteEngine.h"
+
+// Selected small files, and their size
+#define COPY_BENCH_NB_SMALL 500
+#define COPY_BENCH_SMALL_SIZE 4096
+// Files of the tree, in COPY_BENCH_TREE_DIRS dirs, and their size
+#define COPY_BENCH_NB_TREE 200
+#define COPY_BENCH_TREE_DIRS 10
+#define COPY_BENCH_TREE_SIZE 16384
+// Size of the big file
+#define COPY_BENCH_BIG_SIZE 52428800  // = 50 MB
+
+extern char **environ;
+
+namespace {
+
+// Write a file of p_size bytes, different for each seed
+const bool CreateFile(const std::string &p_path, const std::size_t p_size, const unsigned int p_seed)
+{
+    const int l_fd = open(p_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (l_fd == -1)
+        return false;
+    std::vector<char> l_buffer(65536);
+    unsigned int l_value = p_seed * 2654435761u + 1;
+    for (std::vector<char>::iterator l_it = l_buffer.begin(); l_it != l_buffer.end(); ++l_it)
+    {
+        l_value = l_value * 1103515245u + 12345u;
+        *l_it = static_cast<char>(l_value >> 16);
+    }
+    std::size_t l_done(0);
+    while (l_done < p_size)
+    {
+        const ssize_t l_nb = write(l_fd, l_buffer.data(), std::min(l_buffer.size(), p_size - l_done));
+        if (l_nb <= 0)
+        {
+            close(l_fd);
+            return false;
+        }
+        l_done += l_nb;
+    }
+    return close(l_fd) == 0;
+}
+
+// Fill p_src with the items to copy, and list them in p_items
+const bool CreateItems(const std::string &p_src, std::vector<std::string> &p_items)
+{
+    char l_name[64];
+    for (unsigned int l_i = 0; l_i < COPY_BENCH_NB_SMALL; ++l_i)
+    {
+        snprintf(l_name, sizeof(l_name), "small_%03u.txt", l_i);
+        p_items.push_back(p_src + "/" + l_name);
+        if (!CreateFile(p_items.back(), COPY_BENCH_SMALL_SIZE, l_i))
+            return false;
+    }
+    p_items.push_back(p_src + "/tree");
+    if (mkdir(p_items.back().c_str(), 0755) == -1)
+        return false;
+    for (unsigned int l_i = 0; l_i < COPY_BENCH_TREE_DIRS; ++l_i)
+    {
+        snprintf(l_name, sizeof(l_name), "/tree/dir_%02u", l_i);
+        if (mkdir((p_src + l_name).c_str(), 0755) == -1)
+            return false;
+    }
+    for (unsigned int l_i = 0; l_i < COPY_BENCH_NB_TREE; ++l_i)
+    {
+        snprintf(l_name, sizeof(l_name), "/tree/dir_%02u/file_%03u.dat", l_i % COPY_BENCH_TREE_DIRS, l_i);
+        if (!CreateFile(p_src + l_name, COPY_BENCH_TREE_SIZE, COPY_BENCH_NB_SMALL + l_i))
+            return false;
+    }
+    p_items.push_back(p_src + "/big.bin");
+    if (!CreateFile(p_items.back(), COPY_BENCH_BIG_SIZE, 0))
+        return false;
+    p_items.push_back(p_src + "/link");
+    return symlink("big.bin", p_items.back().c_str()) == 0;
+}
+
+// Run a command, returns its exit status
+const int Run(const std::vector<std::string> &p_args)
+{
+    std::vector<char *> l_argv;
+    for (std::vector<std::string>::const_iterator l_it = p_args.begin(); l_it != p_args.end(); ++l_it)
+        l_argv.push_back(const_cast<char *>(l_it->c_str()));
+    l_argv.push_back(NULL);
+    pid_t l_pid;
+    if (posix_spawnp(&l_pid, l_argv[0], NULL, NULL, l_argv.data(), environ) != 0)
+        return -1;
+    int l_status;
+    while (waitpid(l_pid, &l_status, 0) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+    return WIFEXITED(l_status) ? WEXITSTATUS(l_status) : -1;
+}
+
+const double ElapsedS(const std::chrono::steady_clock::time_point &p_start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+} // namespace
+
+int main(void)
+{
+    char l_template[] = "/tmp/copyBench.XXXXXX";
+    if (mkdtemp(l_template) == NULL)
+    {
+        std::cerr << "copyBench: Error mkdtemp: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    const std::string l_path(l_template);
+    const std::string l_src = l_path + "/src";
+    const std::string l_destCp = l_path + "/cp";
+    const std::string l_destEngine = l_path + "/engine";
+    std::vector<std::string> l_items;
+    if (mkdir(l_src.c_str(), 0755) == -1 || mkdir(l_destCp.c_str(), 0755) == -1 || mkdir(l_destEngine.c_str(), 0755) == -1 || !CreateItems(l_src, l_items))
+    {
+        std::cerr << "copyBench: Error creating items: " << strerror(errno) << std::endl;
+        CDeleteEngine().remove(l_path);
+        return 1;
+    }
+    sync();
+    int l_ret(0);
+    // Previous copy: one "cp -r" and one "sync" per item
+    std::chrono::steady_clock::time_point l_start = std::chrono::steady_clock::now();
+    for (std::vector<std::string>::const_iterator l_it = l_items.begin(); l_it != l_items.end(); ++l_it)
+    {
+        std::vector<std::string> l_cp;
+        l_cp.push_back("cp");
+        l_cp.push_back("-r");
+        l_cp.push_back(*l_it);
+        l_cp.push_back(l_destCp);
+        std::vector<std::string> l_sync;
+        l_sync.push_back("sync");
+        l_sync.push_back(l_destCp + l_it->substr(l_src.size()));
+        if (Run(l_cp) != 0 || Run(l_sync) != 0)
+            l_ret = 1;
+    }
+    const double l_cpS = ElapsedS(l_start);
+    // CCopyEngine, flushed once
+    l_start = std::chrono::steady_clock::now();
+    CCopyEngine l_engine;
+    for (std::vector<std::string>::const_iterator l_it = l_items.begin(); l_it != l_items.end(); ++l_it)
+    {
+        if (!l_engine.copy(*l_it, l_destEngine))
+            l_ret = 1;
+    }
+    l_engine.sync();
+    const double l_engineS = ElapsedS(l_start);
+    std::cout << std::fixed << std::setprecision(2) << l_items.size() << " items, " << l_engine.getNbBytes() << " bytes: cp + sync " << l_cpS << " s, CCopyEngine " << l_engineS << " s" << std::endl;
+    // Both copies must be identical to the source
+    std::vector<std::string> l_diff;
+    l_diff.push_back("diff");
+    l_diff.push_back("-r");
+    l_diff.push_back(l_src);
+    l_diff.push_back(l_destCp);
+    if (Run(l_diff) != 0)
+    {
+        std::cerr << "copyBench: Error the copy by cp differs" << std::endl;
+        l_ret = 1;
+    }
+    l_diff.back() = l_destEngine;
+    if (Run(l_diff) != 0)
+    {
+        std::cerr << "copyBench: Error the copy by CCopyEngine differs" << std::endl;
+        l_ret = 1;
+    }
+    CDeleteEngine().remove(l_path);
+    return l_ret;
+}
@@ -0,0 +1,174 @@
+// Benchmark of CDeleteEngine, see the delete-bench target of the Makefile.
+// A generated tree of empty files is removed by "rm -rf", as the commander
+// used to, and by CDeleteEngine. A third tree is removed by CDeleteEngine
+// cancelled after DELETE_BENCH_CANCEL_MS, and the entries left are counted.
+// The target builds it twice: with the default pool of threads, and with
+// a single thread.
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../deleteEngine.h"
+
+// Empty files in DELETE_BENCH_NB_DIRS dirs
+#define DELETE_BENCH_NB_FILES 200000
+#define DELETE_BENCH_NB_DIRS 200
+// Time before the cancel
+#define DELETE_BENCH_CANCEL_MS 300
+
+extern char **environ;
+
+namespace {
+
+// Create p_path and the tree in it
+const bool CreateTree(const std::string &p_path)
+{
+    if (mkdir(p_path.c_str(), 0755) == -1)
+        return false;
+    char l_name[64];
+    for (unsigned int l_i = 0; l_i < DELETE_BENCH_NB_DIRS; ++l_i)
+    {
+        snprintf(l_name, sizeof(l_name), "/dir_%03u", l_i);
+        if (mkdir((p_path + l_name).c_str(), 0755) == -1)
+            return false;
+    }
+    for (unsigned int l_i = 0; l_i < DELETE_BENCH_NB_FILES; ++l_i)
+    {
+        snprintf(l_name, sizeof(l_name), "/dir_%03u/file_%06u", l_i % DELETE_BENCH_NB_DIRS, l_i);
+        const int l_fd = open((p_path + l_name).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (l_fd == -1)
+            return false;
+        close(l_fd);
+    }
+    return true;
+}
+
+// Number of entries of a tree, itself included
+const unsigned int CountEntries(const std::string &p_path)
+{
+    unsigned int l_ret(1);
+    DIR *l_dir = opendir(p_path.c_str());
+    if (l_dir == NULL)
+        return l_ret;
+    struct dirent *l_dirent;
+    while ((l_dirent = readdir(l_dir)) != NULL)
+    {
+        if (strcmp(l_dirent->d_name, ".") == 0 || strcmp(l_dirent->d_name, "..") == 0)
+            continue;
+        if (l_dirent->d_type == DT_DIR)
+            l_ret += CountEntries(p_path + "/" + l_dirent->d_name);
+        else
+            ++l_ret;
+    }
+    closedir(l_dir);
+    return l_ret;
+}
+
+// Run "rm -rf", returns its exit status
+const int RemoveWithRm(const std::string &p_path)
+{
+    const char *l_argv[] = { "rm", "-rf", p_path.c_str(), NULL };
+    pid_t l_pid;
+    if (posix_spawnp(&l_pid, l_argv[0], NULL, NULL, const_cast<char **>(l_argv), environ) != 0)
+        return -1;
+    int l_status;
+    while (waitpid(l_pid, &l_status, 0) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+    return WIFEXITED(l_status) ? WEXITSTATUS(l_status) : -1;
+}
+
+const double ElapsedMs(const std::chrono::steady_clock::time_point &p_start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::string l_label(argc > 1 ? argv[1] : "CDeleteEngine");
+    char l_template[] = "/tmp/deleteBench.XXXXXX";
+    if (mkdtemp(l_template) == NULL)
+    {
+        std::cerr << "deleteBench: Error mkdtemp: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    const std::string l_tree = std::string(l_template) + "/tree";
+    int l_ret(0);
+    // rm -rf
+    if (!CreateTree(l_tree))
+    {
+        std::cerr << "deleteBench: Error creating the tree: " << strerror(errno) << std::endl;
+        CDeleteEngine().remove(l_template);
+        return 1;
+    }
+    sync();
+    std::chrono::steady_clock::time_point l_start = std::chrono::steady_clock::now();
+    if (RemoveWithRm(l_tree) != 0)
+        l_ret = 1;
+    const double l_rmMs = ElapsedMs(l_start);
+    // CDeleteEngine
+    if (!CreateTree(l_tree))
+    {
+        std::cerr << "deleteBench: Error creating the tree: " << strerror(errno) << std::endl;
+        CDeleteEngine().remove(l_template);
+        return 1;
+    }
+    sync();
+    l_start = std::chrono::steady_clock::now();
+    if (!CDeleteEngine().remove(l_tree))
+        l_ret = 1;
+    const double l_engineMs = ElapsedMs(l_start);
+    std::cout << DELETE_BENCH_NB_FILES << " files in " << DELETE_BENCH_NB_DIRS << " dirs: rm -rf " << static_cast<unsigned int>(l_rmMs) << " ms, " << l_label << " " << static_cast<unsigned int>(l_engineMs) << " ms" << std::endl;
+    // CDeleteEngine, cancelled
+    if (!CreateTree(l_tree))
+    {
+        std::cerr << "deleteBench: Error creating the tree: " << strerror(errno) << std::endl;
+        CDeleteEngine().remove(l_template);
+        return 1;
+    }
+    sync();
+    const unsigned int l_nbEntries = CountEntries(l_tree);
+    T_PROGRESS l_progress;
+    std::chrono::steady_clock::time_point l_cancel;
+    std::thread l_canceller([&l_progress, &l_cancel]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DELETE_BENCH_CANCEL_MS));
+        l_cancel = std::chrono::steady_clock::now();
+        l_progress.m_cancel = true;
+    });
+    CDeleteEngine l_engine;
+    l_engine.setProgress(&l_progress);
+    l_engine.remove(l_tree);
+    const std::chrono::steady_clock::time_point l_end = std::chrono::steady_clock::now();
+    l_canceller.join();
+    // Nothing is left when the tree is removed before the cancel
+    const unsigned int l_nbLeft = access(l_tree.c_str(), F_OK) == 0 ? CountEntries(l_tree) : 0;
+    if (l_end < l_cancel)
+        std::cout << "Not cancelled, removed in less than " << DELETE_BENCH_CANCEL_MS << " ms" << std::endl;
+    else
+        std::cout << "Cancelled after " << DELETE_BENCH_CANCEL_MS << " ms: stopped in " << std::chrono::duration_cast<std::chrono::milliseconds>(l_end - l_cancel).count() << " ms, " << l_engine.getNbFiles() << " entries removed, " << l_nbLeft << " of " << l_nbEntries << " left" << std::endl;
+    if (l_engine.getNbFiles() + l_nbLeft != l_nbEntries)
+    {
+        std::cerr << "deleteBench: Error " << l_engine.getNbFiles() << " removed + " << l_nbLeft << " left != " << l_nbEntries << std::endl;
+        l_ret = 1;
+    }
+    CDeleteEngine().remove(l_template);
+    return l_ret;
+}
@@ -0,0 +1,198 @@
+// Benchmark of CFileLister, see the list-bench target of the Makefile.
+// A generated dir is listed the way the commander used to, with a stat() of
+// each entry before a std::sort, and by CFileLister, which takes the types
+// from readdir() and stats the files on demand only.
+// The mtime of the dir is changed before each listing, so that the listing
+// cache always misses.
+// The memory of a listing is the growth of the heap, in a single arena so
+// that the allocations of the lister thread are counted.
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../fileLister.h"
+#include "../deleteEngine.h"
+#include "../fileutils.h"
+
+// Listings of each kind per dir size
+#define LIST_BENCH_RUNS 10
+// One entry in LIST_BENCH_DIR_RATIO is a dir
+#define LIST_BENCH_DIR_RATIO 10
+
+namespace {
+
+// Entry of the previous CFileLister
+struct T_STAT_FILE
+{
+    T_STAT_FILE(const std::string &p_name, const unsigned long int p_size) : m_name(p_name), m_ext(File_utils::getLowercaseFileExtension(p_name)), m_size(p_size) {}
+    std::string m_name;
+    std::string m_ext;
+    unsigned long int m_size;
+};
+
+bool CompareNoCase(const T_STAT_FILE &p_s1, const T_STAT_FILE &p_s2)
+{
+    return strcasecmp(p_s1.m_name.c_str(), p_s2.m_name.c_str()) < 0;
+}
+
+// Fill p_path with p_nb entries, named like photos, music and documents
+const bool CreateEntries(const std::string &p_path, const unsigned int p_nb)
+{
+    static const char * const l_formats[] = { "IMG_%05u.JPG", "%05u - Track.mp3", "Document %u.pdf", "save_%u.srm" };
+    char l_name[64];
+    for (unsigned int l_i = 0; l_i < p_nb; ++l_i)
+    {
+        snprintf(l_name, sizeof(l_name), l_formats[l_i % 4], l_i);
+        const std::string l_entry = p_path + "/" + l_name;
+        if (l_i % LIST_BENCH_DIR_RATIO == 0)
+        {
+            if (mkdir(l_entry.c_str(), 0755) == -1)
+                return false;
+        }
+        else
+        {
+            const int l_fd = open(l_entry.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (l_fd == -1)
+                return false;
+            close(l_fd);
+        }
+    }
+    return true;
+}
+
+// Bytes allocated, from the heap or by mmap
+const std::size_t HeapBytes(void)
+{
+#if __GLIBC_PREREQ(2, 33)
+    const struct mallinfo2 l_info = mallinfo2();
+#else
+    const struct mallinfo l_info = mallinfo();
+#endif
+    return l_info.uordblks + l_info.hblkhd;
+}
+
+// Make the next listing miss the listing cache
+void Touch(const std::string &p_path)
+{
+    utimensat(AT_FDCWD, p_path.c_str(), NULL, 0);
+}
+
+// Listing of the previous CFileLister: stat() of each entry, then std::sort
+// p_bytes is set to the memory used by the lists
+const unsigned int ListWithStat(const std::string &p_path, std::size_t &p_bytes)
+{
+    const std::size_t l_heapBytes = HeapBytes();
+    DIR *l_dir = opendir(p_path.c_str());
+    if (l_dir == NULL)
+        return 0;
+    std::vector<T_STAT_FILE> l_dirs;
+    std::vector<T_STAT_FILE> l_files;
+    struct stat l_stat;
+    struct dirent *l_dirent;
+    while ((l_dirent = readdir(l_dir)) != NULL)
+    {
+        const std::string l_file(l_dirent->d_name);
+        if (l_file == "." || l_file == ".." || stat((p_path + "/" + l_file).c_str(), &l_stat) == -1)
+            continue;
+        if (S_ISDIR(l_stat.st_mode))
+            l_dirs.push_back(T_STAT_FILE(l_file, l_stat.st_size));
+        else
+            l_files.push_back(T_STAT_FILE(l_file, l_stat.st_size));
+    }
+    closedir(l_dir);
+    std::sort(l_dirs.begin(), l_dirs.end(), CompareNoCase);
+    std::sort(l_files.begin(), l_files.end(), CompareNoCase);
+    l_dirs.insert(l_dirs.begin(), T_STAT_FILE("..", 0));
+    p_bytes = HeapBytes() - l_heapBytes;
+    return l_dirs.size() + l_files.size();
+}
+
+// Listing of CFileLister, until its worker thread is done
+// p_bytes is set to the memory used by the lister
+const unsigned int ListWithLister(const std::string &p_path, std::size_t &p_bytes)
+{
+    const std::size_t l_heapBytes = HeapBytes();
+    CFileLister l_lister;
+    if (!l_lister.list(p_path))
+        return 0;
+    while (l_lister.isLoading())
+    {
+        std::this_thread::yield();
+        l_lister.update();
+    }
+    p_bytes = HeapBytes() - l_heapBytes;
+    return l_lister.getNbTotal();
+}
+
+const double ElapsedMs(const std::chrono::steady_clock::time_point &p_start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    mallopt(M_ARENA_MAX, 1);
+    std::vector<unsigned int> l_sizes;
+    for (int l_i = 1; l_i < argc; ++l_i)
+        l_sizes.push_back(strtoul(argv[l_i], NULL, 10));
+    if (l_sizes.empty())
+        l_sizes.push_back(10000);
+    for (std::vector<unsigned int>::const_iterator l_size = l_sizes.begin(); l_size != l_sizes.end(); ++l_size)
+    {
+        char l_template[] = "/tmp/listBench.XXXXXX";
+        if (mkdtemp(l_template) == NULL)
+        {
+            std::cerr << "listBench: Error mkdtemp: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        const std::string l_path(l_template);
+        if (!CreateEntries(l_path, *l_size))
+        {
+            std::cerr << "listBench: Error creating entries: " << strerror(errno) << std::endl;
+            CDeleteEngine().remove(l_path);
+            return 1;
+        }
+        // Both kinds alternate, with the same state of the kernel caches
+        double l_statMs(0.0);
+        double l_listerMs(0.0);
+        unsigned int l_nbStat(0);
+        unsigned int l_nbLister(0);
+        std::size_t l_statBytes(0);
+        std::size_t l_listerBytes(0);
+        for (unsigned int l_run = 0; l_run < LIST_BENCH_RUNS; ++l_run)
+        {
+            Touch(l_path);
+            std::chrono::steady_clock::time_point l_start = std::chrono::steady_clock::now();
+            l_nbStat = ListWithStat(l_path, l_statBytes);
+            l_statMs += ElapsedMs(l_start);
+            Touch(l_path);
+            l_start = std::chrono::steady_clock::now();
+            l_nbLister = ListWithLister(l_path, l_listerBytes);
+            l_listerMs += ElapsedMs(l_start);
+        }
+        std::cout << std::fixed << std::setprecision(1) << *l_size << " entries: stat " << l_statMs / LIST_BENCH_RUNS << " ms " << l_statBytes / 1048576.0 << " MB, CFileLister " << l_listerMs / LIST_BENCH_RUNS << " ms " << l_listerBytes / 1048576.0 << " MB per listing" << std::endl;
+        CDeleteEngine().remove(l_path);
+        if (l_nbStat != l_nbLister || l_nbStat != *l_size + 1)
+        {
+            std::cerr << "listBench: Error " << l_nbStat << " entries listed with stat, " << l_nbLister << " by CFileLister" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#ifndef _ARM_NEON_MODEL_H_
+#define _ARM_NEON_MODEL_H_
+
+// Scalar model of the NEON intrinsics used by imageScaler.cpp, so that its
+// NEON path can be built and checked on other CPUs, see the scaler-check
+// target of the Makefile. Only the lanes and their widths are modelled.
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct { uint8_t v[8]; } uint8x8_t;
+typedef struct { uint8_t v[16]; } uint8x16_t;
+typedef struct { uint16_t v[4]; } uint16x4_t;
+typedef struct { uint16_t v[8]; } uint16x8_t;
+typedef struct { uint32_t v[2]; } uint32x2_t;
+typedef struct { uint32_t v[4]; } uint32x4_t;
+
+static inline uint32x4_t vdupq_n_u32(const uint32_t p_value)
+{
+    uint32x4_t l_ret;
+    for (int l_i = 0; l_i < 4; ++l_i)
+        l_ret.v[l_i] = p_value;
+    return l_ret;
+}
+
+static inline uint32x2_t vdup_n_u32(const uint32_t p_value)
+{
+    uint32x2_t l_ret;
+    l_ret.v[0] = l_ret.v[1] = p_value;
+    return l_ret;
+}
+
+static inline uint8x16_t vld1q_u8(const uint8_t *p_src)
+{
+    uint8x16_t l_ret;
+    memcpy(l_ret.v, p_src, 16);
+    return l_ret;
+}
+
+static inline void vst1q_u8(uint8_t *p_dest, const uint8x16_t p_value)
+{
+    memcpy(p_dest, p_value.v, 16);
+}
+
+static inline void vst1_lane_u32(uint32_t *p_dest, const uint32x2_t p_value, const int p_lane)
+{
+    memcpy(p_dest, &p_value.v[p_lane], 4);
+}
+
+static inline uint8x8_t vget_low_u8(const uint8x16_t p_value)
+{
+    uint8x8_t l_ret;
+    memcpy(l_ret.v, p_value.v, 8);
+    return l_ret;
+}
+
+static inline uint8x8_t vget_high_u8(const uint8x16_t p_value)
+{
+    uint8x8_t l_ret;
+    memcpy(l_ret.v, p_value.v + 8, 8);
+    return l_ret;
+}
+
+static inline uint16x4_t vget_low_u16(const uint16x8_t p_value)
+{
+    uint16x4_t l_ret;
+    memcpy(l_ret.v, p_value.v, 8);
+    return l_ret;
+}
+
+static inline uint16x4_t vget_high_u16(const uint16x8_t p_value)
+{
+    uint16x4_t l_ret;
+    memcpy(l_ret.v, p_value.v + 4, 8);
+    return l_ret;
+}
+
+static inline uint8x16_t vcombine_u8(const uint8x8_t p_low, const uint8x8_t p_high)
+{
+    uint8x16_t l_ret;
+    memcpy(l_ret.v, p_low.v, 8);
+    memcpy(l_ret.v + 8, p_high.v, 8);
+    return l_ret;
+}
+
+static inline uint16x8_t vcombine_u16(const uint16x4_t p_low, const uint16x4_t p_high)
+{
+    uint16x8_t l_ret;
+    memcpy(l_ret.v, p_low.v, 8);
+    memcpy(l_ret.v + 4, p_high.v, 8);
+    return l_ret;
+}
+
+static inline uint8x8_t vreinterpret_u8_u32(const uint32x2_t p_value)
+{
+    uint8x8_t l_ret;
+    memcpy(l_ret.v, p_value.v, 8);
+    return l_ret;
+}
+
+static inline uint32x2_t vreinterpret_u32_u8(const uint8x8_t p_value)
+{
+    uint32x2_t l_ret;
+    memcpy(l_ret.v, p_value.v, 8);
+    return l_ret;
+}
+
+// Widen
+static inline uint16x8_t vmovl_u8(const uint8x8_t p_value)
+{
+    uint16x8_t l_ret;
+    for (int l_i = 0; l_i < 8; ++l_i)
+        l_ret.v[l_i] = p_value.v[l_i];
+    return l_ret;
+}
+
+// Multiply by a scalar and accumulate, widening
+static inline uint32x4_t vmlal_n_u16(uint32x4_t p_acc, const uint16x4_t p_value, const uint16_t p_scalar)
+{
+    for (int l_i = 0; l_i < 4; ++l_i)
+        p_acc.v[l_i] += static_cast<uint32_t>(p_value.v[l_i]) * p_scalar;
+    return p_acc;
+}
+
+// Rounding shift right and narrow, keeping the low bits
+static inline uint16x4_t vrshrn_n_u32(const uint32x4_t p_value, const int p_shift)
+{
+    uint16x4_t l_ret;
+    for (int l_i = 0; l_i < 4; ++l_i)
+        l_ret.v[l_i] = static_cast<uint16_t>((static_cast<uint64_t>(p_value.v[l_i]) + (1u << (p_shift - 1))) >> p_shift);
+    return l_ret;
+}
+
+// Saturating narrow
+static inline uint8x8_t vqmovn_u16(const uint16x8_t p_value)
+{
+    uint8x8_t l_ret;
+    for (int l_i = 0; l_i < 8; ++l_i)
+        l_ret.v[l_i] = p_value.v[l_i] > 255 ? 255 : p_value.v[l_i];
+    return l_ret;
+}
+
+#endif
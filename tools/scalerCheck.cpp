@@ -0,0 +1,281 @@
+// Check and benchmark of Image_scaler, see the scaler-check and scaler-bench
+// targets of the Makefile.
+// Each case is compared with a double precision reference of the same filter:
+// area averaging when reducing, bilinear interpolation when enlarging.
+// The pixels of all cases are written to a file, so that the SSE2, NEON and
+// scalar builds can be compared byte for byte.
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <SDL.h>
+#include "../imageScaler.h"
+
+// Largest difference allowed with the reference, in levels of the destination format
+// Both passes round to 8 bits, and the reference has its own rounding errors
+#define SCALER_CHECK_TOLERANCE 1.000001
+// Minimum time of each benchmark case
+#define SCALER_BENCH_MS 500
+
+namespace {
+
+struct T_CASE
+{
+    int m_srcW;
+    int m_srcH;
+    int m_destW;
+    int m_destH;
+    Uint32 m_format;
+};
+
+const T_CASE g_checks[] =
+{
+    // Viewer fit of a camera picture, thumbnails, icons
+    { 6000, 4000, 454, 303, SDL_PIXELFORMAT_RGBA8888 },
+    { 6000, 4000, 454, 303, SDL_PIXELFORMAT_RGB565 },
+    { 640, 480, 320, 240, SDL_PIXELFORMAT_RGBA8888 },
+    { 640, 480, 320, 240, SDL_PIXELFORMAT_RGB565 },
+    { 64, 64, 32, 32, SDL_PIXELFORMAT_RGBA8888 },
+    { 64, 64, 32, 32, SDL_PIXELFORMAT_RGB565 },
+    // Enlarged, mixed, unchanged and degenerate sizes
+    { 32, 32, 48, 48, SDL_PIXELFORMAT_RGBA8888 },
+    { 32, 32, 48, 48, SDL_PIXELFORMAT_RGB565 },
+    { 100, 37, 301, 13, SDL_PIXELFORMAT_RGBA8888 },
+    { 100, 37, 301, 13, SDL_PIXELFORMAT_RGB565 },
+    { 17, 9, 16, 18, SDL_PIXELFORMAT_RGBA8888 },
+    { 17, 9, 16, 18, SDL_PIXELFORMAT_RGB565 },
+    { 333, 250, 333, 250, SDL_PIXELFORMAT_RGBA8888 },
+    { 333, 250, 333, 250, SDL_PIXELFORMAT_RGB565 },
+    { 7, 5, 1, 1, SDL_PIXELFORMAT_RGBA8888 },
+    { 7, 5, 1, 1, SDL_PIXELFORMAT_RGB565 },
+    { 1, 1, 5, 3, SDL_PIXELFORMAT_RGBA8888 },
+    { 1, 1, 5, 3, SDL_PIXELFORMAT_RGB565 },
+    // Converted to RGBA8888 by the scaler
+    { 200, 100, 50, 40, SDL_PIXELFORMAT_RGB24 }
+};
+
+const T_CASE g_benchmarks[] =
+{
+    { 6000, 4000, 454, 303, SDL_PIXELFORMAT_RGBA8888 },
+    { 1920, 1080, 480, 270, SDL_PIXELFORMAT_RGBA8888 },
+    { 640, 480, 320, 240, SDL_PIXELFORMAT_RGBA8888 },
+    { 240, 160, 480, 320, SDL_PIXELFORMAT_RGBA8888 },
+    { 640, 480, 320, 240, SDL_PIXELFORMAT_RGB565 },
+    { 240, 160, 480, 320, SDL_PIXELFORMAT_RGB565 }
+};
+
+// Source image: gradients and noise, the same for every build
+SDL_Surface *CreateSource(const T_CASE &p_case)
+{
+    SDL_Surface *l_image = SDL_CreateRGBSurfaceWithFormat(0, p_case.m_srcW, p_case.m_srcH, SDL_BITSPERPIXEL(p_case.m_format), p_case.m_format);
+    if (l_image == NULL)
+        return NULL;
+    std::mt19937 l_random(p_case.m_srcW * 7 + p_case.m_srcH * 3 + p_case.m_destW);
+    for (int l_y = 0; l_y < l_image->h; ++l_y)
+    {
+        Uint8 *l_row = static_cast<Uint8 *>(l_image->pixels) + l_y * l_image->pitch;
+        for (int l_i = 0; l_i < l_image->w * l_image->format->BytesPerPixel; ++l_i)
+            l_row[l_i] = (l_i * 37 + l_y * 11 + (l_random() & 63)) & 255;
+    }
+    return l_image;
+}
+
+// Channels of a pixel, as the scaler reads them
+// 32 bits pixels are 4 bytes, RGB565 is expanded to 8 bits per channel
+void GetPixel(const SDL_Surface *p_image, const int p_x, const int p_y, double p_channels[4])
+{
+    const Uint8 *l_pixel = static_cast<const Uint8 *>(p_image->pixels) + p_y * p_image->pitch + p_x * p_image->format->BytesPerPixel;
+    if (p_image->format->format == SDL_PIXELFORMAT_RGB565)
+    {
+        Uint16 l_value;
+        memcpy(&l_value, l_pixel, 2);
+        const unsigned int l_r = l_value >> 11, l_g = (l_value >> 5) & 0x3F, l_b = l_value & 0x1F;
+        p_channels[0] = l_r << 3 | l_r >> 2;
+        p_channels[1] = l_g << 2 | l_g >> 4;
+        p_channels[2] = l_b << 3 | l_b >> 2;
+        p_channels[3] = 255;
+    }
+    else
+    {
+        for (int l_c = 0; l_c < 4; ++l_c)
+            p_channels[l_c] = l_pixel[l_c];
+    }
+}
+
+// Source pixels and weights of a destination pixel, along an axis
+void GetWeights(const int p_src, const int p_dest, const int p_i, std::vector<std::pair<int, double> > &p_weights)
+{
+    p_weights.clear();
+    const double l_scale = static_cast<double>(p_src) / p_dest;
+    if (p_dest < p_src)
+    {
+        const double l_begin = p_i * l_scale;
+        const double l_end = std::min((p_i + 1) * l_scale, static_cast<double>(p_src));
+        for (int l_k = static_cast<int>(l_begin); l_k < l_end; ++l_k)
+            p_weights.push_back(std::make_pair(l_k, (std::min(l_k + 1.0, l_end) - std::max(static_cast<double>(l_k), l_begin)) / l_scale));
+    }
+    else
+    {
+        const double l_x = std::max((p_i + 0.5) * l_scale - 0.5, 0.0);
+        const int l_k = std::min(static_cast<int>(l_x), p_src - 1);
+        const double l_fraction = l_k == p_src - 1 ? 0.0 : l_x - l_k;
+        p_weights.push_back(std::make_pair(l_k, 1.0 - l_fraction));
+        if (l_fraction > 0.0)
+            p_weights.push_back(std::make_pair(l_k + 1, l_fraction));
+    }
+}
+
+// Largest difference between a scaled image and the reference, in levels of its format
+double Compare(const SDL_Surface *p_src, const SDL_Surface *p_dest)
+{
+    const bool l_rgb565 = p_dest->format->format == SDL_PIXELFORMAT_RGB565;
+    double l_max(0.0);
+    std::vector<std::pair<int, double> > l_weightsX, l_weightsY;
+    for (int l_y = 0; l_y < p_dest->h; ++l_y)
+    {
+        GetWeights(p_src->h, p_dest->h, l_y, l_weightsY);
+        for (int l_x = 0; l_x < p_dest->w; ++l_x)
+        {
+            GetWeights(p_src->w, p_dest->w, l_x, l_weightsX);
+            double l_reference[4] = { 0.0, 0.0, 0.0, 0.0 };
+            for (std::vector<std::pair<int, double> >::const_iterator l_itY = l_weightsY.begin(); l_itY != l_weightsY.end(); ++l_itY)
+            {
+                for (std::vector<std::pair<int, double> >::const_iterator l_itX = l_weightsX.begin(); l_itX != l_weightsX.end(); ++l_itX)
+                {
+                    double l_channels[4];
+                    GetPixel(p_src, l_itX->first, l_itY->first, l_channels);
+                    for (int l_c = 0; l_c < 4; ++l_c)
+                        l_reference[l_c] += l_itY->second * l_itX->second * l_channels[l_c];
+                }
+            }
+            if (l_rgb565)
+            {
+                // In 5 or 6 bits levels
+                Uint16 l_value;
+                memcpy(&l_value, static_cast<const Uint8 *>(p_dest->pixels) + l_y * p_dest->pitch + l_x * 2, 2);
+                const unsigned int l_levels[3] = { static_cast<unsigned int>(l_value >> 11), static_cast<unsigned int>((l_value >> 5) & 0x3F), static_cast<unsigned int>(l_value & 0x1F) };
+                const double l_max565[3] = { 31.0, 63.0, 31.0 };
+                for (int l_c = 0; l_c < 3; ++l_c)
+                    l_max = std::max(l_max, std::fabs(l_levels[l_c] - l_reference[l_c] * l_max565[l_c] / 255.0));
+            }
+            else
+            {
+                double l_channels[4];
+                GetPixel(p_dest, l_x, l_y, l_channels);
+                for (int l_c = 0; l_c < 4; ++l_c)
+                    l_max = std::max(l_max, std::fabs(l_channels[l_c] - l_reference[l_c]));
+            }
+        }
+    }
+    return l_max;
+}
+
+const char *FormatName(const Uint32 p_format)
+{
+    return SDL_GetPixelFormatName(p_format) + sizeof("SDL_PIXELFORMAT_") - 1;
+}
+
+// Scale a case, compare it with the reference and write its pixels
+bool Check(const T_CASE &p_case, std::ofstream &p_output)
+{
+    SDL_Surface *l_src = CreateSource(p_case);
+    if (l_src == NULL)
+    {
+        std::cerr << "Check: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_Surface *l_dest = Image_scaler::scale(l_src, p_case.m_destW, p_case.m_destH);
+    if (l_dest == NULL)
+    {
+        std::cerr << "Check: " << SDL_GetError() << std::endl;
+        SDL_FreeSurface(l_src);
+        return false;
+    }
+    // Other formats are scaled as RGBA8888, so is the reference
+    SDL_Surface *l_reference = l_src;
+    if (l_src->format->format != l_dest->format->format)
+        l_reference = SDL_ConvertSurfaceFormat(l_src, l_dest->format->format, 0);
+    bool l_ret(false);
+    if (l_reference != NULL)
+    {
+        const double l_diff = Compare(l_reference, l_dest);
+        l_ret = l_dest->w == p_case.m_destW && l_dest->h == p_case.m_destH && l_diff <= SCALER_CHECK_TOLERANCE;
+        std::cout << "  " << p_case.m_srcW << "x" << p_case.m_srcH << " -> " << p_case.m_destW << "x" << p_case.m_destH << " " << FormatName(p_case.m_format) << ": max diff " << l_diff << (l_ret ? "" : " FAILED") << std::endl;
+        for (int l_y = 0; l_y < l_dest->h; ++l_y)
+            p_output.write(static_cast<const char *>(l_dest->pixels) + l_y * l_dest->pitch, l_dest->w * l_dest->format->BytesPerPixel);
+        if (l_reference != l_src)
+            SDL_FreeSurface(l_reference);
+    }
+    else
+    {
+        std::cerr << "Check: " << SDL_GetError() << std::endl;
+    }
+    SDL_FreeSurface(l_dest);
+    SDL_FreeSurface(l_src);
+    return l_ret;
+}
+
+// Time the scaling of a case
+void Benchmark(const T_CASE &p_case)
+{
+    SDL_Surface *l_src = CreateSource(p_case);
+    if (l_src == NULL)
+    {
+        std::cerr << "Benchmark: " << SDL_GetError() << std::endl;
+        return;
+    }
+    const std::chrono::steady_clock::time_point l_start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> l_elapsed(0.0);
+    unsigned int l_nb(0);
+    do
+    {
+        SDL_FreeSurface(Image_scaler::scale(l_src, p_case.m_destW, p_case.m_destH));
+        ++l_nb;
+        l_elapsed = std::chrono::steady_clock::now() - l_start;
+    }
+    while (l_elapsed.count() < SCALER_BENCH_MS);
+    const double l_ms = l_elapsed.count() / l_nb;
+    std::cout << "  " << p_case.m_srcW << "x" << p_case.m_srcH << " -> " << p_case.m_destW << "x" << p_case.m_destH << " " << FormatName(p_case.m_format) << ": " << l_ms << " ms, " << p_case.m_srcW * static_cast<double>(p_case.m_srcH) / l_ms / 1000.0 << " Mpixels/s" << std::endl;
+    SDL_FreeSurface(l_src);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+#if defined(__SSE2__)
+    const char *l_path = "SSE2";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const char *l_path = "NEON";
+#else
+    const char *l_path = "scalar";
+#endif
+    if (argc == 2 && strcmp(argv[1], "-b") == 0)
+    {
+        std::cout << "Image_scaler benchmark, " << l_path << ":" << std::endl;
+        for (std::size_t l_i = 0; l_i < sizeof(g_benchmarks) / sizeof(g_benchmarks[0]); ++l_i)
+            Benchmark(g_benchmarks[l_i]);
+        return 0;
+    }
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output file> | -b" << std::endl;
+        return 2;
+    }
+    std::ofstream l_output(argv[1], std::ios::binary);
+    if (!l_output)
+    {
+        std::cerr << "Can't write " << argv[1] << std::endl;
+        return 2;
+    }
+    std::cout << "Image_scaler check, " << l_path << ":" << std::endl;
+    bool l_ok(true);
+    for (std::size_t l_i = 0; l_i < sizeof(g_checks) / sizeof(g_checks[0]); ++l_i)
+        l_ok = Check(g_checks[l_i], l_output) && l_ok;
+    return l_ok ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+// Benchmark of the sort of the listings, see the sort-bench target of the
+// Makefile.
+// Generated names are sorted by T_FILE_LIST::sort, in each sort order, and
+// by std::sort with strcasecmp as the commander used to. The order of
+// T_SORT_NOCASE is checked against strcasecmp.
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <strings.h>
+#include "../fileLister.h"
+
+// Sorts of each kind
+#define SORT_BENCH_RUNS 10
+
+namespace {
+
+// Names like photos, music, documents and random words, in random order
+void CreateNames(const unsigned int p_nb, std::vector<std::string> &p_names)
+{
+    static const char * const l_formats[] = { "IMG_%05u.JPG", "%02u - Track.mp3", "Document %u.pdf", "%s.txt", "%s %u.png" };
+    std::mt19937 l_random(p_nb);
+    char l_name[64];
+    char l_word[16];
+    for (unsigned int l_i = 0; l_i < p_nb; ++l_i)
+    {
+        const unsigned int l_length = 3 + l_random() % 10;
+        for (unsigned int l_j = 0; l_j < l_length; ++l_j)
+            l_word[l_j] = (l_random() % 2 ? 'a' : 'A') + l_random() % 26;
+        l_word[l_length] = '\0';
+        const unsigned int l_format = l_i % 5;
+        if (l_format < 3)
+            snprintf(l_name, sizeof(l_name), l_formats[l_format], l_i);
+        else if (l_format == 3)
+            snprintf(l_name, sizeof(l_name), l_formats[l_format], l_word);
+        else
+            snprintf(l_name, sizeof(l_name), l_formats[l_format], l_word, l_i);
+        p_names.push_back(l_name);
+    }
+    std::shuffle(p_names.begin(), p_names.end(), l_random);
+}
+
+bool CompareNoCase(const std::string &p_s1, const std::string &p_s2)
+{
+    return strcasecmp(p_s1.c_str(), p_s2.c_str()) < 0;
+}
+
+const double ElapsedMs(const std::chrono::steady_clock::time_point &p_start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned int l_nb = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    std::vector<std::string> l_names;
+    CreateNames(l_nb, l_names);
+    T_FILE_LIST l_list;
+    for (std::vector<std::string>::const_iterator l_it = l_names.begin(); l_it != l_names.end(); ++l_it)
+        l_list.push_back(l_it->c_str());
+    std::cout << std::fixed << std::setprecision(1);
+    // Previous sort
+    double l_ms(0.0);
+    for (unsigned int l_run = 0; l_run < SORT_BENCH_RUNS; ++l_run)
+    {
+        std::vector<std::string> l_sorted(l_names);
+        const std::chrono::steady_clock::time_point l_start = std::chrono::steady_clock::now();
+        std::sort(l_sorted.begin(), l_sorted.end(), CompareNoCase);
+        l_ms += ElapsedMs(l_start);
+    }
+    std::cout << l_nb << " entries: std::sort + strcasecmp " << l_ms / SORT_BENCH_RUNS << " ms" << std::endl;
+    // T_FILE_LIST, in each order
+    static const char * const l_modeNames[] = { "nocase", "natural", "utf8" };
+    static const T_SORT_MODE l_modes[] = { T_SORT_NOCASE, T_SORT_NATURAL, T_SORT_UTF8 };
+    for (unsigned int l_mode = 0; l_mode < 3; ++l_mode)
+    {
+        T_FILE_LIST l_sorted;
+        l_ms = 0.0;
+        for (unsigned int l_run = 0; l_run < SORT_BENCH_RUNS; ++l_run)
+        {
+            l_sorted = l_list;
+            const std::chrono::steady_clock::time_point l_start = std::chrono::steady_clock::now();
+            l_sorted.sort(0, l_modes[l_mode]);
+            l_ms += ElapsedMs(l_start);
+        }
+        std::cout << l_nb << " entries: T_FILE_LIST " << l_modeNames[l_mode] << " " << l_ms / SORT_BENCH_RUNS << " ms" << std::endl;
+        if (l_modes[l_mode] != T_SORT_NOCASE)
+            continue;
+        for (std::size_t l_i = 1; l_i < l_sorted.size(); ++l_i)
+        {
+            if (strcasecmp(l_sorted.name(l_i - 1), l_sorted.name(l_i)) > 0)
+            {
+                std::cerr << "sortBench: Error " << l_sorted.name(l_i - 1) << " before " << l_sorted.name(l_i) << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -1,11 +1,17 @@
 #include <algorithm>
 #include <iostream>
-#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 
 #include "viewer.h"
 #include "resourceManager.h"
 #include "def.h"
 #include "sdlutils.h"
+#include "dialog.h"
+#include "keyboard.h"
+#include "imageLoader.h"
 
 namespace {
 
@@ -36,45 +42,87 @@ void ReplaceTabs(std::string *line) {
     *line = std::move(result);
 }
 
+// NUL bytes, or many control characters => not text
+bool IsBinary(const char *p_data, const std::size_t p_size)
+{
+    std::size_t l_nbControls(0);
+    for (std::size_t l_i = 0; l_i < p_size; ++l_i)
+    {
+        const unsigned char l_c = p_data[l_i];
+        if (l_c == '\0')
+            return true;
+        if (l_c < 0x20 && l_c != '\t' && l_c != '\n' && l_c != '\r' && l_c != '\f' && l_c != '\v' && l_c != '\b' && l_c != 0x1B)
+            ++l_nbControls;
+    }
+    return l_nbControls * 10 > p_size;
+}
+
+// "0x1F0" => hexadecimal, "50%" => part of p_total, else decimal
+bool ParseNumber(const std::string &p_text, const unsigned long long int p_total, unsigned long long int &p_value)
+{
+    const bool l_hex = p_text.size() > 2 && p_text[0] == '0' && (p_text[1] == 'x' || p_text[1] == 'X');
+    const char *l_start = p_text.c_str() + (l_hex ? 2 : 0);
+    char *l_end = NULL;
+    errno = 0;
+    p_value = strtoull(l_start, &l_end, l_hex ? 16 : 10);
+    if (errno != 0 || l_end == l_start)
+        return false;
+    if (*l_end == '%')
+    {
+        p_value = static_cast<unsigned long long int>(static_cast<double>(p_total) * std::min(p_value, 100ULL) / 100);
+        ++l_end;
+    }
+    return *l_end == '\0';
+}
+
 } // namespace
 
-CViewer::CViewer(const std::string &p_fileName):
+CViewer::CViewer(const std::string &p_fileName, const std::vector<std::string> &p_gallery):
     CWindow(),
     m_fileName(p_fileName),
     m_font(CResourceManager::instance().getFont()),
     m_background(nullptr),
     m_firstLine(0),
-    m_image(nullptr)
+    m_indexStarted(false),
+    m_nbLines(0),
+    m_indexDone(false),
+    m_lastUpdate(0),
+    m_linesBegin(0),
+    m_linesEnd(0),
+    m_hexFirstRow(0),
+    m_hexBytesPerRow(16),
+    m_hexCharWidth(1),
+    m_hexOffsetDigits(8),
+    m_hexMark(0),
+    m_hexMarkLength(1),
+    m_hexMarked(false),
+    m_searching(false),
+    m_match(0),
+    m_hasMatch(false),
+    m_imageIndex(0),
+    m_browsed(false)
 {
     // Create background image
     m_background = SDL_utils::createImage(screen.w * screen.ppu_x, screen.h * screen.ppu_y, SDL_MapRGB(Globals::g_screen->format, COLOR_BG_1));
-    {
-        SDL_Rect l_rect = SDL_utils::Rect(0, 0, screen.w * screen.ppu_x, HEADER_H * screen.ppu_y);
-        SDL_FillRect(m_background, &l_rect, SDL_MapRGB(m_background->format, COLOR_BORDER));
-    }
     // Print title
-    SDL_Surface *l_surfaceTmp = SDL_utils::renderText(m_font, m_fileName, Globals::g_colorTextTitle, {COLOR_TITLE_BG});
-    if (l_surfaceTmp->w > m_background->w - 2 * VIEWER_MARGIN)
-    {
-        SDL_Rect l_rect;
-        l_rect.x = l_surfaceTmp->w - (m_background->w - 2 * VIEWER_MARGIN);
-        l_rect.y = 0;
-        l_rect.w = m_background->w - 2 * VIEWER_MARGIN;
-        l_rect.h = l_surfaceTmp->h;
-        SDL_utils::applySurface(VIEWER_MARGIN, HEADER_PADDING_TOP, l_surfaceTmp, m_background, &l_rect);
-    }
-    else
-    {
-        SDL_utils::applySurface(VIEWER_MARGIN, HEADER_PADDING_TOP, l_surfaceTmp, m_background);
-    }
-    m_clip.h = l_surfaceTmp->h;
-    SDL_FreeSurface(l_surfaceTmp);
+    renderTitle();
 
-    // Read file
-    m_image = SDL_utils::loadImageToFit(m_fileName, screen.w, screen.h - Y_LIST);
-    if (m_image != nullptr)
+    // Images are decoded in the background
+    if (CImageLoader::isImage(m_fileName))
     {
         m_mode = IMAGE;
+        // The gallery must contain the file
+        m_images = p_gallery;
+        std::vector<std::string>::const_iterator l_it = std::find(m_images.begin(), m_images.end(), m_fileName);
+        if (l_it == m_images.end())
+        {
+            m_images.assign(1, m_fileName);
+            l_it = m_images.begin();
+        }
+        m_imageIndex = l_it - m_images.begin();
+        T_IMAGE_SLOT l_empty = {VIEWER_NO_IMAGE, 0, false, nullptr};
+        m_slots.assign(std::min(m_images.size(), static_cast<std::size_t>(2 * VIEWER_PREFETCH + 1)), l_empty);
+        prefetch();
 
         // Transparency grid background.
         constexpr int kTransparentBgRectSize = 10;
@@ -96,36 +144,56 @@ CViewer::CViewer(const std::string &p_fileName):
     }
     else
     {
-        m_mode = TEXT;
+        openText();
+    }
+}
 
-        // Init clip rect
-        m_clip.x = 0;
-        m_clip.y = 0;
-        m_clip.w = (screen.w - 2 * VIEWER_MARGIN) * screen.ppu_x;
+void CViewer::openText(void)
+{
+    m_mode = TEXT;
 
-        std::ifstream l_file(m_fileName.c_str());
+    // Init clip rect
+    m_clip.x = 0;
+    m_clip.y = 0;
+    m_clip.w = (screen.w - 2 * VIEWER_MARGIN) * screen.ppu_x;
 
-        if (l_file.is_open())
-        {
-            while (!l_file.eof())
-            {
-                m_lines.emplace_back();
-                std::getline(l_file, m_lines.back());
-                ReplaceTabs(&m_lines.back());
-            }
-            l_file.close();
-        }
-        else
-            std::cerr << "Error: unable to open file " << m_fileName << std::endl;
-        INHIBIT(std::cout << "CViewer: " << m_lines.size() << " lines read" << std::endl;)
+    if (!m_file.open(m_fileName))
+    {
+        std::cerr << "Error: unable to open file " << m_fileName << std::endl;
+        return;
+    }
+
+    // Hex layout: character cells as wide as the widest character,
+    // as many bytes per row as the screen allows
+    for (char l_c = 0x20; l_c < 0x7F; ++l_c)
+        m_hexCharWidth = std::max(m_hexCharWidth, CResourceManager::instance().getTextWidth(std::string(1, l_c)));
+    while (m_hexOffsetDigits < 16 && m_file.getSize() > 1ULL << (4 * m_hexOffsetDigits))
+        ++m_hexOffsetDigits;
+    // Offset, 2 spaces, "XX " per byte, 1 space, 1 character per byte
+    while (m_hexBytesPerRow > 4 && static_cast<int>((m_hexOffsetDigits + 3 + m_hexBytesPerRow * 4) * m_hexCharWidth) > m_clip.w)
+        m_hexBytesPerRow /= 2;
+
+    // Binary files are shown in hex
+    const std::size_t l_size = std::min(static_cast<unsigned long long int>(VIEWER_SNIFF_SIZE), m_file.getSize());
+    const char *l_data = m_file.get(0, l_size);
+    if (l_data != NULL && IsBinary(l_data, l_size))
+    {
+        m_mode = HEX;
+        decodeHexPage();
+    }
+    else
+    {
+        // Lines are indexed in the background, only the visible ones are read
+        m_indexStarted = true;
+        m_index.start(m_fileName);
     }
 }
 
 CViewer::~CViewer(void)
 {
-    // Free surfaces
-    if (m_image != NULL)
-        SDL_FreeSurface(m_image);
+    // Free surfaces, and cancel the images not decoded yet
+    for (std::vector<T_IMAGE_SLOT>::iterator l_it = m_slots.begin(); l_it != m_slots.end(); ++l_it)
+        releaseSlot(*l_it);
     if (m_background != NULL)
         SDL_FreeSurface(m_background);
 }
@@ -137,29 +205,91 @@ void CViewer::render(const bool p_focus) const
     SDL_utils::applySurface(0, 0, m_background, Globals::g_screen);
     if (m_mode == IMAGE)
     {
-        SDL_utils::applySurface((screen.w - m_image->w / screen.ppu_x) / 2, Y_LIST + (screen.h - Y_LIST - m_image->h / screen.ppu_y) / 2, m_image, Globals::g_screen);
+        const T_IMAGE_SLOT &l_slot = m_slots[m_imageIndex % m_slots.size()];
+        SDL_Surface *l_image = l_slot.m_image;
+        if (l_image != nullptr)
+        {
+            SDL_utils::applySurface((screen.w - l_image->w / screen.ppu_x) / 2, Y_LIST + (screen.h - Y_LIST - l_image->h / screen.ppu_y) / 2, l_image, Globals::g_screen);
+        }
+        else
+        {
+            // Placeholder, centered
+            const std::string l_text(l_slot.m_loading ? VIEWER_DECODING : VIEWER_UNDECODABLE);
+            const int l_width = CResourceManager::instance().getTextWidth(l_text);
+            CResourceManager::instance().drawText((screen.w - l_width / screen.ppu_x) / 2, Y_LIST + (screen.h - Y_LIST - VIEWER_LINE_HEIGHT) / 2, Globals::g_screen, l_text, Globals::g_colorTextNormal, {COLOR_BG_1});
+        }
     }
     else if (m_mode == TEXT)
     {
+        CResourceManager &l_resources = CResourceManager::instance();
         // Draw lines
-        std::size_t i = std::min(m_firstLine + VIEWER_NB_LINES, m_lines.size());
-        while (i-- > m_firstLine)
+        std::size_t i = m_lines.size();
+        while (i-- > 0)
         {
             const std::string &line = m_lines[i];
             if (line.empty())
                 continue;
-            SDL_Surface *l_surfaceTmp = SDL_utils::renderText(m_font, line, Globals::g_colorTextNormal, {COLOR_BG_1});
-            if (l_surfaceTmp != nullptr) {
-                SDL_utils::applySurface(VIEWER_MARGIN, VIEWER_Y_LIST + (i - m_firstLine) * VIEWER_LINE_HEIGHT, l_surfaceTmp, Globals::g_screen, &m_clip);
-                SDL_FreeSurface(l_surfaceTmp);
+            const Sint16 l_y = VIEWER_Y_LIST + i * VIEWER_LINE_HEIGHT;
+            l_resources.drawText(VIEWER_MARGIN, l_y, Globals::g_screen, line, Globals::g_colorTextNormal, {COLOR_BG_1}, m_clip.x, m_clip.w);
+            // Occurrences of the searched text, over the line
+            for (std::size_t l_pos = m_searchPattern.empty() ? std::string::npos : line.find(m_searchPattern); l_pos != std::string::npos; l_pos = line.find(m_searchPattern, l_pos + m_searchPattern.size()))
+            {
+                const int l_x = l_resources.getTextWidth(line.c_str(), l_pos) - m_clip.x;
+                if (l_x >= m_clip.w)
+                    break;
+                const int l_skip = std::max(-l_x, 0);
+                l_resources.drawText(VIEWER_MARGIN + (l_x + l_skip) / screen.ppu_x, l_y, Globals::g_screen, line.c_str() + l_pos, m_searchPattern.size(), Globals::g_colorTextNormal, {COLOR_CURSOR_1}, l_skip, m_clip.w - l_x - l_skip);
             }
         }
     }
+    else if (m_mode == HEX)
+    {
+        CResourceManager &l_resources = CResourceManager::instance();
+        // Columns, in character cells
+        const unsigned int l_hexColumn = m_hexOffsetDigits + 2;
+        const unsigned int l_charColumn = l_hexColumn + m_hexBytesPerRow * 3 + 1;
+        char l_buffer[24];
+        for (std::size_t l_row = 0; l_row * m_hexBytesPerRow < m_hexPage.size(); ++l_row)
+        {
+            const Sint16 l_y = VIEWER_Y_LIST + l_row * VIEWER_LINE_HEIGHT;
+            const unsigned long long int l_offset = (m_hexFirstRow + l_row) * m_hexBytesPerRow;
+            snprintf(l_buffer, sizeof(l_buffer), "%0*llX", m_hexOffsetDigits, l_offset);
+            l_resources.drawText(VIEWER_MARGIN, l_y, Globals::g_screen, l_buffer, m_hexOffsetDigits, Globals::g_colorTextDir, {COLOR_BG_1});
+            for (unsigned int l_i = 0; l_i < m_hexBytesPerRow && l_row * m_hexBytesPerRow + l_i < m_hexPage.size(); ++l_i)
+            {
+                const unsigned char l_byte = m_hexPage[l_row * m_hexBytesPerRow + l_i];
+                const SDL_Color l_bg = m_hexMarked && l_offset + l_i >= m_hexMark && l_offset + l_i < m_hexMark + m_hexMarkLength ? SDL_Color{COLOR_CURSOR_1} : SDL_Color{COLOR_BG_1};
+                // Each byte in its cells, whatever the widths of the characters
+                snprintf(l_buffer, sizeof(l_buffer), "%02X", l_byte);
+                l_resources.drawText(VIEWER_MARGIN + (l_hexColumn + l_i * 3) * m_hexCharWidth / screen.ppu_x, l_y, Globals::g_screen, l_buffer, 2, Globals::g_colorTextNormal, l_bg);
+                l_buffer[0] = l_byte >= 0x20 && l_byte < 0x7F ? l_byte : '.';
+                l_resources.drawText(VIEWER_MARGIN + (l_charColumn + l_i) * m_hexCharWidth / screen.ppu_x, l_y, Globals::g_screen, l_buffer, 1, Globals::g_colorTextNormal, l_bg);
+            }
+        }
+    }
+    if (m_mode != IMAGE || m_images.size() > 1)
+    {
+        // Position or status, over the end of the title
+        std::ostringstream l_s;
+        if (!m_status.empty())
+            l_s << m_status;
+        else if (m_mode == IMAGE)
+            l_s << m_imageIndex + 1 << "/" << m_images.size();
+        else if (m_mode == HEX)
+            l_s << std::hex << std::uppercase << m_hexFirstRow * m_hexBytesPerRow << "/" << m_file.getSize();
+        else
+            l_s << (m_nbLines ? m_firstLine + 1 : 0) << "/" << m_nbLines << (m_indexDone ? "" : "+");
+        const int l_width = CResourceManager::instance().getTextWidth(l_s.str());
+        CResourceManager::instance().drawText(screen.w - VIEWER_MARGIN - l_width / screen.ppu_x, HEADER_PADDING_TOP, Globals::g_screen, l_s.str(), Globals::g_colorTextTitle, {COLOR_TITLE_BG});
+    }
 }
 
 const bool CViewer::keyPress(const SDL_Event &p_event)
 {
     CWindow::keyPress(p_event);
+    // Messages last until the next key
+    if (!m_searching)
+        m_status.clear();
     switch (p_event.key.keysym.sym)
     {
         case MYKEY_PARENT:
@@ -167,27 +297,36 @@ const bool CViewer::keyPress(const SDL_Event &p_event)
             return true;
             break;
         case MYKEY_UP:
-            if (m_mode == TEXT)
+            if (m_mode != IMAGE)
                 return moveUp(1);
             break;
         case MYKEY_DOWN:
-            if (m_mode == TEXT)
+            if (m_mode != IMAGE)
                 return moveDown(1);
             break;
         case MYKEY_PAGEUP:
-            if (m_mode == TEXT)
+            if (m_mode != IMAGE)
                 return moveUp(VIEWER_NB_LINES - 1);
             break;
         case MYKEY_PAGEDOWN:
-            if (m_mode == TEXT)
+            if (m_mode != IMAGE)
                 return moveDown(VIEWER_NB_LINES - 1);
             break;
+        case MYKEY_SYSTEM:
+            if (m_mode != IMAGE && m_file.getSize())
+                return openMenu();
+            break;
+        case MYKEY_OPEN:
+            // Find next
+            if (m_mode != IMAGE && m_file.getSize())
+                return find(false);
+            break;
         case MYKEY_LEFT:
-            if (m_mode == TEXT)
+            if (m_mode != HEX)
                 return moveLeft();
             break;
         case MYKEY_RIGHT:
-            if (m_mode == TEXT)
+            if (m_mode != HEX)
                 return moveRight();
             break;
         default:
@@ -217,11 +356,11 @@ const bool CViewer::keyHold(void)
                 return moveDown(VIEWER_NB_LINES - 1);
             break;
         case MYKEY_LEFT:
-            if (tick(SDL_GetKeyboardState(NULL)[SDL_GetScancodeFromKey(MYKEY_LEFT)]))
+            if (m_mode != HEX && tick(SDL_GetKeyboardState(NULL)[SDL_GetScancodeFromKey(MYKEY_LEFT)]))
                 return moveLeft();
             break;
         case MYKEY_RIGHT:
-            if (tick(SDL_GetKeyboardState(NULL)[SDL_GetScancodeFromKey(MYKEY_RIGHT)]))
+            if (m_mode != HEX && tick(SDL_GetKeyboardState(NULL)[SDL_GetScancodeFromKey(MYKEY_RIGHT)]))
                 return moveRight();
             break;
         default:
@@ -239,12 +378,22 @@ bool CViewer::isFullScreen(void) const
 bool CViewer::moveUp(const unsigned int p_step)
 {
     bool l_ret(false);
-    if (m_firstLine)
+    if (m_mode == HEX)
+    {
+        if (m_hexFirstRow)
+        {
+            m_hexFirstRow -= std::min(static_cast<unsigned long long int>(p_step), m_hexFirstRow);
+            decodeHexPage();
+            l_ret = true;
+        }
+    }
+    else if (m_firstLine)
     {
         if (m_firstLine > p_step)
             m_firstLine -= p_step;
         else
             m_firstLine = 0;
+        decodeLines();
         l_ret = true;
     }
     return l_ret;
@@ -253,12 +402,23 @@ bool CViewer::moveUp(const unsigned int p_step)
 bool CViewer::moveDown(const unsigned int p_step)
 {
     bool l_ret(false);
-    if (m_firstLine + VIEWER_NB_LINES + 1 < m_lines.size())
+    if (m_mode == HEX)
     {
-        if (m_firstLine + VIEWER_NB_LINES + 1 + p_step > m_lines.size())
-            m_firstLine = m_lines.size() - VIEWER_NB_LINES - 1;
+        const unsigned long long int l_lastRow = getLastHexRow();
+        if (m_hexFirstRow < l_lastRow)
+        {
+            m_hexFirstRow = std::min(m_hexFirstRow + p_step, l_lastRow);
+            decodeHexPage();
+            l_ret = true;
+        }
+    }
+    else if (m_firstLine + VIEWER_NB_LINES + 1 < m_nbLines)
+    {
+        if (m_firstLine + VIEWER_NB_LINES + 1 + p_step > m_nbLines)
+            m_firstLine = m_nbLines - VIEWER_NB_LINES - 1;
         else
             m_firstLine += p_step;
+        decodeLines();
         l_ret = true;
     }
     return l_ret;
@@ -266,6 +426,8 @@ bool CViewer::moveDown(const unsigned int p_step)
 
 bool CViewer::moveLeft(void)
 {
+    if (m_mode == IMAGE)
+        return m_imageIndex > 0 && showImage(m_imageIndex - 1);
     bool l_ret(false);
     if (m_clip.x > 0)
     {
@@ -280,6 +442,336 @@ bool CViewer::moveLeft(void)
 
 bool CViewer::moveRight(void)
 {
+    if (m_mode == IMAGE)
+        return m_imageIndex + 1 < m_images.size() && showImage(m_imageIndex + 1);
     m_clip.x += VIEWER_X_STEP * screen.ppu_x;
     return true;
 }
+
+const bool CViewer::update(void)
+{
+    if (m_mode == IMAGE)
+    {
+        if (!pollImages())
+            return false;
+        if (!m_browsed && m_slots[m_imageIndex % m_slots.size()].m_image == nullptr)
+        {
+            // Not decoded => shown as text, without the transparency grid
+            for (std::vector<T_IMAGE_SLOT>::iterator l_it = m_slots.begin(); l_it != m_slots.end(); ++l_it)
+                releaseSlot(*l_it);
+            m_slots.clear();
+            SDL_Rect l_rect = SDL_utils::Rect(0, HEADER_H * screen.ppu_y, screen.w * screen.ppu_x, (screen.h - HEADER_H) * screen.ppu_y);
+            SDL_FillRect(m_background, &l_rect, SDL_MapRGB(m_background->format, COLOR_BG_1));
+            openText();
+        }
+        return true;
+    }
+    if (SDL_GetTicks() - m_lastUpdate < VIEWER_UPDATE_MS)
+        return false;
+    m_lastUpdate = SDL_GetTicks();
+    bool l_ret(false);
+    if (m_indexStarted && !m_indexDone)
+    {
+        // Done first, so that the number of lines is final
+        m_indexDone = m_index.isDone();
+        const unsigned long long int l_nbLines = m_index.getNbLines();
+        if (l_nbLines != m_nbLines || m_indexDone)
+        {
+            m_nbLines = l_nbLines;
+            // New lines may be visible
+            if (m_mode == TEXT && m_lines.size() < VIEWER_NB_LINES)
+                decodeLines();
+            l_ret = true;
+        }
+    }
+    if (m_searching)
+        l_ret = updateSearch() || l_ret;
+    return l_ret;
+}
+
+void CViewer::decodeLines(void)
+{
+    m_lines.clear();
+    m_linesBegin = 0;
+    m_linesEnd = 0;
+    const unsigned long long int l_end = std::min(m_firstLine + VIEWER_NB_LINES, m_nbLines);
+    if (m_firstLine >= l_end)
+        return;
+    unsigned long long int l_offset = m_index.getOffset(m_file, m_firstLine);
+    m_linesBegin = l_offset;
+    for (unsigned long long int l_line = m_firstLine; l_line < l_end; ++l_line)
+    {
+        const std::size_t l_size = std::min(static_cast<unsigned long long int>(LINE_SIZE_MAX + 1), m_file.getSize() - l_offset);
+        const char *l_data = m_file.get(l_offset, l_size);
+        if (l_data == NULL)
+            break;
+        std::size_t l_length = CLineIndex::getLineLength(l_data, l_size);
+        if (l_length == 0)
+            l_length = l_size;
+        l_offset += l_length;
+        // Without the end of line
+        if (l_data[l_length - 1] == '\n')
+        {
+            --l_length;
+            if (l_length && l_data[l_length - 1] == '\r')
+                --l_length;
+        }
+        m_lines.push_back(std::string(l_data, l_length));
+        ReplaceTabs(&m_lines.back());
+    }
+    m_linesEnd = l_offset;
+}
+
+void CViewer::decodeHexPage(void)
+{
+    m_hexPage.clear();
+    const unsigned long long int l_offset = m_hexFirstRow * m_hexBytesPerRow;
+    if (l_offset >= m_file.getSize())
+        return;
+    const std::size_t l_size = std::min(static_cast<unsigned long long int>(VIEWER_NB_LINES * m_hexBytesPerRow), m_file.getSize() - l_offset);
+    const char *l_data = m_file.get(l_offset, l_size);
+    if (l_data != NULL)
+        m_hexPage.assign(l_data, l_data + l_size);
+}
+
+const unsigned long long int CViewer::getNbHexRows(void) const
+{
+    return (m_file.getSize() + m_hexBytesPerRow - 1) / m_hexBytesPerRow;
+}
+
+const unsigned long long int CViewer::getLastHexRow(void) const
+{
+    // The last row on the last fully visible line
+    const unsigned long long int l_nbRows = getNbHexRows();
+    return l_nbRows > VIEWER_NB_LINES - 1 ? l_nbRows - (VIEWER_NB_LINES - 1) : 0;
+}
+
+const bool CViewer::openMenu(void)
+{
+    CDialog l_dialog("View:", 0, 0);
+    l_dialog.addOption(m_mode == HEX ? "Text mode" : "Hex mode");
+    l_dialog.addOption(m_mode == HEX ? "Go to offset" : "Go to line");
+    l_dialog.addOption("Find");
+    if (!m_searchPattern.empty())
+        l_dialog.addOption("Find next");
+    l_dialog.init();
+    switch (l_dialog.execute())
+    {
+        case 1:
+            switchMode();
+            break;
+        case 2:
+            goTo();
+            break;
+        case 3:
+            find(true);
+            break;
+        case 4:
+            find(false);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+void CViewer::switchMode(void)
+{
+    if (m_mode == HEX)
+    {
+        m_mode = TEXT;
+        if (!m_indexStarted)
+        {
+            m_indexStarted = true;
+            m_index.start(m_fileName);
+        }
+        decodeLines();
+    }
+    else
+    {
+        m_mode = HEX;
+        decodeHexPage();
+    }
+}
+
+const bool CViewer::goTo(void)
+{
+    // Current position, to be edited
+    std::ostringstream l_s;
+    if (m_mode == HEX)
+        l_s << "0x" << std::hex << std::uppercase << m_hexFirstRow * m_hexBytesPerRow;
+    else
+        l_s << m_firstLine + 1;
+    CKeyboard l_keyboard(l_s.str());
+    unsigned long long int l_value(0);
+    if (l_keyboard.execute() != 1 || !ParseNumber(l_keyboard.getInputText(), m_mode == HEX ? m_file.getSize() : m_nbLines, l_value))
+        return false;
+    if (m_mode == HEX)
+    {
+        // The byte is highlighted, on the first line if possible
+        m_hexMark = std::min(l_value, m_file.getSize() - 1);
+        m_hexMarkLength = 1;
+        m_hexMarked = true;
+        m_hexFirstRow = std::min(m_hexMark / m_hexBytesPerRow, getLastHexRow());
+        decodeHexPage();
+    }
+    else
+    {
+        // Lines are numbered from 1, those not indexed yet can't be reached
+        m_firstLine = std::min(l_value ? l_value - 1 : 0, getLastLine());
+        decodeLines();
+    }
+    return true;
+}
+
+const unsigned long long int CViewer::getLastLine(void) const
+{
+    return m_nbLines > VIEWER_NB_LINES + 1 ? m_nbLines - VIEWER_NB_LINES - 1 : 0;
+}
+
+const bool CViewer::find(const bool p_ask)
+{
+    if (p_ask || m_searchPattern.empty())
+    {
+        CKeyboard l_keyboard(m_searchPattern);
+        if (l_keyboard.execute() != 1 || l_keyboard.getInputText().empty())
+            return true;
+        m_searchPattern = l_keyboard.getInputText();
+        m_hasMatch = false;
+    }
+    // From the visible page, after the last match if it's on it
+    unsigned long long int l_begin = m_linesBegin;
+    unsigned long long int l_end = m_linesEnd;
+    if (m_mode == HEX)
+    {
+        l_begin = m_hexFirstRow * m_hexBytesPerRow;
+        l_end = l_begin + m_hexPage.size();
+    }
+    if (m_hasMatch && m_match >= l_begin && m_match < l_end)
+        l_begin = m_match + 1;
+    m_search.start(m_fileName, m_searchPattern, l_begin);
+    m_searching = true;
+    m_status = "Searching...";
+    return true;
+}
+
+const bool CViewer::updateSearch(void)
+{
+    if (!m_search.isDone())
+    {
+        std::ostringstream l_s;
+        l_s << "Searching... " << m_search.getProgress() << "%";
+        if (l_s.str() == m_status)
+            return false;
+        m_status = l_s.str();
+        return true;
+    }
+    unsigned long long int l_match(0);
+    if (!m_search.getMatch(l_match))
+    {
+        m_searching = false;
+        m_status = "Not found";
+        return true;
+    }
+    if (m_mode == HEX)
+    {
+        m_hexMark = l_match;
+        m_hexMarkLength = m_searchPattern.size();
+        m_hexMarked = true;
+        m_hexFirstRow = std::min(l_match / m_hexBytesPerRow, getLastHexRow());
+        decodeHexPage();
+    }
+    else
+    {
+        // The line of the match is shown once it's indexed
+        if (!m_index.isDone() && l_match >= m_index.getNbBytes())
+        {
+            m_status = "Indexing...";
+            return true;
+        }
+        m_indexDone = m_index.isDone();
+        m_nbLines = m_index.getNbLines();
+        m_firstLine = std::min(m_index.getLine(m_file, l_match), getLastLine());
+        decodeLines();
+    }
+    m_match = l_match;
+    m_hasMatch = true;
+    m_searching = false;
+    m_status = m_search.isWrapped() ? "Search wrapped" : "";
+    return true;
+}
+
+void CViewer::renderTitle(void)
+{
+    SDL_Rect l_rect = SDL_utils::Rect(0, 0, screen.w * screen.ppu_x, HEADER_H * screen.ppu_y);
+    SDL_FillRect(m_background, &l_rect, SDL_MapRGB(m_background->format, COLOR_BORDER));
+    SDL_Surface *l_surfaceTmp = SDL_utils::renderText(m_font, m_fileName, Globals::g_colorTextTitle, {COLOR_TITLE_BG});
+    if (l_surfaceTmp->w > m_background->w - 2 * VIEWER_MARGIN)
+    {
+        l_rect.x = l_surfaceTmp->w - (m_background->w - 2 * VIEWER_MARGIN);
+        l_rect.y = 0;
+        l_rect.w = m_background->w - 2 * VIEWER_MARGIN;
+        l_rect.h = l_surfaceTmp->h;
+        SDL_utils::applySurface(VIEWER_MARGIN, HEADER_PADDING_TOP, l_surfaceTmp, m_background, &l_rect);
+    }
+    else
+    {
+        SDL_utils::applySurface(VIEWER_MARGIN, HEADER_PADDING_TOP, l_surfaceTmp, m_background);
+    }
+    m_clip.h = l_surfaceTmp->h;
+    SDL_FreeSurface(l_surfaceTmp);
+}
+
+void CViewer::releaseSlot(T_IMAGE_SLOT &p_slot)
+{
+    if (p_slot.m_loading)
+        CImageLoader::instance().cancel(p_slot.m_id);
+    if (p_slot.m_image != nullptr)
+        SDL_FreeSurface(p_slot.m_image);
+    p_slot.m_index = VIEWER_NO_IMAGE;
+    p_slot.m_loading = false;
+    p_slot.m_image = nullptr;
+}
+
+const bool CViewer::showImage(const unsigned int p_index)
+{
+    m_imageIndex = p_index;
+    m_fileName = m_images[p_index];
+    m_browsed = true;
+    renderTitle();
+    prefetch();
+    return true;
+}
+
+void CViewer::prefetch(void)
+{
+    // The current image first, then the next and previous ones alternately
+    // Images that left the ring are cancelled, or freed, when their slot is reused
+    for (int l_distance = 0; l_distance < static_cast<int>(m_slots.size()); ++l_distance)
+    {
+        const long long int l_index = static_cast<long long int>(m_imageIndex) + (l_distance % 2 ? (l_distance + 1) / 2 : -(l_distance / 2));
+        if (l_index < 0 || l_index >= static_cast<long long int>(m_images.size()))
+            continue;
+        T_IMAGE_SLOT &l_slot = m_slots[l_index % m_slots.size()];
+        if (l_slot.m_index == l_index)
+            continue;
+        releaseSlot(l_slot);
+        l_slot.m_index = l_index;
+        l_slot.m_id = CImageLoader::instance().load(m_images[l_index], screen.w, screen.h - Y_LIST, CImageCache::images(), l_distance == 0);
+        l_slot.m_loading = true;
+    }
+}
+
+const bool CViewer::pollImages(void)
+{
+    bool l_ret(false);
+    for (std::vector<T_IMAGE_SLOT>::iterator l_it = m_slots.begin(); l_it != m_slots.end(); ++l_it)
+    {
+        if (!l_it->m_loading || !CImageLoader::instance().take(l_it->m_id, l_it->m_image))
+            continue;
+        l_it->m_loading = false;
+        if (l_it->m_index == m_imageIndex)
+            l_ret = true;
+    }
+    return l_ret;
+}
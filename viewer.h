@@ -9,20 +9,30 @@
 
 #include "screen.h"
 #include "window.h"
+#include "mappedFile.h"
+#include "lineIndex.h"
+#include "textSearch.h"
 
 #define VIEWER_LINE_HEIGHT   13
 #define VIEWER_Y_LIST        18
 #define VIEWER_NB_LINES      ((screen.h - VIEWER_Y_LIST - 1) / VIEWER_LINE_HEIGHT + 1)
 #define VIEWER_MARGIN        1
 #define VIEWER_X_STEP        32
-#define VIEWER_SIZE_MAX      16777216  // = 16 MB
+#define VIEWER_UPDATE_MS     100
+#define VIEWER_SNIFF_SIZE    4096
+#define VIEWER_DECODING      "Decoding..."
+#define VIEWER_UNDECODABLE   "Unable to decode"
+// Images decoded ahead on each side of the current one in a gallery
+#define VIEWER_PREFETCH      2
+#define VIEWER_NO_IMAGE      static_cast<unsigned int>(-1)
 
 class CViewer : public CWindow
 {
     public:
 
     // Constructor
-    CViewer(const std::string &p_fileName);
+    // If the file is an image, left/right show the other images of p_gallery
+    CViewer(const std::string &p_fileName, const std::vector<std::string> &p_gallery = std::vector<std::string>());
 
     // Destructor
     virtual ~CViewer(void);
@@ -40,18 +50,66 @@ class CViewer : public CWindow
     // Key hold management
     virtual const bool keyHold(void);
 
+    // Periodic update, while the image is decoded or the file is indexed
+    virtual const bool update(void);
+
     // Draw
     virtual void render(const bool p_focus) const;
 
     // Is window full screen?
     virtual bool isFullScreen(void) const;
 
-    // Scroll (text mode only)
+    // Scroll, by lines or hex rows
     bool moveUp(const unsigned int p_step);
     bool moveDown(const unsigned int p_step);
+    // Scroll (text mode), or previous/next image (image mode)
     bool moveLeft(void);
     bool moveRight(void);
 
+    // Draw the file name in the title bar of the background
+    void renderTitle(void);
+
+    // Open the file in text mode, or in hex mode if it's binary
+    void openText(void);
+
+    // Show an image of the gallery, and decode its neighbours
+    const bool showImage(const unsigned int p_index);
+
+    // Request the images around the current one that are not in the ring
+    void prefetch(void);
+
+    // Get the decoded images
+    // Returns true if the current one is done
+    const bool pollImages(void);
+
+    // Menu: mode, go to, find
+    const bool openMenu(void);
+
+    // Switch between text and hex modes
+    void switchMode(void);
+
+    // Ask for a line or an offset, and show it
+    const bool goTo(void);
+
+    // Search the next match from the visible page, asking for the text if p_ask
+    const bool find(const bool p_ask);
+
+    // Show the match once the search is done
+    const bool updateSearch(void);
+
+    // Maximum first line (text mode only)
+    const unsigned long long int getLastLine(void) const;
+
+    // Read the visible lines (text mode only)
+    void decodeLines(void);
+
+    // Read the visible rows (hex mode only)
+    void decodeHexPage(void);
+
+    // Number of hex rows of the file, and the maximum first row
+    const unsigned long long int getNbHexRows(void) const;
+    const unsigned long long int getLastHexRow(void) const;
+
     // The viewed file name
     std::string m_fileName;
 
@@ -66,16 +124,79 @@ class CViewer : public CWindow
     enum {
         TEXT = 0,
         IMAGE = 1,
+        HEX = 2,
     } m_mode;
 
     // Text mode:
-    std::size_t m_firstLine;
+    unsigned long long int m_firstLine;
 
-    // List of read lines
+    // The file, mapped, and its lines
+    CMappedFile m_file;
+    CLineIndex m_index;
+
+    // Lines indexed at the last update, and if that was all
+    // The index is started the first time the text mode is used
+    bool m_indexStarted;
+    unsigned long long int m_nbLines;
+    bool m_indexDone;
+    Uint32 m_lastUpdate;
+
+    // Visible lines, from m_firstLine, tabs expanded, and their bytes in the file
     std::vector<std::string> m_lines;
+    unsigned long long int m_linesBegin;
+    unsigned long long int m_linesEnd;
+
+    // Hex mode:
+    unsigned long long int m_hexFirstRow;
+    unsigned int m_hexBytesPerRow;
+
+    // Width of a character cell, and of the offsets
+    int m_hexCharWidth;
+    unsigned int m_hexOffsetDigits;
+
+    // Bytes highlighted by "go to" or "find", if m_hexMarked
+    unsigned long long int m_hexMark;
+    std::size_t m_hexMarkLength;
+    bool m_hexMarked;
+
+    // Visible bytes, from the first row
+    std::vector<unsigned char> m_hexPage;
+
+    // Search, in text and hex modes
+    CTextSearch m_search;
+    std::string m_searchPattern;
+    // A search is running, or its match waits for the line index
+    bool m_searching;
+    // Last match, the next search starts after it if it's visible
+    unsigned long long int m_match;
+    bool m_hasMatch;
+
+    // Shown instead of the position until the next key
+    std::string m_status;
 
     // Image mode:
-    SDL_Surface *m_image;
+    // Images of the gallery, the current one is m_fileName
+    std::vector<std::string> m_images;
+    unsigned int m_imageIndex;
+    // Another image has been shown, the first one is not shown as text anymore
+    bool m_browsed;
+
+    // Image of the gallery, decoded or requested to the image loader
+    struct T_IMAGE_SLOT
+    {
+        // Index in the gallery, VIEWER_NO_IMAGE if empty
+        unsigned int m_index;
+        unsigned int m_id;
+        bool m_loading;
+        // NULL if it couldn't be decoded
+        SDL_Surface *m_image;
+    };
+
+    // Empty a slot, cancelling its request
+    static void releaseSlot(T_IMAGE_SLOT &p_slot);
+
+    // Ring of the images around the current one, image i in slot i % size
+    std::vector<T_IMAGE_SLOT> m_slots;
 };
 
 #endif
@@ -15,12 +15,14 @@ CWindow::CWindow(void):
 {
     // Add window to the lists for render
     Globals::g_windows.push_back(this);
+    SDL_utils::invalidateAll();
 }
 
 CWindow::~CWindow(void)
 {
     // Remove last window
     Globals::g_windows.pop_back();
+    SDL_utils::invalidateAll();
 }
 
 const int CWindow::execute(void)
@@ -102,17 +104,17 @@ const int CWindow::execute(void)
         // Handle key hold
         if (l_loop)
             l_render = this->keyHold() || l_render;
+        // Handle background work
+        if (l_loop)
+        {
+            l_render = this->update() || l_render;
+            if (m_retVal)
+                l_loop = false;
+        }
         // Render if necessary
         if (l_render && l_loop)
         {
             SDL_utils::renderAll();
-            // Flip twice to avoid graphical glitch on Dingoo
-            //SDL_Flip(Globals::g_screen);
-            //SDL_Flip(Globals::g_screen);
-            // SDL_Flip(ScreenSurface);
-            SDL_UpdateWindowSurface(Globals::g_sdlwindow);
-            SDL_UpdateWindowSurface(Globals::g_sdlwindow);
-
             l_render = false;
             INHIBIT(std::cout << "Render time: " << SDL_GetTicks() - l_time << "ms"<< std::endl;)
         }
@@ -138,6 +140,18 @@ const bool CWindow::keyHold(void)
     return false;
 }
 
+const bool CWindow::renderDamage(std::vector<SDL_Rect> &p_rects) const
+{
+    // Default behavior
+    return false;
+}
+
+const bool CWindow::update(void)
+{
+    // Default behavior
+    return false;
+}
+
 const bool CWindow::tick(const Uint8 p_held)
 {
     bool l_ret(false);
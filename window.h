@@ -1,6 +1,7 @@
 #ifndef _WINDOW_H_
 #define _WINDOW_H_
 
+#include <vector>
 #include <SDL.h>
 
 class CWindow
@@ -19,6 +20,11 @@ class CWindow
     // Draw window
     virtual void render(const bool p_focus) const = 0;
 
+    // Draw only what changed since the last render, over the previous frame
+    // Changed rects are added to p_rects
+    // Returns false if a full render is needed
+    virtual const bool renderDamage(std::vector<SDL_Rect> &p_rects) const;
+
     // Is window full screen?
     virtual bool isFullScreen(void) const;
 
@@ -33,6 +39,10 @@ class CWindow
     // Key hold management
     virtual const bool keyHold(void);
 
+    // Periodic update, called every frame
+    // Returns true if a new render is needed
+    virtual const bool update(void);
+
     // Timer tick
     const bool tick(const Uint8 p_held);
 